@@ -23,12 +23,22 @@
 // https://github.com/oneapi-src/oneDNN/blob/v1.7/LICENSE
 
 #include <array>
+#include <atomic>
 #include <cstdint> // For uint16_t and uint32_t.
 #include <cmath>
 #include <cfloat>
+#include <cstddef> // For size_t.
 #include <cstring>
+#include <functional> // For hash.
+#include <limits>
 #include <type_traits> // For enable_if, is_integral, and is_pod.
 
+#ifdef BIOVAULT_BFLOAT16_INSTRUMENTATION
+#include <algorithm> // For find.
+#include <mutex>
+#include <vector>
+#endif
+
 
 // For a tagged version of the biovault_bfloat16 repository, having tag name
 // "v" <major> "." <minor> "." <patch>, the following macro defines should
@@ -49,8 +59,395 @@
 #define BIOVAULT_BFLOAT16_CONSTEXPR constexpr
 #endif
 
+// Compile-time conversion from float to bfloat16 needs either a constexpr bit_cast
+// (C++20 std::bit_cast, or the __builtin_bit_cast of GCC >= 11, Clang >= 9, and
+// Visual C++ >= 2019 16.7), or C++14 relaxed constexpr support, to decompose the
+// float arithmetically. Defining BIOVAULT_BFLOAT16_NO_BUILTIN_BIT_CAST forces the
+// arithmetic decomposition (mainly to test it with a recent compiler).
+#ifndef BIOVAULT_BFLOAT16_NO_BUILTIN_BIT_CAST
+#	if defined(__has_builtin)
+#		if __has_builtin(__builtin_bit_cast)
+#		define BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST
+#		endif
+#	endif
+#	if !defined(BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST) && defined(_MSC_VER) && (_MSC_VER >= 1927)
+#	define BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST
+#	endif
+#endif
+
+#if defined(BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST) || \
+	(defined(__cpp_constexpr) && (__cpp_constexpr >= 201304L) && !(defined(_MSC_VER) && (_MSC_VER < 1910)))
+#define BIOVAULT_BFLOAT16_HAS_CONSTEXPR_CONVERSION
+#define BIOVAULT_BFLOAT16_CONSTEXPR_CONVERSION constexpr
+#else
+#define BIOVAULT_BFLOAT16_CONSTEXPR_CONVERSION
+#endif
+
+// SIMD kernels for the bulk conversion functions are selected at run-time, based
+// on the instruction sets supported by the CPU. On x86 and x64, the kernels are
+// compiled with a target attribute per function, so that they are available
+// without having to enable the instruction sets for the entire project. They
+// can be switched off altogether by defining the macro BIOVAULT_BFLOAT16_NO_SIMD.
+#ifndef BIOVAULT_BFLOAT16_NO_SIMD
+#	if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+		(defined(__GNUC__) || defined(_MSC_VER))
+#	define BIOVAULT_BFLOAT16_X86
+#	define BIOVAULT_BFLOAT16_SSE2
+#	define BIOVAULT_BFLOAT16_AVX2
+#	define BIOVAULT_BFLOAT16_AVX512
+// The AVX512_BF16 intrinsics (VCVTNE2PS2BF16/VCVTNEPS2BF16) need a recent compiler.
+#		if defined(__AVX512BF16__) || (defined(__clang__) && (__clang_major__ >= 12)) || \
+			(defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 10)) || \
+			(defined(_MSC_VER) && !defined(__clang__) && (_MSC_VER >= 1930))
+#		define BIOVAULT_BFLOAT16_AVX512_BF16
+#		endif
+#	endif
+#	if defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#	define BIOVAULT_BFLOAT16_NEON
+// The ARMv8.6 BF16 conversion instructions (BFCVTN/BFCVTN2) must be enabled for
+// the compiler, for example by -march=armv8.6-a or -march=armv8.2-a+bf16.
+#		if defined(__ARM_FEATURE_BF16_VECTOR_ARITHMETIC)
+#		define BIOVAULT_BFLOAT16_NEON_BF16
+#		endif
+#	endif
+#endif
+
+#if defined(__GNUC__)
+#define BIOVAULT_BFLOAT16_TARGET(instruction_sets) __attribute__((target(instruction_sets)))
+#else
+#define BIOVAULT_BFLOAT16_TARGET(instruction_sets)
+#endif
+
+#define BIOVAULT_BFLOAT16_TARGET_SSE2 BIOVAULT_BFLOAT16_TARGET("sse2")
+#define BIOVAULT_BFLOAT16_TARGET_AVX2 BIOVAULT_BFLOAT16_TARGET("avx2,fma")
+#define BIOVAULT_BFLOAT16_TARGET_AVX2_F16C BIOVAULT_BFLOAT16_TARGET("avx2,fma,f16c")
+#define BIOVAULT_BFLOAT16_TARGET_AVX512 BIOVAULT_BFLOAT16_TARGET("avx512f,avx512bw,avx512dq,avx512vl")
+#define BIOVAULT_BFLOAT16_TARGET_AVX512_BF16 \
+	BIOVAULT_BFLOAT16_TARGET("avx512f,avx512bw,avx512dq,avx512vl,avx512bf16")
+
+#ifdef BIOVAULT_BFLOAT16_X86
+#	if defined(__GNUC__) && !defined(__clang__)
+// Avoid false warnings from GCC about _mm512_undefined_epi32() and friends,
+// used internally by the intrinsics: https://gcc.gnu.org/bugzilla/show_bug.cgi?id=105593
+#	pragma GCC diagnostic push
+#	pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#	pragma GCC diagnostic ignored "-Wuninitialized"
+#	include <immintrin.h>
+#	pragma GCC diagnostic pop
+#	else
+#	include <immintrin.h>
+#	endif
+#	ifdef _MSC_VER
+#	include <intrin.h> // For __cpuidex and _xgetbv.
+#	else
+#	include <cpuid.h> // For __get_cpuid and __get_cpuid_count.
+#	endif
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON
+#include <arm_neon.h>
+#	if defined(__linux__) && defined(__aarch64__)
+#	include <sys/auxv.h> // For getauxval.
+#	endif
+#endif
+
 namespace biovault {
 
+	// Rounding policies for the conversion from float to bfloat16. They only affect
+	// normal floats: zero and denormals always convert to sign preserving zero,
+	// infinity is preserved, and NaN is always converted to a quiet NaN.
+
+	// Round to nearest, ties to even (the default).
+	struct round_to_nearest_even_t {};
+
+	// Truncate, rounding toward zero. The fastest possible conversion.
+	struct round_toward_zero_t {};
+
+	const round_to_nearest_even_t round_to_nearest_even{};
+	const round_toward_zero_t round_toward_zero{};
+
+	// Stochastic rounding: rounds a normal float up (away from zero) with a
+	// probability proportional to the distance to the next lower bfloat16 magnitude,
+	// so that the expected value of the result equals the float. Uses a counter-based
+	// random generator: the random bits for the element at counter position c only
+	// depend on the seed and c. So for a specific seed, a bulk conversion yields the
+	// same results as converting its elements one by one, whichever SIMD kernel is used.
+	class stochastic_rounding
+	{
+	public:
+		explicit stochastic_rounding(const std::uint32_t seed = 0, const std::uint64_t counter = 0)
+			: seed_{ seed }, counter_{ counter }, key_{ compute_key(seed, counter) }
+		{
+		}
+
+		std::uint64_t get_counter() const
+		{
+			return counter_;
+		}
+
+		// Returns the key that is combined with the lower 32 bits of the counter, to
+		// produce the random bits. Only changes when the upper 32 bits of the counter change.
+		std::uint32_t get_key() const
+		{
+			return key_;
+		}
+
+		// Advances the counter by n positions.
+		void discard(const std::uint64_t n)
+		{
+			const auto previous_counter = counter_;
+			counter_ += n;
+
+			if ((counter_ >> 32) != (previous_counter >> 32))
+			{
+				key_ = compute_key(seed_, counter_);
+			}
+		}
+
+		// Returns the rounding bias for the next element, and advances the counter.
+		std::uint32_t next_rounding_bias()
+		{
+			const auto result = get_rounding_bias(key_, static_cast<std::uint32_t>(counter_));
+			discard(1);
+			return result;
+		}
+
+		// Returns a 16-bit random rounding bias, for the specified key and 32-bit counter.
+		static std::uint32_t get_rounding_bias(const std::uint32_t key, const std::uint32_t counter)
+		{
+			return hash(counter ^ key) >> 16;
+		}
+
+		// Bijective 32-bit integer hash ("lowbias32"), by Chris Wellons:
+		// https://nullprogram.com/blog/2018/07/31/
+		static std::uint32_t hash(std::uint32_t x)
+		{
+			x ^= x >> 16;
+			x *= 0x7FEB352DU;
+			x ^= x >> 15;
+			x *= 0x846CA68BU;
+			x ^= x >> 16;
+			return x;
+		}
+
+	private:
+		static std::uint32_t compute_key(const std::uint32_t seed, const std::uint64_t counter)
+		{
+			return hash(seed ^ hash(static_cast<std::uint32_t>(counter >> 32) + 0x9E3779B9U));
+		}
+
+		std::uint32_t seed_;
+		std::uint64_t counter_;
+		std::uint32_t key_;
+	};
+
+
+#ifdef BIOVAULT_BFLOAT16_INSTRUMENTATION
+	// Optional instrumentation of the conversion from float to bfloat16, enabled by
+	// defining the macro BIOVAULT_BFLOAT16_INSTRUMENTATION. Counts the conversions by
+	// the float constructors and the bulk conversion functions, per classification of
+	// the input, as well as the normal floats that are rounded to infinity. Each
+	// thread has its own counters, which are merged by get_conversion_counters().
+	// When the macro is not defined, there is no instrumentation code at all.
+	struct conversion_counters
+	{
+		std::uint64_t zero{};
+		std::uint64_t subnormal{};
+		std::uint64_t normal{};
+		std::uint64_t infinite{};
+		std::uint64_t nan{};
+		std::uint64_t overflow_to_infinity{};
+	};
+
+	namespace detail {
+
+		enum conversion_counter_index { zero_index, subnormal_index, normal_index, infinite_index, nan_index,
+			overflow_to_infinity_index, number_of_conversion_counters };
+
+		// Only incremented by its own thread, but may be read by any thread.
+		using thread_conversion_counters = std::array<std::atomic<std::uint64_t>, number_of_conversion_counters>;
+
+		class conversion_counter_registry
+		{
+		public:
+			void add(thread_conversion_counters& counters)
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+				threads_.push_back(&counters);
+			}
+
+			// Keeps the counts of a thread that exits.
+			void remove(thread_conversion_counters& counters)
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+				add_counts(counters, retired_counts_);
+				threads_.erase(std::find(threads_.begin(), threads_.end(), &counters));
+			}
+
+			std::array<std::uint64_t, number_of_conversion_counters> get_counts()
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+				auto result = retired_counts_;
+
+				for (const auto* const counters : threads_)
+				{
+					add_counts(*counters, result);
+				}
+				return result;
+			}
+
+			void reset()
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+				retired_counts_ = {};
+
+				for (auto* const counters : threads_)
+				{
+					for (auto& counter : *counters)
+					{
+						counter.store(0, std::memory_order_relaxed);
+					}
+				}
+			}
+
+		private:
+			static void add_counts(const thread_conversion_counters& counters,
+				std::array<std::uint64_t, number_of_conversion_counters>& counts)
+			{
+				for (std::size_t i{}; i < number_of_conversion_counters; ++i)
+				{
+					counts[i] += counters[i].load(std::memory_order_relaxed);
+				}
+			}
+
+			std::mutex mutex_;
+			std::vector<thread_conversion_counters*> threads_;
+			std::array<std::uint64_t, number_of_conversion_counters> retired_counts_{};
+		};
+
+		// The registry is intentionally never destroyed: its first use may be inside a
+		// conversion, after the construction of a static thread pool, whose worker
+		// threads then still remove their counters from it at exit, during the
+		// destruction of that pool.
+		inline conversion_counter_registry& get_conversion_counter_registry()
+		{
+			static auto* const registry = new conversion_counter_registry;
+			return *registry;
+		}
+
+		// Registers the counters of the current thread, for as long as the thread lives.
+		class registered_thread_conversion_counters
+		{
+		public:
+			registered_thread_conversion_counters()
+			{
+				for (auto& counter : counters)
+				{
+					counter.store(0, std::memory_order_relaxed);
+				}
+				get_conversion_counter_registry().add(counters);
+			}
+
+			registered_thread_conversion_counters(const registered_thread_conversion_counters&) = delete;
+			registered_thread_conversion_counters& operator=(const registered_thread_conversion_counters&) = delete;
+
+			~registered_thread_conversion_counters()
+			{
+				get_conversion_counter_registry().remove(counters);
+			}
+
+			thread_conversion_counters counters;
+		};
+
+		inline thread_conversion_counters& get_thread_conversion_counters()
+		{
+			thread_local registered_thread_conversion_counters registered_counters;
+			return registered_counters.counters;
+		}
+
+		// Counts the conversion of a float (specified by its 32 bits) to a bfloat16
+		// (specified by its 16 bits). The counter is only written by the current
+		// thread, so it does not need an atomic read-modify-write operation.
+		inline void count_conversion(const std::uint32_t float_bits, const std::uint16_t bfloat16_bits)
+		{
+			const std::uint32_t exponent_bits{ float_bits & 0x7F800000U };
+			const bool has_mantissa{ (float_bits & 0x007FFFFFU) != 0 };
+			const auto index = (exponent_bits == 0) ? (has_mantissa ? subnormal_index : zero_index) :
+				(exponent_bits == 0x7F800000U) ? (has_mantissa ? nan_index : infinite_index) : normal_index;
+			auto& counters = get_thread_conversion_counters();
+
+			const auto increment = [&counters](const conversion_counter_index i)
+			{
+				counters[i].store(counters[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			};
+			increment(index);
+
+			if ((index == normal_index) && ((bfloat16_bits & 0x7FFFU) == 0x7F80U))
+			{
+				increment(overflow_to_infinity_index);
+			}
+		}
+	}
+
+
+	// Returns the sum of the conversion counters of all threads, including the
+	// threads that have already exited.
+	inline conversion_counters get_conversion_counters()
+	{
+		const auto counts = detail::get_conversion_counter_registry().get_counts();
+		conversion_counters result;
+		result.zero = counts[detail::zero_index];
+		result.subnormal = counts[detail::subnormal_index];
+		result.normal = counts[detail::normal_index];
+		result.infinite = counts[detail::infinite_index];
+		result.nan = counts[detail::nan_index];
+		result.overflow_to_infinity = counts[detail::overflow_to_infinity_index];
+		return result;
+	}
+
+
+	// Resets the conversion counters of all threads to zero. Note: should not be called
+	// while another thread is converting.
+	inline void reset_conversion_counters()
+	{
+		detail::get_conversion_counter_registry().reset();
+	}
+
+	namespace detail {
+
+		// Counts the bulk conversion of the n floats src[i * src_stride] to the bfloat16
+		// values dst[i * dst_stride].
+		template <typename BFloat16>
+		void count_conversions(const float* const src, const std::ptrdiff_t src_stride, const BFloat16* const dst,
+			const std::ptrdiff_t dst_stride, const std::size_t n)
+		{
+			for (std::size_t i{}; i < n; ++i)
+			{
+				std::uint32_t float_bits;
+				std::memcpy(&float_bits, src + static_cast<std::ptrdiff_t>(i) * src_stride, sizeof(float_bits));
+				count_conversion(float_bits, get_raw_bits(dst[static_cast<std::ptrdiff_t>(i) * dst_stride]));
+			}
+		}
+
+		// Counts the bulk conversion of n floats from src to the bfloat16 values in dst.
+		template <typename BFloat16>
+		void count_conversions(const float* const src, const BFloat16* const dst, const std::size_t n)
+		{
+			count_conversions(src, 1, dst, 1, n);
+		}
+	}
+
+#define BIOVAULT_BFLOAT16_COUNT_CONVERSION(float_bits, bfloat16_bits) \
+	::biovault::detail::count_conversion(float_bits, bfloat16_bits)
+#define BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(src, dst, n) ::biovault::detail::count_conversions(src, dst, n)
+#define BIOVAULT_BFLOAT16_COUNT_STRIDED_CONVERSIONS(src, src_stride, dst, dst_stride, n) \
+	::biovault::detail::count_conversions(src, src_stride, dst, dst_stride, n)
+#else
+#define BIOVAULT_BFLOAT16_COUNT_CONVERSION(float_bits, bfloat16_bits) static_cast<void>(0)
+#define BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(src, dst, n) static_cast<void>(0)
+#define BIOVAULT_BFLOAT16_COUNT_STRIDED_CONVERSIONS(src, src_stride, dst, dst_stride, n) static_cast<void>(0)
+#endif
+
+
 	class bfloat16_t {
 
 	private:
@@ -58,6 +455,7 @@ namespace biovault {
 		// just like in the original implementation (dnnl::impl::bfloat16_t).
 		using uint16_t = std::uint16_t;
 		using uint32_t = std::uint32_t;
+		using uint64_t = std::uint64_t;
 
 		uint16_t raw_bits_;
 
@@ -85,6 +483,59 @@ namespace biovault {
 			return t;
 		}
 
+		// Returns the 32 bits of the specified float. Evaluable at compile-time, when
+		// BIOVAULT_BFLOAT16_HAS_CONSTEXPR_CONVERSION is defined.
+		static BIOVAULT_BFLOAT16_CONSTEXPR_CONVERSION uint32_t constexpr_bit_cast(const float f) {
+#ifdef BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST
+			return __builtin_bit_cast(uint32_t, f);
+#elif defined(BIOVAULT_BFLOAT16_HAS_CONSTEXPR_CONVERSION)
+			// Decompose the float arithmetically. Note: the payload of a NaN cannot be
+			// retrieved arithmetically, so any NaN yields the bits of a quiet NaN with
+			// an empty payload. Without __builtin_signbit, the sign of -0.0f and of a
+			// NaN is lost as well.
+#	ifdef __GNUC__
+			const uint32_t sign{ __builtin_signbit(f) ? 0x80000000U : 0U };
+#	else
+			const uint32_t sign{ (f < 0.0f) ? 0x80000000U : 0U };
+#	endif
+			if (!(f >= f)) {
+				return sign | 0x7FC00000U;
+			}
+			float magnitude{ (f < 0.0f) ? -f : f };
+
+			if (magnitude > FLT_MAX) {
+				return sign | 0x7F800000U;
+			}
+			if (!(magnitude > 0.0f)) {
+				return sign;
+			}
+
+			// Scale the magnitude into [1, 2). Each step is exact, as it is a factor of two.
+			int exponent{};
+
+			while (magnitude >= 2.0f) {
+				magnitude /= 2.0f;
+				++exponent;
+			}
+			while (magnitude < 1.0f) {
+				magnitude *= 2.0f;
+				--exponent;
+			}
+
+			if (exponent < -126) {
+				// Denormal: its mantissa is the value divided by 2^-149.
+				for (int i{}; i < exponent + 149; ++i) {
+					magnitude *= 2.0f;
+				}
+				return sign | static_cast<uint32_t>(magnitude);
+			}
+			return sign | (static_cast<uint32_t>(exponent + 127) << 23) |
+				static_cast<uint32_t>((magnitude - 1.0f) * 8388608.0f);
+#else
+			return bit_cast<uint32_t>(f);
+#endif
+		}
+
 		// Converts the 32 bits of a normal float or zero to the bits of a bfloat16.
 		static BIOVAULT_BFLOAT16_CONSTEXPR uint16_t convert_bits_of_normal_or_zero(
 			const uint32_t bits) {
@@ -93,6 +544,67 @@ namespace biovault {
 			>> 16;
 		}
 
+		// Returns all ones when the condition is true, and zero otherwise.
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint32_t make_mask(const bool condition) {
+			return uint32_t{ 0 } - uint32_t{ condition };
+		}
+
+		// Selects the bits of a where the mask is set, and the bits of b elsewhere.
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint32_t select(const uint32_t mask, const uint32_t a, const uint32_t b) {
+			return (mask & a) | (~mask & b);
+		}
+
+		// Converts the 32 bits of any float to the bits of a bfloat16, following the
+		// same rules as bfloat16_t(const float), but only by integer masks and selects,
+		// instead of a switch on std::fpclassify. A normal float is rounded by adding
+		// the specified bias (which must be less than 2^16) and truncating. (Written
+		// as a single return statement, to be usable as a C++11 constexpr function.)
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint16_t convert_bits_branchless(
+			const uint32_t bits, const uint32_t rounding_bias) {
+			return static_cast<uint16_t>(select(
+				// zero or denormal: sign preserving zero
+				make_mask((bits & 0x7F800000U) == 0), uint32_t{ bits >> 16 } & 0x8000U,
+				select(
+					// infinity or NaN: truncate, and force quiet NaN
+					make_mask((bits & 0x7F800000U) == 0x7F800000U),
+					uint32_t{ bits >> 16 } | (make_mask((bits & 0x007FFFFFU) != 0) & (1U << 6)),
+					// normal: add the rounding bias and truncate
+					uint32_t{ bits + rounding_bias } >> 16)));
+		}
+
+		// Branchless conversion, rounding to nearest even.
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint16_t convert_bits_branchless(const uint32_t bits) {
+			return convert_bits_branchless(bits, 0x7FFFU + (uint32_t{ bits >> 16 } & 1U));
+		}
+
+		// Returns the bits of a bfloat16 magnitude, or those of infinity, when they are beyond.
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint16_t saturate_to_infinity(const uint64_t bits) {
+			return static_cast<uint16_t>((bits < 0x7F80U) ? bits : 0x7F80U);
+		}
+
+		// Rounds the magnitude of a double (its 64 bits without the sign bit) to nearest
+		// even, directly to bfloat16, and rebiases its exponent. The magnitude must be
+		// at least 2^-126.
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint16_t round_magnitude_of_double(const uint64_t magnitude) {
+			return saturate_to_infinity(
+				((magnitude + ((uint64_t{ 1 } << 44) - 1) + ((magnitude >> 45) & 1U)) >> 45) - (uint64_t{ 1023 - 127 } << 7));
+		}
+
+		// Converts the 64 bits of any double to the bits of a bfloat16, rounding only
+		// once, and otherwise following the same rules as bfloat16_t(const float): a
+		// magnitude below the smallest normal float becomes sign preserving zero, and a
+		// NaN is truncated and quieted.
+		static BIOVAULT_BFLOAT16_CONSTEXPR uint16_t convert_double_bits(const uint64_t bits) {
+			return static_cast<uint16_t>(uint32_t{ static_cast<uint32_t>(bits >> 48) & 0x8000U } |
+				(((bits & 0x7FFFFFFFFFFFFFFFU) > 0x7FF0000000000000U) ?
+					// NaN: truncate, and force quiet NaN
+					(0x7FC0U | (static_cast<uint32_t>(bits >> 45) & 0x7FU)) :
+				(((bits & 0x7FFFFFFFFFFFFFFFU) < (uint64_t{ 1023 - 126 } << 52)) ?
+					// less than 2^-126 (FLT_MIN): zero
+					0U :
+					round_magnitude_of_double(bits & 0x7FFFFFFFFFFFFFFFU))));
+		}
+
 
 	public:
 		bfloat16_t() = default;
@@ -137,8 +649,50 @@ namespace biovault {
 				raw_bits_ = iraw[1];
 				break;
 			}
+			BIOVAULT_BFLOAT16_COUNT_CONVERSION(bit_cast<uint32_t>(f), raw_bits_);
+		}
+
+
+		// Supports narrowing (lossy) conversion from 32-bit float to bfloat16, using
+		// the specified rounding policy. The policies only affect normal floats.
+		bfloat16_t(const float f, round_to_nearest_even_t)
+			: raw_bits_{ convert_bits_branchless(bit_cast<uint32_t>(f)) }
+		{
+			BIOVAULT_BFLOAT16_COUNT_CONVERSION(bit_cast<uint32_t>(f), raw_bits_);
+		}
+
+		bfloat16_t(const float f, round_toward_zero_t)
+			: raw_bits_{ convert_bits_branchless(bit_cast<uint32_t>(f), 0) }
+		{
+			BIOVAULT_BFLOAT16_COUNT_CONVERSION(bit_cast<uint32_t>(f), raw_bits_);
 		}
 
+		bfloat16_t(const float f, stochastic_rounding& rounding)
+			: raw_bits_{ convert_bits_branchless(bit_cast<uint32_t>(f), rounding.next_rounding_bias()) }
+		{
+			BIOVAULT_BFLOAT16_COUNT_CONVERSION(bit_cast<uint32_t>(f), raw_bits_);
+		}
+
+
+		// Supports narrowing (lossy) conversion from 64-bit double to bfloat16, rounding
+		// to nearest even directly, rather than rounding to float first (which would
+		// round twice). For each double that is exactly a float, it yields the same raw
+		// bits as bfloat16_t(const float). (Declared as a template, to avoid ambiguity
+		// for long double arguments, which still convert via float.)
+		// Note: This constructor is "explicit" by default, but can be adjusted
+		// to allow implicit conversion to bfloat16_t by defining the macro
+		// BIOVAULT_BFLOAT16_CONVERTING_CONSTRUCTORS.
+		template <typename DoubleType,
+			typename SFINAE = typename std::enable_if<
+			std::is_same<DoubleType, double>::value>::type,
+			typename = void>
+#ifndef BIOVAULT_BFLOAT16_CONVERTING_CONSTRUCTORS
+			explicit
+#endif
+			bfloat16_t(const DoubleType d)
+			: raw_bits_{ convert_double_bits(bit_cast<uint64_t>(d)) }
+		{
+		}
 
 		// Supports possibly narrowing (lossy) conversion from any integer type.
 		// Equivalent to bfloat16_t{static_cast<float>(i)}, but significantly faster.
@@ -157,10 +711,47 @@ namespace biovault {
 		{
 		}
 
+		// Converts from 32-bit float to bfloat16, yielding exactly the same raw bits as
+		// bfloat16_t(const float), but without any branches. Typically faster when the
+		// input mixes zeros, denormals and normal values.
+		static bfloat16_t from_float_branchless(const float f) {
+			return bfloat16_t(convert_bits_branchless(bit_cast<uint32_t>(f)), true);
+		}
+
+		// Branchless conversion that rounds a normal float by adding the specified
+		// bias (less than 2^16) before truncation: zero rounds toward zero, and a
+		// random bias rounds stochastically. Note: neither of the from_float_branchless
+		// functions is counted by BIOVAULT_BFLOAT16_INSTRUMENTATION.
+		static bfloat16_t from_float_branchless(const float f, const uint32_t rounding_bias) {
+			return bfloat16_t(convert_bits_branchless(bit_cast<uint32_t>(f), rounding_bias), true);
+		}
+
+		// Converts from 32-bit float to bfloat16 at compile-time (when
+		// BIOVAULT_BFLOAT16_HAS_CONSTEXPR_CONVERSION is defined), yielding the same
+		// raw bits as bfloat16_t(const float). Allows constant bfloat16 tables
+		// without dynamic initialization. At run-time, from_float_branchless(f) is
+		// typically faster, unless __builtin_bit_cast is supported by the compiler.
+		// Without __builtin_bit_cast (BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST undefined),
+		// the float is decomposed arithmetically, with the following exceptions: a
+		// NaN yields 0x7FC0 (or 0xFFC0 when negative), dropping its payload, and
+		// without __builtin_signbit (Visual C++), both -0.0f and a negative NaN lose
+		// their sign.
+		static BIOVAULT_BFLOAT16_CONSTEXPR_CONVERSION bfloat16_t from_float_constexpr(const float f) {
+			return bfloat16_t(convert_bits_branchless(constexpr_bit_cast(f)), true);
+		}
+
 		bfloat16_t& operator=(const float f) {
 			return (*this) = bfloat16_t{ f };
 		}
 
+		template <typename DoubleType,
+			typename SFINAE = typename std::enable_if<
+			std::is_same<DoubleType, double>::value>::type,
+			typename = void>
+			bfloat16_t& operator=(const DoubleType d) {
+			return (*this) = bfloat16_t{ d };
+		}
+
 		template <typename IntegerType,
 			typename SFINAE = typename std::enable_if<
 			std::is_integral<IntegerType>::value>::type>
@@ -183,6 +774,48 @@ namespace biovault {
 			return *this;
 		}
 
+		bfloat16_t& operator-=(const float a) {
+			(*this) = bfloat16_t{ float{*this} - a };
+			return *this;
+		}
+
+		bfloat16_t& operator*=(const float a) {
+			(*this) = bfloat16_t{ float{*this} * a };
+			return *this;
+		}
+
+		bfloat16_t& operator/=(const float a) {
+			(*this) = bfloat16_t{ float{*this} / a };
+			return *this;
+		}
+
+		// Compound assignment by a bfloat16, rounded once, like the corresponding
+		// arithmetic operator between two bfloat16 values.
+		bfloat16_t& operator+=(const bfloat16_t a) {
+			return (*this) = from_float_branchless(float{*this} + float{a});
+		}
+
+		bfloat16_t& operator-=(const bfloat16_t a) {
+			return (*this) = from_float_branchless(float{*this} - float{a});
+		}
+
+		bfloat16_t& operator*=(const bfloat16_t a) {
+			return (*this) = from_float_branchless(float{*this} * float{a});
+		}
+
+		bfloat16_t& operator/=(const bfloat16_t a) {
+			return (*this) = from_float_branchless(float{*this} / float{a});
+		}
+
+		// Negation only flips the sign bit (also of NaN), like for float.
+		BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t operator-() const {
+			return bfloat16_t(static_cast<uint16_t>(raw_bits_ ^ 0x8000U), true);
+		}
+
+		BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t operator+() const {
+			return *this;
+		}
+
 		friend BIOVAULT_BFLOAT16_CONSTEXPR uint16_t get_raw_bits(const bfloat16_t&);
 	};
 
@@ -195,6 +828,2041 @@ namespace biovault {
 
 	static_assert(sizeof(bfloat16_t) == 2, "bfloat16_t must be 2 bytes");
 
+
+	// Arithmetic between two bfloat16 values yields a bfloat16 value, computed in
+	// float and then rounded to nearest even. As float has more than twice the
+	// precision of bfloat16 plus two bits, this yields the correctly rounded result:
+	// the intermediate rounding to float never affects the final result.
+	// Arithmetic between a bfloat16 and any other arithmetic type still yields the
+	// same type and value as when the bfloat16 were converted to float first.
+
+	inline bfloat16_t operator+(const bfloat16_t a, const bfloat16_t b)
+	{
+		return bfloat16_t::from_float_branchless(float{ a } + float{ b });
+	}
+
+	inline bfloat16_t operator-(const bfloat16_t a, const bfloat16_t b)
+	{
+		return bfloat16_t::from_float_branchless(float{ a } - float{ b });
+	}
+
+	inline bfloat16_t operator*(const bfloat16_t a, const bfloat16_t b)
+	{
+		return bfloat16_t::from_float_branchless(float{ a } * float{ b });
+	}
+
+	inline bfloat16_t operator/(const bfloat16_t a, const bfloat16_t b)
+	{
+		return bfloat16_t::from_float_branchless(float{ a } / float{ b });
+	}
+
+#define BIOVAULT_BFLOAT16_MIXED_ARITHMETIC_OPERATOR(op) \
+	template <typename T, typename SFINAE = typename std::enable_if<std::is_arithmetic<T>::value>::type> \
+	auto operator op(const bfloat16_t a, const T b) -> decltype(float{} op b) \
+	{ \
+		return float{ a } op b; \
+	} \
+	template <typename T, typename SFINAE = typename std::enable_if<std::is_arithmetic<T>::value>::type> \
+	auto operator op(const T a, const bfloat16_t b) -> decltype(a op float{}) \
+	{ \
+		return a op float{ b }; \
+	}
+
+	BIOVAULT_BFLOAT16_MIXED_ARITHMETIC_OPERATOR(+)
+	BIOVAULT_BFLOAT16_MIXED_ARITHMETIC_OPERATOR(-)
+	BIOVAULT_BFLOAT16_MIXED_ARITHMETIC_OPERATOR(*)
+	BIOVAULT_BFLOAT16_MIXED_ARITHMETIC_OPERATOR(/)
+
+#undef BIOVAULT_BFLOAT16_MIXED_ARITHMETIC_OPERATOR
+
+
+	namespace detail {
+
+		inline BIOVAULT_BFLOAT16_CONSTEXPR bool is_nan_bits(const std::uint16_t bits)
+		{
+			return (bits & 0x7FFFU) > 0x7F80U;
+		}
+
+		inline BIOVAULT_BFLOAT16_CONSTEXPR bool are_both_zero_bits(const std::uint16_t a, const std::uint16_t b)
+		{
+			return ((a | b) & 0x7FFFU) == 0;
+		}
+
+		// Maps the raw bits of a bfloat16 onto an unsigned integer, such that the
+		// integers have the same order as the non-NaN values, and -0 precedes +0.
+		// Flips all bits of a negative value, and only the sign bit of a positive one.
+		inline BIOVAULT_BFLOAT16_CONSTEXPR std::uint16_t get_ordered_bits(const std::uint16_t bits)
+		{
+			return static_cast<std::uint16_t>(((bits & 0x8000U) != 0) ? ~bits : (bits | 0x8000U));
+		}
+
+		// The inverse of get_ordered_bits.
+		inline BIOVAULT_BFLOAT16_CONSTEXPR std::uint16_t get_bits_from_ordered_bits(const std::uint16_t ordered_bits)
+		{
+			return static_cast<std::uint16_t>(((ordered_bits & 0x8000U) != 0) ? (ordered_bits ^ 0x8000U) : ~ordered_bits);
+		}
+	}
+
+
+	// Comparison between two bfloat16 values, directly on their raw bits, yielding
+	// the same results as comparing them as float: NaN is unordered (so only !=
+	// yields true), and -0 equals +0. Comparison with any other arithmetic type is
+	// done as if the bfloat16 were converted to float first.
+
+	inline BIOVAULT_BFLOAT16_CONSTEXPR bool operator==(const bfloat16_t a, const bfloat16_t b)
+	{
+		return (!detail::is_nan_bits(get_raw_bits(a))) &&
+			((get_raw_bits(a) == get_raw_bits(b)) || detail::are_both_zero_bits(get_raw_bits(a), get_raw_bits(b)));
+	}
+
+	inline BIOVAULT_BFLOAT16_CONSTEXPR bool operator!=(const bfloat16_t a, const bfloat16_t b)
+	{
+		return !(a == b);
+	}
+
+	inline BIOVAULT_BFLOAT16_CONSTEXPR bool operator<(const bfloat16_t a, const bfloat16_t b)
+	{
+		return (!detail::is_nan_bits(get_raw_bits(a))) && (!detail::is_nan_bits(get_raw_bits(b))) &&
+			(!detail::are_both_zero_bits(get_raw_bits(a), get_raw_bits(b))) &&
+			(detail::get_ordered_bits(get_raw_bits(a)) < detail::get_ordered_bits(get_raw_bits(b)));
+	}
+
+	inline BIOVAULT_BFLOAT16_CONSTEXPR bool operator>(const bfloat16_t a, const bfloat16_t b)
+	{
+		return b < a;
+	}
+
+	inline BIOVAULT_BFLOAT16_CONSTEXPR bool operator<=(const bfloat16_t a, const bfloat16_t b)
+	{
+		return (a < b) || (a == b);
+	}
+
+	inline BIOVAULT_BFLOAT16_CONSTEXPR bool operator>=(const bfloat16_t a, const bfloat16_t b)
+	{
+		return b <= a;
+	}
+
+	// The mixed comparisons use the <cmath> comparison functions, which also avoid
+	// -Wfloat-equal warnings, and floating point exceptions for NaN.
+#define BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(op, expression) \
+	template <typename T, typename SFINAE = typename std::enable_if<std::is_arithmetic<T>::value>::type> \
+	bool operator op(const bfloat16_t a, const T b) \
+	{ \
+		using common_type = decltype(float{} + b); \
+		const auto x = static_cast<common_type>(float{ a }); \
+		const auto y = static_cast<common_type>(b); \
+		return expression; \
+	} \
+	template <typename T, typename SFINAE = typename std::enable_if<std::is_arithmetic<T>::value>::type> \
+	bool operator op(const T a, const bfloat16_t b) \
+	{ \
+		using common_type = decltype(a + float{}); \
+		const auto x = static_cast<common_type>(a); \
+		const auto y = static_cast<common_type>(float{ b }); \
+		return expression; \
+	}
+
+	BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(==, !(std::isunordered(x, y) || std::islessgreater(x, y)))
+	BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(!=, std::isunordered(x, y) || std::islessgreater(x, y))
+	BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(<, std::isless(x, y))
+	BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(>, std::isgreater(x, y))
+	BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(<=, std::islessequal(x, y))
+	BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR(>=, std::isgreaterequal(x, y))
+
+#undef BIOVAULT_BFLOAT16_MIXED_COMPARISON_OPERATOR
+
+
+	namespace detail {
+
+		// The SIMD kernels below implement exactly the same per-element rules as
+		// the bfloat16_t(const float) constructor:
+		// - zero and denormal: sign preserving zero (denormals go to zero)
+		// - infinity: truncate
+		// - NaN: truncate and set the MSB of the mantissa to force a quiet NaN
+		// - normal: round to nearest even and truncate
+		// The other rounding policies (toward zero and stochastic) only differ in
+		// the bias that is added to a normal float, before truncation.
+		// Each kernel processes as many elements as possible in SIMD registers,
+		// and leaves the remaining elements for the scalar tail loop.
+		//
+		// The widening kernels (from bfloat16 to float) just place the 16 bits
+		// of each bfloat16 in the upper half of a 32-bit float, which is lossless.
+
+		namespace scalar {
+
+			inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = bfloat16_t::from_float_branchless(src[i]);
+				}
+			}
+
+			inline void convert_toward_zero(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = bfloat16_t::from_float_branchless(src[i], 0);
+				}
+			}
+
+			inline void convert_stochastic(const float* const src, bfloat16_t* const dst, const std::size_t n,
+				stochastic_rounding& rounding)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = bfloat16_t::from_float_branchless(src[i], rounding.next_rounding_bias());
+				}
+			}
+
+			inline void convert(const bfloat16_t* const src, float* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					// Copy the bits directly, rather than calling operator float(), to
+					// ensure that signaling NaNs are preserved.
+					const std::uint32_t bits{ std::uint32_t{ get_raw_bits(src[i]) } << 16 };
+					std::memcpy(dst + i, &bits, sizeof(float));
+				}
+			}
+
+			inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				float result{};
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					result += float{ a[i] } * float{ b[i] };
+				}
+				return result;
+			}
+
+			inline void axpy(const float alpha, const bfloat16_t* const x, float* const y, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					y[i] += alpha * float{ x[i] };
+				}
+			}
+
+			// Kahan-compensated summation, like all the sum kernels. Note that the
+			// compensation yields NaN when the sum overflows, or when an element is
+			// infinite. The caller is responsible for handling that case, for example
+			// by sum_uncompensated.
+			inline float sum(const bfloat16_t* const src, const std::size_t n)
+			{
+				float sum{};
+				float compensation{};
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const float y{ float{ src[i] } - compensation };
+					const float t{ sum + y };
+					compensation = (t - sum) - y;
+					sum = t;
+				}
+				return sum - compensation;
+			}
+
+			inline float sum_uncompensated(const bfloat16_t* const src, const std::size_t n)
+			{
+				float sum{};
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					sum += float{ src[i] };
+				}
+				return sum;
+			}
+
+			// Returns a table of the bfloat16 values of all 256 values of an 8-bit integer
+			// type, indexed by their bits. Each of them converts exactly.
+			template <typename IntegerType>
+			std::array<bfloat16_t, 256> make_8_bit_conversion_table()
+			{
+				std::array<bfloat16_t, 256> table;
+
+				for (unsigned bits{}; bits < 256; ++bits)
+				{
+					table[bits] = bfloat16_t{ static_cast<IntegerType>(static_cast<std::uint8_t>(bits)) };
+				}
+				return table;
+			}
+
+			template <typename IntegerType>
+			const std::array<bfloat16_t, 256>& get_8_bit_conversion_table()
+			{
+				static const auto table = make_8_bit_conversion_table<IntegerType>();
+				return table;
+			}
+
+			template <typename IntegerType>
+			void convert_from_integers(const IntegerType* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = bfloat16_t{ src[i] };
+				}
+			}
+
+			inline void convert_from_integers(const std::uint8_t* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				const auto& table = get_8_bit_conversion_table<std::uint8_t>();
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = table[src[i]];
+				}
+			}
+
+			inline void convert_from_integers(const std::int8_t* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				const auto& table = get_8_bit_conversion_table<std::int8_t>();
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = table[static_cast<std::uint8_t>(src[i])];
+				}
+			}
+
+			inline void convert(const double* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = bfloat16_t(src[i]);
+				}
+			}
+		}
+
+#ifdef BIOVAULT_BFLOAT16_SSE2
+		namespace sse2 {
+
+			// Returns the bits of four bfloat16 values, in the lower halves of 32-bit lanes.
+			// Normal floats are rounded by adding the specified bias, and truncating.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i convert_to_bits_of_bfloat16(
+				const __m128 f, const __m128i rounding_bias)
+			{
+				const __m128i bits = _mm_castps_si128(f);
+				const __m128i exponent = _mm_and_si128(bits, _mm_set1_epi32(0x7F800000));
+				const __m128i upper = _mm_srli_epi32(bits, 16);
+				const __m128i rounded = _mm_srli_epi32(_mm_add_epi32(bits, rounding_bias), 16);
+
+				const __m128i is_zero_or_denormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+				const __m128i is_infinite_or_nan = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x7F800000));
+				const __m128i is_nan = _mm_andnot_si128(
+					_mm_cmpeq_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_setzero_si128()),
+					is_infinite_or_nan);
+
+				const __m128i special = _mm_or_si128(upper, _mm_and_si128(is_nan, _mm_set1_epi32(1 << 6)));
+				const __m128i signed_zero = _mm_and_si128(upper, _mm_set1_epi32(0x8000));
+
+				const __m128i result = _mm_or_si128(
+					_mm_and_si128(is_infinite_or_nan, special),
+					_mm_andnot_si128(is_infinite_or_nan, rounded));
+				return _mm_or_si128(
+					_mm_and_si128(is_zero_or_denormal, signed_zero),
+					_mm_andnot_si128(is_zero_or_denormal, result));
+			}
+
+			// Returns the bits of four bfloat16 values, rounded to nearest even.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i convert_to_bits_of_bfloat16(const __m128 f)
+			{
+				const __m128i lsb = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(f), 16), _mm_set1_epi32(1));
+				return convert_to_bits_of_bfloat16(f, _mm_add_epi32(_mm_set1_epi32(0x7FFF), lsb));
+			}
+
+			// Multiplies the 32-bit lanes, keeping the lower 32 bits of each product.
+			// (SSE2 does not have _mm_mullo_epi32, which is SSE4.1.)
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i multiply_low(const __m128i a, const __m128i b)
+			{
+				const __m128i even = _mm_mul_epu32(a, b);
+				const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+				return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08), _mm_shuffle_epi32(odd, 0x08));
+			}
+
+			// Vectorized equivalent of stochastic_rounding::get_rounding_bias(key, counter).
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i get_stochastic_rounding_bias(
+				const __m128i key, const __m128i counter)
+			{
+				__m128i x = _mm_xor_si128(counter, key);
+				x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+				x = multiply_low(x, _mm_set1_epi32(0x7FEB352D));
+				x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+				x = multiply_low(x, _mm_set1_epi32(static_cast<int>(0x846CA68BU)));
+				x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+				return _mm_srli_epi32(x, 16);
+			}
+
+			// Widens the lower four bfloat16 values of the argument to float.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128 widen_low(const __m128i bits)
+			{
+				return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), bits));
+			}
+
+			// Widens the upper four bfloat16 values of the argument to float.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128 widen_high(const __m128i bits)
+			{
+				return _mm_castsi128_ps(_mm_unpackhi_epi16(_mm_setzero_si128(), bits));
+			}
+
+			// Packs the lower halves of the 32-bit lanes of the arguments into 16-bit lanes.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i pack(const __m128i low, const __m128i high)
+			{
+				// SSE2 only has a signed saturating pack, so sign-extend the lower halves first.
+				return _mm_packs_epi32(
+					_mm_srai_epi32(_mm_slli_epi32(low, 16), 16),
+					_mm_srai_epi32(_mm_slli_epi32(high, 16), 16));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i low = convert_to_bits_of_bfloat16(_mm_loadu_ps(src + i));
+					const __m128i high = convert_to_bits_of_bfloat16(_mm_loadu_ps(src + i + 4));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pack(low, high));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void convert_toward_zero(
+				const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i low = convert_to_bits_of_bfloat16(_mm_loadu_ps(src + i), zero);
+					const __m128i high = convert_to_bits_of_bfloat16(_mm_loadu_ps(src + i + 4), zero);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pack(low, high));
+				}
+				scalar::convert_toward_zero(src + i, dst + i, n - i);
+			}
+
+			// Assumes that the upper 32 bits of the counter of the rounding policy do not
+			// change while converting the n elements.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void convert_stochastic(
+				const float* const src, bfloat16_t* const dst, const std::size_t n, stochastic_rounding& rounding)
+			{
+				const __m128i key = _mm_set1_epi32(static_cast<int>(rounding.get_key()));
+				__m128i counter = _mm_add_epi32(
+					_mm_set1_epi32(static_cast<int>(rounding.get_counter())), _mm_setr_epi32(0, 1, 2, 3));
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i low_bias = get_stochastic_rounding_bias(key, counter);
+					counter = _mm_add_epi32(counter, _mm_set1_epi32(4));
+					const __m128i high_bias = get_stochastic_rounding_bias(key, counter);
+					counter = _mm_add_epi32(counter, _mm_set1_epi32(4));
+
+					const __m128i low = convert_to_bits_of_bfloat16(_mm_loadu_ps(src + i), low_bias);
+					const __m128i high = convert_to_bits_of_bfloat16(_mm_loadu_ps(src + i + 4), high_bias);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pack(low, high));
+				}
+				rounding.discard(i);
+				scalar::convert_stochastic(src + i, dst + i, n - i, rounding);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void convert(const bfloat16_t* const src, float* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					_mm_storeu_ps(dst + i, widen_low(bits));
+					_mm_storeu_ps(dst + i + 4, widen_high(bits));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			// Returns the sum of the four lanes.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline float reduce_add(const __m128 v)
+			{
+				const __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+				return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				__m128 sum_low = _mm_setzero_ps();
+				__m128 sum_high = _mm_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i a_bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+					const __m128i b_bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+					sum_low = _mm_add_ps(sum_low, _mm_mul_ps(widen_low(a_bits), widen_low(b_bits)));
+					sum_high = _mm_add_ps(sum_high, _mm_mul_ps(widen_high(a_bits), widen_high(b_bits)));
+				}
+				return reduce_add(_mm_add_ps(sum_low, sum_high)) + scalar::dot(a + i, b + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void axpy(
+				const float alpha, const bfloat16_t* const x, float* const y, const std::size_t n)
+			{
+				const __m128 alpha_vector = _mm_set1_ps(alpha);
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i x_bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+					_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(alpha_vector, widen_low(x_bits))));
+					_mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(alpha_vector, widen_high(x_bits))));
+				}
+				scalar::axpy(alpha, x + i, y + i, n - i);
+			}
+
+			// One step of Kahan summation for each lane.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void add_compensated(__m128& sum, __m128& compensation, const __m128 x)
+			{
+				const __m128 y = _mm_sub_ps(x, compensation);
+				const __m128 t = _mm_add_ps(sum, y);
+				compensation = _mm_sub_ps(_mm_sub_ps(t, sum), y);
+				sum = t;
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline float sum(const bfloat16_t* const src, const std::size_t n)
+			{
+				__m128 sum_low = _mm_setzero_ps();
+				__m128 sum_high = _mm_setzero_ps();
+				__m128 compensation_low = _mm_setzero_ps();
+				__m128 compensation_high = _mm_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					add_compensated(sum_low, compensation_low, widen_low(bits));
+					add_compensated(sum_high, compensation_high, widen_high(bits));
+				}
+				add_compensated(sum_low, compensation_low, _mm_sub_ps(sum_high, compensation_high));
+				return reduce_add(_mm_sub_ps(sum_low, compensation_low)) + scalar::sum(src + i, n - i);
+			}
+
+			// Returns the bits of four bfloat16 values, rounded to nearest even, assuming
+			// that the floats are either normal or zero (as they are, when converted from
+			// an integer type).
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i convert_normal_or_zero_to_bits_of_bfloat16(const __m128 f)
+			{
+				const __m128i bits = _mm_castps_si128(f);
+				const __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+				return _mm_srli_epi32(_mm_add_epi32(bits, _mm_add_epi32(_mm_set1_epi32(0x7FFF), lsb)), 16);
+			}
+
+			// Loads four integers, and widens them to 32-bit lanes.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i load_as_int32(const std::uint8_t* const src)
+			{
+				std::int32_t four_bytes;
+				std::memcpy(&four_bytes, src, sizeof(four_bytes));
+				const __m128i zero = _mm_setzero_si128();
+				return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(four_bytes), zero), zero);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i load_as_int32(const std::int8_t* const src)
+			{
+				std::int32_t four_bytes;
+				std::memcpy(&four_bytes, src, sizeof(four_bytes));
+				const __m128i bytes = _mm_cvtsi32_si128(four_bytes);
+				const __m128i words = _mm_unpacklo_epi8(bytes, bytes);
+				// Sign-extend, by an arithmetic shift of each byte placed in the upper byte of a lane.
+				return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 24);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i load_as_int32(const std::uint16_t* const src)
+			{
+				return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)), _mm_setzero_si128());
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i load_as_int32(const std::int16_t* const src)
+			{
+				const __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+				return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i load_as_int32(const std::int32_t* const src)
+			{
+				return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			}
+
+			template <typename IntegerType>
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void convert_from_integers(
+				const IntegerType* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128i low = convert_normal_or_zero_to_bits_of_bfloat16(_mm_cvtepi32_ps(load_as_int32(src + i)));
+					const __m128i high = convert_normal_or_zero_to_bits_of_bfloat16(_mm_cvtepi32_ps(load_as_int32(src + i + 4)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pack(low, high));
+				}
+				scalar::convert_from_integers(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			// Returns the bits of eight bfloat16 values, in the lower halves of 32-bit lanes.
+			// Normal floats are rounded by adding the specified bias, and truncating.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i convert_to_bits_of_bfloat16(
+				const __m256 f, const __m256i rounding_bias)
+			{
+				const __m256i bits = _mm256_castps_si256(f);
+				const __m256i exponent = _mm256_and_si256(bits, _mm256_set1_epi32(0x7F800000));
+				const __m256i upper = _mm256_srli_epi32(bits, 16);
+				const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, rounding_bias), 16);
+
+				const __m256i is_zero_or_denormal = _mm256_cmpeq_epi32(exponent, _mm256_setzero_si256());
+				const __m256i is_infinite_or_nan = _mm256_cmpeq_epi32(exponent, _mm256_set1_epi32(0x7F800000));
+				const __m256i is_nan = _mm256_andnot_si256(
+					_mm256_cmpeq_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_setzero_si256()),
+					is_infinite_or_nan);
+
+				const __m256i special = _mm256_or_si256(upper, _mm256_and_si256(is_nan, _mm256_set1_epi32(1 << 6)));
+				const __m256i signed_zero = _mm256_and_si256(upper, _mm256_set1_epi32(0x8000));
+
+				return _mm256_blendv_epi8(
+					_mm256_blendv_epi8(rounded, special, is_infinite_or_nan),
+					signed_zero,
+					is_zero_or_denormal);
+			}
+
+			// Returns the bits of eight bfloat16 values, rounded to nearest even.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i convert_to_bits_of_bfloat16(const __m256 f)
+			{
+				const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(f), 16), _mm256_set1_epi32(1));
+				return convert_to_bits_of_bfloat16(f, _mm256_add_epi32(_mm256_set1_epi32(0x7FFF), lsb));
+			}
+
+			// Vectorized equivalent of stochastic_rounding::get_rounding_bias(key, counter).
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i get_stochastic_rounding_bias(
+				const __m256i key, const __m256i counter)
+			{
+				__m256i x = _mm256_xor_si256(counter, key);
+				x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+				x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7FEB352D));
+				x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+				x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(0x846CA68BU)));
+				x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+				return _mm256_srli_epi32(x, 16);
+			}
+
+			// Loads eight bfloat16 values, and widens them to float.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256 load_as_float(const bfloat16_t* const src)
+			{
+				const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(bits), 16));
+			}
+
+			// Packs the lower halves of the 32-bit lanes of the arguments into 16-bit lanes.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i pack(const __m256i low, const __m256i high)
+			{
+				// _mm256_packus_epi32 packs per 128-bit lane, so reorder the 64-bit quarters afterwards.
+				return _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256i low = convert_to_bits_of_bfloat16(_mm256_loadu_ps(src + i));
+					const __m256i high = convert_to_bits_of_bfloat16(_mm256_loadu_ps(src + i + 8));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low, high));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert_toward_zero(
+				const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256i low = convert_to_bits_of_bfloat16(_mm256_loadu_ps(src + i), zero);
+					const __m256i high = convert_to_bits_of_bfloat16(_mm256_loadu_ps(src + i + 8), zero);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low, high));
+				}
+				scalar::convert_toward_zero(src + i, dst + i, n - i);
+			}
+
+			// Assumes that the upper 32 bits of the counter of the rounding policy do not
+			// change while converting the n elements.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert_stochastic(
+				const float* const src, bfloat16_t* const dst, const std::size_t n, stochastic_rounding& rounding)
+			{
+				const __m256i key = _mm256_set1_epi32(static_cast<int>(rounding.get_key()));
+				__m256i counter = _mm256_add_epi32(
+					_mm256_set1_epi32(static_cast<int>(rounding.get_counter())), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256i low_bias = get_stochastic_rounding_bias(key, counter);
+					counter = _mm256_add_epi32(counter, _mm256_set1_epi32(8));
+					const __m256i high_bias = get_stochastic_rounding_bias(key, counter);
+					counter = _mm256_add_epi32(counter, _mm256_set1_epi32(8));
+
+					const __m256i low = convert_to_bits_of_bfloat16(_mm256_loadu_ps(src + i), low_bias);
+					const __m256i high = convert_to_bits_of_bfloat16(_mm256_loadu_ps(src + i + 8), high_bias);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low, high));
+				}
+				rounding.discard(i);
+				scalar::convert_stochastic(src + i, dst + i, n - i, rounding);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert(const bfloat16_t* const src, float* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					_mm256_storeu_ps(dst + i, load_as_float(src + i));
+					_mm256_storeu_ps(dst + i + 8, load_as_float(src + i + 8));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			// Returns the sum of the eight lanes.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline float reduce_add(const __m256 v)
+			{
+				const __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+				const __m128 sum2 = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+				return _mm_cvtss_f32(_mm_add_ss(sum2, _mm_shuffle_ps(sum2, sum2, 0x55)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				__m256 sum0 = _mm256_setzero_ps();
+				__m256 sum1 = _mm256_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					sum0 = _mm256_fmadd_ps(load_as_float(a + i), load_as_float(b + i), sum0);
+					sum1 = _mm256_fmadd_ps(load_as_float(a + i + 8), load_as_float(b + i + 8), sum1);
+				}
+				return reduce_add(_mm256_add_ps(sum0, sum1)) + scalar::dot(a + i, b + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void axpy(
+				const float alpha, const bfloat16_t* const x, float* const y, const std::size_t n)
+			{
+				const __m256 alpha_vector = _mm256_set1_ps(alpha);
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					_mm256_storeu_ps(y + i, _mm256_fmadd_ps(alpha_vector, load_as_float(x + i), _mm256_loadu_ps(y + i)));
+					_mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(alpha_vector, load_as_float(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+				}
+				scalar::axpy(alpha, x + i, y + i, n - i);
+			}
+
+			// One step of Kahan summation for each lane.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void add_compensated(__m256& sum, __m256& compensation, const __m256 x)
+			{
+				const __m256 y = _mm256_sub_ps(x, compensation);
+				const __m256 t = _mm256_add_ps(sum, y);
+				compensation = _mm256_sub_ps(_mm256_sub_ps(t, sum), y);
+				sum = t;
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline float sum(const bfloat16_t* const src, const std::size_t n)
+			{
+				__m256 sum0 = _mm256_setzero_ps();
+				__m256 sum1 = _mm256_setzero_ps();
+				__m256 compensation0 = _mm256_setzero_ps();
+				__m256 compensation1 = _mm256_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					add_compensated(sum0, compensation0, load_as_float(src + i));
+					add_compensated(sum1, compensation1, load_as_float(src + i + 8));
+				}
+				add_compensated(sum0, compensation0, _mm256_sub_ps(sum1, compensation1));
+				return reduce_add(_mm256_sub_ps(sum0, compensation0)) + scalar::sum(src + i, n - i);
+			}
+
+			// Returns the bits of eight bfloat16 values, rounded to nearest even, assuming
+			// that the floats are either normal or zero.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i convert_normal_or_zero_to_bits_of_bfloat16(const __m256 f)
+			{
+				const __m256i bits = _mm256_castps_si256(f);
+				const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+				return _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(_mm256_set1_epi32(0x7FFF), lsb)), 16);
+			}
+
+			// Loads eight integers, and widens them to 32-bit lanes.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i load_as_int32(const std::uint8_t* const src)
+			{
+				return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i load_as_int32(const std::int8_t* const src)
+			{
+				return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i load_as_int32(const std::uint16_t* const src)
+			{
+				return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i load_as_int32(const std::int16_t* const src)
+			{
+				return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i load_as_int32(const std::int32_t* const src)
+			{
+				return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+			}
+
+			template <typename IntegerType>
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert_from_integers(
+				const IntegerType* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256i low = convert_normal_or_zero_to_bits_of_bfloat16(_mm256_cvtepi32_ps(load_as_int32(src + i)));
+					const __m256i high = convert_normal_or_zero_to_bits_of_bfloat16(_mm256_cvtepi32_ps(load_as_int32(src + i + 8)));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low, high));
+				}
+				scalar::convert_from_integers(src + i, dst + i, n - i);
+			}
+
+			// Returns the bits of four bfloat16 values, in the lower 16 bits of 64-bit lanes,
+			// converted from doubles exactly like bfloat16_t(const double).
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256i convert_to_bits_of_bfloat16(const __m256d d)
+			{
+				const __m256i bits = _mm256_castpd_si256(d);
+				const __m256i magnitude = _mm256_and_si256(bits, _mm256_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+				const __m256i sign = _mm256_and_si256(_mm256_srli_epi64(bits, 48), _mm256_set1_epi64x(0x8000));
+				const __m256i lsb = _mm256_and_si256(_mm256_srli_epi64(magnitude, 45), _mm256_set1_epi64x(1));
+				const __m256i rounded = _mm256_sub_epi64(
+					_mm256_srli_epi64(_mm256_add_epi64(_mm256_add_epi64(magnitude, _mm256_set1_epi64x(0xFFFFFFFFFFF)), lsb), 45),
+					_mm256_set1_epi64x(std::int64_t{ 1023 - 127 } << 7));
+				const __m256i infinity = _mm256_set1_epi64x(0x7F80);
+				const __m256i nan = _mm256_or_si256(_mm256_set1_epi64x(0x7FC0),
+					_mm256_and_si256(_mm256_srli_epi64(magnitude, 45), _mm256_set1_epi64x(0x7F)));
+
+				// The magnitudes are less than 2^63, so the signed comparisons are fine.
+				const __m256i is_nan = _mm256_cmpgt_epi64(magnitude, _mm256_set1_epi64x(0x7FF0000000000000));
+				const __m256i is_normal = _mm256_cmpgt_epi64(magnitude, _mm256_set1_epi64x((std::int64_t{ 1023 - 126 } << 52) - 1));
+				const __m256i saturated = _mm256_blendv_epi8(rounded, infinity, _mm256_cmpgt_epi64(rounded, infinity));
+				return _mm256_or_si256(sign,
+					_mm256_and_si256(is_normal, _mm256_blendv_epi8(saturated, nan, is_nan)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert(const double* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				// Selects the lower 32 bits of each 64-bit lane.
+				const __m256i lower_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m256i low = convert_to_bits_of_bfloat16(_mm256_loadu_pd(src + i));
+					const __m256i high = convert_to_bits_of_bfloat16(_mm256_loadu_pd(src + i + 4));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi32(
+						_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(low, lower_halves)),
+						_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(high, lower_halves))));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			// Returns the bits of sixteen bfloat16 values, in the lower halves of 32-bit lanes.
+			// Normal floats are rounded by adding the specified bias, and truncating.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i convert_to_bits_of_bfloat16(
+				const __m512 f, const __m512i rounding_bias)
+			{
+				const __m512i bits = _mm512_castps_si512(f);
+				const __m512i exponent = _mm512_and_si512(bits, _mm512_set1_epi32(0x7F800000));
+				const __m512i upper = _mm512_srli_epi32(bits, 16);
+				const __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(bits, rounding_bias), 16);
+
+				const __mmask16 is_zero_or_denormal = _mm512_cmpeq_epi32_mask(exponent, _mm512_setzero_si512());
+				const __mmask16 is_infinite_or_nan = _mm512_cmpeq_epi32_mask(exponent, _mm512_set1_epi32(0x7F800000));
+				const __mmask16 is_nan = _mm512_mask_test_epi32_mask(
+					is_infinite_or_nan, bits, _mm512_set1_epi32(0x007FFFFF));
+
+				const __m512i special = _mm512_mask_or_epi32(upper, is_nan, upper, _mm512_set1_epi32(1 << 6));
+				const __m512i signed_zero = _mm512_and_si512(upper, _mm512_set1_epi32(0x8000));
+
+				return _mm512_mask_mov_epi32(
+					_mm512_mask_mov_epi32(rounded, is_infinite_or_nan, special),
+					is_zero_or_denormal,
+					signed_zero);
+			}
+
+			// Returns the bits of sixteen bfloat16 values, rounded to nearest even.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i convert_to_bits_of_bfloat16(const __m512 f)
+			{
+				const __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(_mm512_castps_si512(f), 16), _mm512_set1_epi32(1));
+				return convert_to_bits_of_bfloat16(f, _mm512_add_epi32(_mm512_set1_epi32(0x7FFF), lsb));
+			}
+
+			// Loads sixteen bfloat16 values, and widens them to float.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512 load_as_float(const bfloat16_t* const src)
+			{
+				const __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+				return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(bits), 16));
+			}
+
+			// Vectorized equivalent of stochastic_rounding::get_rounding_bias(key, counter).
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i get_stochastic_rounding_bias(
+				const __m512i key, const __m512i counter)
+			{
+				__m512i x = _mm512_xor_si512(counter, key);
+				x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+				x = _mm512_mullo_epi32(x, _mm512_set1_epi32(0x7FEB352D));
+				x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 15));
+				x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(0x846CA68BU)));
+				x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+				return _mm512_srli_epi32(x, 16);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+						_mm512_cvtepi32_epi16(convert_to_bits_of_bfloat16(_mm512_loadu_ps(src + i))));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert_toward_zero(
+				const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				const __m512i zero = _mm512_setzero_si512();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+						_mm512_cvtepi32_epi16(convert_to_bits_of_bfloat16(_mm512_loadu_ps(src + i), zero)));
+				}
+				scalar::convert_toward_zero(src + i, dst + i, n - i);
+			}
+
+			// Assumes that the upper 32 bits of the counter of the rounding policy do not
+			// change while converting the n elements.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert_stochastic(
+				const float* const src, bfloat16_t* const dst, const std::size_t n, stochastic_rounding& rounding)
+			{
+				const __m512i key = _mm512_set1_epi32(static_cast<int>(rounding.get_key()));
+				__m512i counter = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(rounding.get_counter())),
+					_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m512i bias = get_stochastic_rounding_bias(key, counter);
+					counter = _mm512_add_epi32(counter, _mm512_set1_epi32(16));
+
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+						_mm512_cvtepi32_epi16(convert_to_bits_of_bfloat16(_mm512_loadu_ps(src + i), bias)));
+				}
+				rounding.discard(i);
+				scalar::convert_stochastic(src + i, dst + i, n - i, rounding);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert(const bfloat16_t* const src, float* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 32 <= n; i += 32)
+				{
+					_mm512_storeu_ps(dst + i, load_as_float(src + i));
+					_mm512_storeu_ps(dst + i + 16, load_as_float(src + i + 16));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				__m512 sum0 = _mm512_setzero_ps();
+				__m512 sum1 = _mm512_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 32 <= n; i += 32)
+				{
+					sum0 = _mm512_fmadd_ps(load_as_float(a + i), load_as_float(b + i), sum0);
+					sum1 = _mm512_fmadd_ps(load_as_float(a + i + 16), load_as_float(b + i + 16), sum1);
+				}
+				return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1)) + scalar::dot(a + i, b + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void axpy(
+				const float alpha, const bfloat16_t* const x, float* const y, const std::size_t n)
+			{
+				const __m512 alpha_vector = _mm512_set1_ps(alpha);
+				std::size_t i{};
+
+				for (; i + 32 <= n; i += 32)
+				{
+					_mm512_storeu_ps(y + i, _mm512_fmadd_ps(alpha_vector, load_as_float(x + i), _mm512_loadu_ps(y + i)));
+					_mm512_storeu_ps(y + i + 16, _mm512_fmadd_ps(alpha_vector, load_as_float(x + i + 16), _mm512_loadu_ps(y + i + 16)));
+				}
+				scalar::axpy(alpha, x + i, y + i, n - i);
+			}
+
+			// One step of Kahan summation for each lane.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void add_compensated(__m512& sum, __m512& compensation, const __m512 x)
+			{
+				const __m512 y = _mm512_sub_ps(x, compensation);
+				const __m512 t = _mm512_add_ps(sum, y);
+				compensation = _mm512_sub_ps(_mm512_sub_ps(t, sum), y);
+				sum = t;
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline float sum(const bfloat16_t* const src, const std::size_t n)
+			{
+				__m512 sum0 = _mm512_setzero_ps();
+				__m512 sum1 = _mm512_setzero_ps();
+				__m512 compensation0 = _mm512_setzero_ps();
+				__m512 compensation1 = _mm512_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 32 <= n; i += 32)
+				{
+					add_compensated(sum0, compensation0, load_as_float(src + i));
+					add_compensated(sum1, compensation1, load_as_float(src + i + 16));
+				}
+				add_compensated(sum0, compensation0, _mm512_sub_ps(sum1, compensation1));
+				return _mm512_reduce_add_ps(_mm512_sub_ps(sum0, compensation0)) + scalar::sum(src + i, n - i);
+			}
+
+			// Returns the bits of sixteen bfloat16 values, rounded to nearest even, assuming
+			// that the floats are either normal or zero.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i convert_normal_or_zero_to_bits_of_bfloat16(const __m512 f)
+			{
+				const __m512i bits = _mm512_castps_si512(f);
+				const __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+				return _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(_mm512_set1_epi32(0x7FFF), lsb)), 16);
+			}
+
+			// Loads sixteen integers, and widens them to 32-bit lanes.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i load_as_int32(const std::uint8_t* const src)
+			{
+				return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i load_as_int32(const std::int8_t* const src)
+			{
+				return _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i load_as_int32(const std::uint16_t* const src)
+			{
+				return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i load_as_int32(const std::int16_t* const src)
+			{
+				return _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i load_as_int32(const std::int32_t* const src)
+			{
+				return _mm512_loadu_si512(src);
+			}
+
+			template <typename IntegerType>
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert_from_integers(
+				const IntegerType* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi32_epi16(
+						convert_normal_or_zero_to_bits_of_bfloat16(_mm512_cvtepi32_ps(load_as_int32(src + i)))));
+				}
+				scalar::convert_from_integers(src + i, dst + i, n - i);
+			}
+
+			// Returns the bits of eight bfloat16 values, in the lower 16 bits of 64-bit lanes,
+			// converted from doubles exactly like bfloat16_t(const double).
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512i convert_to_bits_of_bfloat16(const __m512d d)
+			{
+				const __m512i bits = _mm512_castpd_si512(d);
+				const __m512i magnitude = _mm512_and_si512(bits, _mm512_set1_epi64(0x7FFFFFFFFFFFFFFF));
+				const __m512i sign = _mm512_and_si512(_mm512_srli_epi64(bits, 48), _mm512_set1_epi64(0x8000));
+				const __m512i lsb = _mm512_and_si512(_mm512_srli_epi64(magnitude, 45), _mm512_set1_epi64(1));
+				const __m512i rounded = _mm512_sub_epi64(
+					_mm512_srli_epi64(_mm512_add_epi64(_mm512_add_epi64(magnitude, _mm512_set1_epi64(0xFFFFFFFFFFF)), lsb), 45),
+					_mm512_set1_epi64(std::int64_t{ 1023 - 127 } << 7));
+				const __m512i nan = _mm512_or_si512(_mm512_set1_epi64(0x7FC0),
+					_mm512_and_si512(_mm512_srli_epi64(magnitude, 45), _mm512_set1_epi64(0x7F)));
+
+				const __mmask8 is_nan = _mm512_cmpgt_epu64_mask(magnitude, _mm512_set1_epi64(0x7FF0000000000000));
+				const __mmask8 is_normal = _mm512_cmpge_epu64_mask(magnitude, _mm512_set1_epi64(std::int64_t{ 1023 - 126 } << 52));
+				const __m512i saturated = _mm512_min_epu64(rounded, _mm512_set1_epi64(0x7F80));
+				return _mm512_or_si512(sign, _mm512_maskz_mov_epi64(is_normal, _mm512_mask_mov_epi64(saturated, is_nan, nan)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert(const double* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m512i low = convert_to_bits_of_bfloat16(_mm512_loadu_pd(src + i));
+					const __m512i high = convert_to_bits_of_bfloat16(_mm512_loadu_pd(src + i + 8));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_inserti128_si256(
+						_mm256_castsi128_si256(_mm512_cvtepi64_epi16(low)), _mm512_cvtepi64_epi16(high), 1));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON
+		namespace neon {
+
+			// Returns the bits of four bfloat16 values, in the lower halves of 32-bit lanes.
+			// Normal floats are rounded by adding the specified bias, and truncating.
+			inline uint32x4_t convert_to_bits_of_bfloat16(const float32x4_t f, const uint32x4_t rounding_bias)
+			{
+				const uint32x4_t bits = vreinterpretq_u32_f32(f);
+				const uint32x4_t exponent = vandq_u32(bits, vdupq_n_u32(0x7F800000));
+				const uint32x4_t upper = vshrq_n_u32(bits, 16);
+				const uint32x4_t rounded = vshrq_n_u32(vaddq_u32(bits, rounding_bias), 16);
+
+				const uint32x4_t is_zero_or_denormal = vceqq_u32(exponent, vdupq_n_u32(0));
+				const uint32x4_t is_infinite_or_nan = vceqq_u32(exponent, vdupq_n_u32(0x7F800000));
+				const uint32x4_t is_nan = vandq_u32(is_infinite_or_nan, vtstq_u32(bits, vdupq_n_u32(0x007FFFFF)));
+
+				const uint32x4_t special = vorrq_u32(upper, vandq_u32(is_nan, vdupq_n_u32(1 << 6)));
+				const uint32x4_t signed_zero = vandq_u32(upper, vdupq_n_u32(0x8000));
+
+				return vbslq_u32(is_zero_or_denormal, signed_zero,
+					vbslq_u32(is_infinite_or_nan, special, rounded));
+			}
+
+			// Returns the bits of four bfloat16 values, rounded to nearest even.
+			inline uint32x4_t convert_to_bits_of_bfloat16(const float32x4_t f)
+			{
+				const uint32x4_t lsb = vandq_u32(vshrq_n_u32(vreinterpretq_u32_f32(f), 16), vdupq_n_u32(1));
+				return convert_to_bits_of_bfloat16(f, vaddq_u32(vdupq_n_u32(0x7FFF), lsb));
+			}
+
+			// Vectorized equivalent of stochastic_rounding::get_rounding_bias(key, counter).
+			inline uint32x4_t get_stochastic_rounding_bias(const uint32x4_t key, const uint32x4_t counter)
+			{
+				uint32x4_t x = veorq_u32(counter, key);
+				x = veorq_u32(x, vshrq_n_u32(x, 16));
+				x = vmulq_u32(x, vdupq_n_u32(0x7FEB352DU));
+				x = veorq_u32(x, vshrq_n_u32(x, 15));
+				x = vmulq_u32(x, vdupq_n_u32(0x846CA68BU));
+				x = veorq_u32(x, vshrq_n_u32(x, 16));
+				return vshrq_n_u32(x, 16);
+			}
+
+			inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint32x4_t low = convert_to_bits_of_bfloat16(vld1q_f32(src + i));
+					const uint32x4_t high = convert_to_bits_of_bfloat16(vld1q_f32(src + i + 4));
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i), vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			inline void convert_toward_zero(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint32x4_t low = convert_to_bits_of_bfloat16(vld1q_f32(src + i), vdupq_n_u32(0));
+					const uint32x4_t high = convert_to_bits_of_bfloat16(vld1q_f32(src + i + 4), vdupq_n_u32(0));
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i), vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+				}
+				scalar::convert_toward_zero(src + i, dst + i, n - i);
+			}
+
+			// Assumes that the upper 32 bits of the counter of the rounding policy do not
+			// change while converting the n elements.
+			inline void convert_stochastic(
+				const float* const src, bfloat16_t* const dst, const std::size_t n, stochastic_rounding& rounding)
+			{
+				static const std::uint32_t lane_offsets[] = { 0, 1, 2, 3 };
+				const uint32x4_t key = vdupq_n_u32(rounding.get_key());
+				uint32x4_t counter = vaddq_u32(
+					vdupq_n_u32(static_cast<std::uint32_t>(rounding.get_counter())), vld1q_u32(lane_offsets));
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint32x4_t low_bias = get_stochastic_rounding_bias(key, counter);
+					counter = vaddq_u32(counter, vdupq_n_u32(4));
+					const uint32x4_t high_bias = get_stochastic_rounding_bias(key, counter);
+					counter = vaddq_u32(counter, vdupq_n_u32(4));
+
+					const uint32x4_t low = convert_to_bits_of_bfloat16(vld1q_f32(src + i), low_bias);
+					const uint32x4_t high = convert_to_bits_of_bfloat16(vld1q_f32(src + i + 4), high_bias);
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i), vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+				}
+				rounding.discard(i);
+				scalar::convert_stochastic(src + i, dst + i, n - i, rounding);
+			}
+
+			inline void convert(const bfloat16_t* const src, float* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint16x8_t bits = vld1q_u16(reinterpret_cast<const std::uint16_t*>(src + i));
+					vst1q_f32(dst + i, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(bits), 16)));
+					vst1q_f32(dst + i + 4, vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(bits), 16)));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				float32x4_t sum_low = vdupq_n_f32(0.0f);
+				float32x4_t sum_high = vdupq_n_f32(0.0f);
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint16x8_t a_bits = vld1q_u16(reinterpret_cast<const std::uint16_t*>(a + i));
+					const uint16x8_t b_bits = vld1q_u16(reinterpret_cast<const std::uint16_t*>(b + i));
+					sum_low = vfmaq_f32(sum_low, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(a_bits), 16)),
+						vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(b_bits), 16)));
+					sum_high = vfmaq_f32(sum_high, vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(a_bits), 16)),
+						vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(b_bits), 16)));
+				}
+				return vaddvq_f32(vaddq_f32(sum_low, sum_high)) + scalar::dot(a + i, b + i, n - i);
+			}
+
+			inline void axpy(const float alpha, const bfloat16_t* const x, float* const y, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint16x8_t x_bits = vld1q_u16(reinterpret_cast<const std::uint16_t*>(x + i));
+					vst1q_f32(y + i, vfmaq_n_f32(vld1q_f32(y + i),
+						vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(x_bits), 16)), alpha));
+					vst1q_f32(y + i + 4, vfmaq_n_f32(vld1q_f32(y + i + 4),
+						vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(x_bits), 16)), alpha));
+				}
+				scalar::axpy(alpha, x + i, y + i, n - i);
+			}
+
+			// One step of Kahan summation for each lane.
+			inline void add_compensated(float32x4_t& sum, float32x4_t& compensation, const float32x4_t x)
+			{
+				const float32x4_t y = vsubq_f32(x, compensation);
+				const float32x4_t t = vaddq_f32(sum, y);
+				compensation = vsubq_f32(vsubq_f32(t, sum), y);
+				sum = t;
+			}
+
+			inline float sum(const bfloat16_t* const src, const std::size_t n)
+			{
+				float32x4_t sum_low = vdupq_n_f32(0.0f);
+				float32x4_t sum_high = vdupq_n_f32(0.0f);
+				float32x4_t compensation_low = vdupq_n_f32(0.0f);
+				float32x4_t compensation_high = vdupq_n_f32(0.0f);
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const uint16x8_t bits = vld1q_u16(reinterpret_cast<const std::uint16_t*>(src + i));
+					add_compensated(sum_low, compensation_low, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(bits), 16)));
+					add_compensated(sum_high, compensation_high, vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(bits), 16)));
+				}
+				add_compensated(sum_low, compensation_low, vsubq_f32(sum_high, compensation_high));
+				return vaddvq_f32(vsubq_f32(sum_low, compensation_low)) + scalar::sum(src + i, n - i);
+			}
+
+			// Returns the bits of four bfloat16 values, rounded to nearest even, assuming
+			// that the floats are either normal or zero.
+			inline uint32x4_t convert_normal_or_zero_to_bits_of_bfloat16(const float32x4_t f)
+			{
+				const uint32x4_t bits = vreinterpretq_u32_f32(f);
+				const uint32x4_t lsb = vandq_u32(vshrq_n_u32(bits, 16), vdupq_n_u32(1));
+				return vshrq_n_u32(vaddq_u32(bits, vaddq_u32(vdupq_n_u32(0x7FFF), lsb)), 16);
+			}
+
+			// Loads eight integers, and widens them to two vectors of 32-bit lanes.
+			inline void load_as_int32(const std::uint8_t* const src, int32x4_t& low, int32x4_t& high)
+			{
+				const uint16x8_t words = vmovl_u8(vld1_u8(src));
+				low = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(words)));
+				high = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(words)));
+			}
+
+			inline void load_as_int32(const std::int8_t* const src, int32x4_t& low, int32x4_t& high)
+			{
+				const int16x8_t words = vmovl_s8(vld1_s8(src));
+				low = vmovl_s16(vget_low_s16(words));
+				high = vmovl_s16(vget_high_s16(words));
+			}
+
+			inline void load_as_int32(const std::uint16_t* const src, int32x4_t& low, int32x4_t& high)
+			{
+				const uint16x8_t words = vld1q_u16(src);
+				low = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(words)));
+				high = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(words)));
+			}
+
+			inline void load_as_int32(const std::int16_t* const src, int32x4_t& low, int32x4_t& high)
+			{
+				const int16x8_t words = vld1q_s16(src);
+				low = vmovl_s16(vget_low_s16(words));
+				high = vmovl_s16(vget_high_s16(words));
+			}
+
+			inline void load_as_int32(const std::int32_t* const src, int32x4_t& low, int32x4_t& high)
+			{
+				low = vld1q_s32(src);
+				high = vld1q_s32(src + 4);
+			}
+
+			template <typename IntegerType>
+			inline void convert_from_integers(const IntegerType* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					int32x4_t low;
+					int32x4_t high;
+					load_as_int32(src + i, low, high);
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i), vcombine_u16(
+						vmovn_u32(convert_normal_or_zero_to_bits_of_bfloat16(vcvtq_f32_s32(low))),
+						vmovn_u32(convert_normal_or_zero_to_bits_of_bfloat16(vcvtq_f32_s32(high)))));
+				}
+				scalar::convert_from_integers(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512_BF16
+		namespace avx512_bf16 {
+
+			// VCVTNE2PS2BF16 and VCVTNEPS2BF16 round to nearest even, flush denormals
+			// to sign preserving zero, and quiet NaNs by setting the MSB of the
+			// mantissa, exactly like bfloat16_t(const float).
+			BIOVAULT_BFLOAT16_TARGET_AVX512_BF16 inline void convert(
+				const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 32 <= n; i += 32)
+				{
+					// The elements of the second argument go to the lower half of the result.
+					const __m512bh result = _mm512_cvtne2ps_pbh(_mm512_loadu_ps(src + i + 16), _mm512_loadu_ps(src + i));
+					std::memcpy(static_cast<void*>(dst + i), &result, sizeof(result));
+				}
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256bh result = _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i));
+					std::memcpy(static_cast<void*>(dst + i), &result, sizeof(result));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			// Uses VDPBF16PS, which multiplies pairs of bfloat16 values and accumulates in
+			// float. Note that VDPBF16PS treats denormal inputs as zero, and may round
+			// slightly differently from a float FMA per element.
+			BIOVAULT_BFLOAT16_TARGET_AVX512_BF16 inline float dot(
+				const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				__m512 sum0 = _mm512_setzero_ps();
+				__m512 sum1 = _mm512_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 64 <= n; i += 64)
+				{
+					__m512bh a0, a1, b0, b1;
+					std::memcpy(&a0, a + i, sizeof(a0));
+					std::memcpy(&b0, b + i, sizeof(b0));
+					std::memcpy(&a1, a + i + 32, sizeof(a1));
+					std::memcpy(&b1, b + i + 32, sizeof(b1));
+					sum0 = _mm512_dpbf16_ps(sum0, a0, b0);
+					sum1 = _mm512_dpbf16_ps(sum1, a1, b1);
+				}
+				return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1)) + avx512::dot(a + i, b + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON_BF16
+		namespace neon_bf16 {
+
+			inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const float32x4_t low = vld1q_f32(src + i);
+					const float32x4_t high = vld1q_f32(src + i + 4);
+					const uint16x8_t converted = vreinterpretq_u16_bf16(
+						vcvtq_high_bf16_f32(vcvtq_low_bf16_f32(low), high));
+
+					// BFCVTN only flushes denormals when FPCR.FZ is set, so flush them
+					// explicitly, to sign preserving zero.
+					const uint32x4_t low_bits = vreinterpretq_u32_f32(low);
+					const uint32x4_t high_bits = vreinterpretq_u32_f32(high);
+					const uint16x8_t upper = vcombine_u16(vshrn_n_u32(low_bits, 16), vshrn_n_u32(high_bits, 16));
+					const uint16x8_t is_zero_or_denormal = vceqq_u16(
+						vandq_u16(upper, vdupq_n_u16(0x7F80)), vdupq_n_u16(0));
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i),
+						vbslq_u16(is_zero_or_denormal, vandq_u16(upper, vdupq_n_u16(0x8000)), converted));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			// Uses BFDOT, which multiplies pairs of bfloat16 values and accumulates in
+			// float. Note that BFDOT may round slightly differently from a float FMA per element.
+			inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+			{
+				float32x4_t sum = vdupq_n_f32(0.0f);
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					sum = vbfdotq_f32(sum,
+						vreinterpretq_bf16_u16(vld1q_u16(reinterpret_cast<const std::uint16_t*>(a + i))),
+						vreinterpretq_bf16_u16(vld1q_u16(reinterpret_cast<const std::uint16_t*>(b + i))));
+				}
+				return vaddvq_f32(sum) + scalar::dot(a + i, b + i, n - i);
+			}
+		}
+#endif
+	}
+
+
+	// The SIMD kernels that may be used by the bulk functions, like biovault::convert.
+	// Which of them are supported by the running process, depends on the CPU, the
+	// operating system and the compiler (and its options).
+	enum class simd_kernel
+	{
+		scalar,
+		sse2,
+		avx2,        // AVX2 + FMA
+		avx512,      // AVX-512 F + BW + DQ + VL
+		avx512_bf16, // AVX-512 + AVX512_BF16
+		neon,
+		neon_bf16    // NEON + ARMv8.6 BF16
+	};
+
+
+	// Returns the name of the specified kernel, for example "avx512_bf16".
+	inline const char* get_name(const simd_kernel kernel)
+	{
+		switch (kernel)
+		{
+		case simd_kernel::scalar: return "scalar";
+		case simd_kernel::sse2: return "sse2";
+		case simd_kernel::avx2: return "avx2";
+		case simd_kernel::avx512: return "avx512";
+		case simd_kernel::avx512_bf16: return "avx512_bf16";
+		case simd_kernel::neon: return "neon";
+		case simd_kernel::neon_bf16: return "neon_bf16";
+		}
+		return "unknown";
+	}
+
+
+	namespace detail {
+
+		struct cpu_features
+		{
+			bool sse2;
+			bool avx2;
+			bool avx512;
+			bool avx512_bf16;
+			bool f16c;
+			bool neon;
+			bool neon_bf16;
+		};
+
+
+#ifdef BIOVAULT_BFLOAT16_X86
+		// Equivalent to the CPUID instruction, retrieving its EAX, EBX, ECX, and EDX output.
+		inline std::array<std::uint32_t, 4> cpuid(const std::uint32_t leaf, const std::uint32_t subleaf)
+		{
+			std::array<std::uint32_t, 4> registers{};
+#ifdef _MSC_VER
+			int info[4];
+			__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+			std::memcpy(registers.data(), info, sizeof(info));
+#else
+			if (leaf > __get_cpuid_max(0, nullptr))
+			{
+				return registers;
+			}
+			__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+			return registers;
+		}
+
+
+		// Returns the XCR0 register, which tells which register states are enabled by the OS.
+		inline std::uint64_t get_xcr0()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			std::uint32_t eax, edx;
+			__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (std::uint64_t{ edx } << 32) | eax;
+#endif
+		}
+#endif
+
+
+		inline cpu_features detect_cpu_features()
+		{
+			cpu_features features{};
+
+#ifdef BIOVAULT_BFLOAT16_X86
+			const auto leaf1 = cpuid(1, 0);
+			const auto leaf7 = cpuid(7, 0);
+			const auto leaf7_subleaf1 = cpuid(7, 1);
+
+			const auto has_bit = [](const std::uint32_t reg, const unsigned bit)
+			{
+				return ((reg >> bit) & 1U) != 0;
+			};
+
+			features.sse2 = has_bit(leaf1[3], 26);
+
+			// AVX and AVX-512 are only usable when the OS saves their registers (XCR0).
+			const bool osxsave = has_bit(leaf1[2], 27);
+			const std::uint64_t xcr0 = osxsave ? get_xcr0() : 0;
+			const bool os_saves_ymm = (xcr0 & 0x6U) == 0x6U;
+			const bool os_saves_zmm = (xcr0 & 0xE6U) == 0xE6U;
+
+			features.avx2 = os_saves_ymm && has_bit(leaf1[2], 28) && has_bit(leaf1[2], 12) && has_bit(leaf7[1], 5);
+			features.avx512 = features.avx2 && os_saves_zmm &&
+				has_bit(leaf7[1], 16) && has_bit(leaf7[1], 17) && has_bit(leaf7[1], 30) && has_bit(leaf7[1], 31);
+			features.avx512_bf16 = features.avx512 && has_bit(leaf7_subleaf1[0], 5);
+			features.f16c = os_saves_ymm && has_bit(leaf1[2], 29);
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON
+			features.neon = true;
+#	ifdef BIOVAULT_BFLOAT16_NEON_BF16
+#		if defined(__linux__) && defined(__aarch64__)
+			// HWCAP2_BF16, from the Linux header asm/hwcap.h.
+			features.neon_bf16 = (getauxval(AT_HWCAP2) & (1UL << 14)) != 0;
+#		else
+			// The compiler was told that the target supports BF16 anyway.
+			features.neon_bf16 = true;
+#		endif
+#	endif
+#endif
+			return features;
+		}
+
+
+		// Returns the features of the CPU, detected once, at the first call.
+		inline const cpu_features& get_cpu_features()
+		{
+			static const cpu_features features{ detect_cpu_features() };
+			return features;
+		}
+
+
+		// The function pointers of a specific kernel, to be called by the bulk functions.
+		struct kernel_table
+		{
+			simd_kernel kernel;
+			void (*convert_from_float)(const float*, bfloat16_t*, std::size_t);
+			void (*convert_to_float)(const bfloat16_t*, float*, std::size_t);
+			void (*convert_from_float_toward_zero)(const float*, bfloat16_t*, std::size_t);
+			void (*convert_from_float_stochastic)(const float*, bfloat16_t*, std::size_t, stochastic_rounding&);
+			float (*dot)(const bfloat16_t*, const bfloat16_t*, std::size_t);
+			void (*axpy)(float, const bfloat16_t*, float*, std::size_t);
+			float (*sum)(const bfloat16_t*, std::size_t);
+			void (*convert_from_uint8)(const std::uint8_t*, bfloat16_t*, std::size_t);
+			void (*convert_from_int8)(const std::int8_t*, bfloat16_t*, std::size_t);
+			void (*convert_from_uint16)(const std::uint16_t*, bfloat16_t*, std::size_t);
+			void (*convert_from_int16)(const std::int16_t*, bfloat16_t*, std::size_t);
+			void (*convert_from_int32)(const std::int32_t*, bfloat16_t*, std::size_t);
+			void (*convert_from_double)(const double*, bfloat16_t*, std::size_t);
+		};
+
+
+		// Returns the table of the specified kernel, or the scalar one, when the
+		// specified kernel is not compiled in.
+		inline const kernel_table& get_kernel_table(const simd_kernel kernel)
+		{
+			switch (kernel)
+			{
+#ifdef BIOVAULT_BFLOAT16_SSE2
+			case simd_kernel::sse2:
+			{
+				static const kernel_table table{ kernel, sse2::convert, sse2::convert,
+					sse2::convert_toward_zero, sse2::convert_stochastic, sse2::dot, sse2::axpy,
+					sse2::sum,
+					sse2::convert_from_integers,
+					sse2::convert_from_integers,
+					sse2::convert_from_integers,
+					sse2::convert_from_integers,
+					sse2::convert_from_integers,
+					scalar::convert };
+				return table;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+			{
+				static const kernel_table table{ kernel, avx2::convert, avx2::convert,
+					avx2::convert_toward_zero, avx2::convert_stochastic, avx2::dot, avx2::axpy,
+					avx2::sum,
+					avx2::convert_from_integers,
+					avx2::convert_from_integers,
+					avx2::convert_from_integers,
+					avx2::convert_from_integers,
+					avx2::convert_from_integers,
+					avx2::convert };
+				return table;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			{
+				static const kernel_table table{ kernel, avx512::convert, avx512::convert,
+					avx512::convert_toward_zero, avx512::convert_stochastic, avx512::dot, avx512::axpy,
+					avx512::sum,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert };
+				return table;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512_BF16
+			case simd_kernel::avx512_bf16:
+			{
+				static const kernel_table table{ kernel, avx512_bf16::convert, avx512::convert,
+					avx512::convert_toward_zero, avx512::convert_stochastic, avx512_bf16::dot, avx512::axpy,
+					avx512::sum,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert_from_integers,
+					avx512::convert };
+				return table;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON
+			case simd_kernel::neon:
+			{
+				static const kernel_table table{ kernel, neon::convert, neon::convert,
+					neon::convert_toward_zero, neon::convert_stochastic, neon::dot, neon::axpy,
+					neon::sum,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					scalar::convert };
+				return table;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON_BF16
+			case simd_kernel::neon_bf16:
+			{
+				static const kernel_table table{ kernel, neon_bf16::convert, neon::convert,
+					neon::convert_toward_zero, neon::convert_stochastic, neon_bf16::dot, neon::axpy,
+					neon::sum,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					neon::convert_from_integers,
+					scalar::convert };
+				return table;
+			}
+#endif
+			default:
+			{
+				static const kernel_table table{ simd_kernel::scalar, scalar::convert, scalar::convert,
+					scalar::convert_toward_zero, scalar::convert_stochastic, scalar::dot, scalar::axpy,
+					scalar::sum,
+					scalar::convert_from_integers,
+					scalar::convert_from_integers,
+					scalar::convert_from_integers,
+					scalar::convert_from_integers,
+					scalar::convert_from_integers,
+					scalar::convert };
+				return table;
+			}
+			}
+		}
+	}
+
+
+	// Tells whether the specified kernel is compiled in, and supported by the CPU.
+	inline bool is_supported(const simd_kernel kernel)
+	{
+		const auto& features = detail::get_cpu_features();
+
+		switch (kernel)
+		{
+		case simd_kernel::scalar: return true;
+#ifdef BIOVAULT_BFLOAT16_SSE2
+		case simd_kernel::sse2: return features.sse2;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		case simd_kernel::avx2: return features.avx2;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		case simd_kernel::avx512: return features.avx512;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512_BF16
+		case simd_kernel::avx512_bf16: return features.avx512_bf16;
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON
+		case simd_kernel::neon: return features.neon;
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON_BF16
+		case simd_kernel::neon_bf16: return features.neon_bf16;
+#endif
+		default:
+			static_cast<void>(features);
+			return false;
+		}
+	}
+
+
+	// Returns the fastest kernel that is supported by the running process.
+	inline simd_kernel get_best_supported_simd_kernel()
+	{
+		for (const auto kernel : {
+			simd_kernel::avx512_bf16, simd_kernel::avx512, simd_kernel::avx2, simd_kernel::sse2,
+			simd_kernel::neon_bf16, simd_kernel::neon })
+		{
+			if (is_supported(kernel))
+			{
+				return kernel;
+			}
+		}
+		return simd_kernel::scalar;
+	}
+
+
+	namespace detail {
+
+		// Holds the kernel table that is used by the bulk functions. Initialized at
+		// the first call, by the best supported kernel.
+		inline std::atomic<const kernel_table*>& get_active_kernel_table_pointer()
+		{
+			static std::atomic<const kernel_table*> active_table{
+				&get_kernel_table(get_best_supported_simd_kernel()) };
+			return active_table;
+		}
+
+		inline const kernel_table& get_active_kernel_table()
+		{
+			return *get_active_kernel_table_pointer().load(std::memory_order_relaxed);
+		}
+	}
+
+
+	// Returns the kernel that is currently used by the bulk functions.
+	inline simd_kernel get_simd_kernel()
+	{
+		return detail::get_active_kernel_table().kernel;
+	}
+
+
+	// Forces the bulk functions to use the specified kernel, for example for testing
+	// or benchmarking. Returns false (and keeps the current kernel) when the specified
+	// kernel is not supported. Note: should not be called while another thread is
+	// running a bulk function.
+	inline bool set_simd_kernel(const simd_kernel kernel)
+	{
+		if (is_supported(kernel))
+		{
+			detail::get_active_kernel_table_pointer().store(&detail::get_kernel_table(kernel), std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+
+	// Converts n floats from src to bfloat16, storing the results in dst. Yields
+	// exactly the same raw bits as constructing each element by bfloat16_t(const float),
+	// but uses the fastest SIMD kernel that is supported by the CPU.
+	inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_float(src, dst, n);
+		BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(src, dst, n);
+	}
+
+
+	// Converts n floats from src to bfloat16, using the specified rounding policy.
+	inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n, round_to_nearest_even_t)
+	{
+		convert(src, dst, n);
+	}
+
+	inline void convert(const float* const src, bfloat16_t* const dst, const std::size_t n, round_toward_zero_t)
+	{
+		detail::get_active_kernel_table().convert_from_float_toward_zero(src, dst, n);
+		BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(src, dst, n);
+	}
+
+	// Yields the same results as converting each element by bfloat16_t(src[i], rounding),
+	// one after the other.
+	inline void convert(const float* src, bfloat16_t* dst, std::size_t n, stochastic_rounding& rounding)
+	{
+		const auto& table = detail::get_active_kernel_table();
+
+		while (n > 0)
+		{
+			// The kernels assume that the key of the rounding policy remains the same,
+			// so split at each change of the upper 32 bits of the counter.
+			const std::uint64_t count_until_key_changes{
+				(std::uint64_t{ 1 } << 32) - (rounding.get_counter() & 0xFFFFFFFFU) };
+			const std::size_t count{ (n < count_until_key_changes) ? n : static_cast<std::size_t>(count_until_key_changes) };
+
+			table.convert_from_float_stochastic(src, dst, count, rounding);
+			BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(src, dst, count);
+			src += count;
+			dst += count;
+			n -= count;
+		}
+	}
+
+
+	// Converts n bfloat16 values from src to float, storing the results in dst.
+	// Lossless, just like operator float(), but processing many elements at once.
+	inline void convert(const bfloat16_t* const src, float* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_to_float(src, dst, n);
+	}
+
+
+	// Converts n doubles from src to bfloat16, storing the results in dst. Yields
+	// exactly the same raw bits as constructing each element by bfloat16_t(const double),
+	// rounding only once. The SSE2 and NEON kernels use the scalar conversion.
+	inline void convert(const double* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_double(src, dst, n);
+	}
+
+
+	// Returns the dot product of a and b, each having n elements, accumulated in float.
+	inline float dot(const bfloat16_t* const a, const bfloat16_t* const b, const std::size_t n)
+	{
+		return detail::get_active_kernel_table().dot(a, b, n);
+	}
+
+
+	// Computes y[i] += alpha * x[i], for the n elements of x and y, accumulating in float.
+	inline void axpy(const float alpha, const bfloat16_t* const x, float* const y, const std::size_t n)
+	{
+		detail::get_active_kernel_table().axpy(alpha, x, y, n);
+	}
+
+
+	namespace detail {
+
+		// Sums blocks of elements by the compensated sum kernel, and adds up the block sums
+		// pairwise, so that the rounding error only grows logarithmically with n.
+		inline float sum_pairwise(const kernel_table& table, const bfloat16_t* const src, const std::size_t n)
+		{
+			constexpr std::size_t block_size{ 4096 };
+
+			if (n <= block_size)
+			{
+				const float compensated_sum{ table.sum(src, n) };
+
+				// Compensation breaks down when the sum is infinite.
+				return std::isnan(compensated_sum) ? scalar::sum_uncompensated(src, n) : compensated_sum;
+			}
+			// Split at a multiple of the block size, near the middle.
+			const std::size_t half{ (n / 2 + block_size - 1) / block_size * block_size };
+			return sum_pairwise(table, src, half) + sum_pairwise(table, src + half, n - half);
+		}
+	}
+
+
+	// Returns the sum of the n elements of src, accumulated in float (Kahan-compensated
+	// per SIMD lane, and pairwise for large n).
+	inline float sum(const bfloat16_t* const src, const std::size_t n)
+	{
+		return detail::sum_pairwise(detail::get_active_kernel_table(), src, n);
+	}
+
+
+	// Returns the arithmetic mean of the n elements of src (NaN when n is zero).
+	inline float mean(const bfloat16_t* const src, const std::size_t n)
+	{
+		return static_cast<float>(static_cast<double>(sum(src, n)) / static_cast<double>(n));
+	}
+
+
+
+	// Converts n integers from src to bfloat16, storing the results in dst. Yields
+	// exactly the same raw bits as constructing each element by bfloat16_t(src[i]).
+	// Note: the 8-bit integers are converted exactly, while the 16-bit and 32-bit ones
+	// are rounded to nearest even.
+	inline void convert(const std::uint8_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_uint8(src, dst, n);
+	}
+
+	inline void convert(const std::int8_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_int8(src, dst, n);
+	}
+
+	inline void convert(const std::uint16_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_uint16(src, dst, n);
+	}
+
+	inline void convert(const std::int16_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_int16(src, dst, n);
+	}
+
+	inline void convert(const std::int32_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_active_kernel_table().convert_from_int32(src, dst, n);
+	}
+
+}
+
+
+namespace biovault {
+
+	namespace detail {
+
+		// The members of std::numeric_limits<bfloat16_t>. Defined by a class template,
+		// to allow its static data members to be defined in this header (prior to
+		// C++17, which would allow them to be inline variables instead).
+		// Denormals are considered absent, as conversion from float to bfloat16 flushes
+		// them to zero, so that arithmetic never yields them.
+		template <typename = void>
+		struct bfloat16_numeric_limits
+		{
+			static constexpr bool is_specialized{ true };
+			static constexpr bool is_signed{ true };
+			static constexpr bool is_integer{ false };
+			static constexpr bool is_exact{ false };
+			static constexpr bool has_infinity{ true };
+			static constexpr bool has_quiet_NaN{ true };
+			static constexpr bool has_signaling_NaN{ true };
+			static constexpr std::float_denorm_style has_denorm{ std::denorm_absent };
+			static constexpr bool has_denorm_loss{ false };
+			static constexpr std::float_round_style round_style{ std::round_to_nearest };
+			static constexpr bool is_iec559{ false };
+			static constexpr bool is_bounded{ true };
+			static constexpr bool is_modulo{ false };
+			static constexpr int digits{ 8 };
+			static constexpr int digits10{ 2 };
+			static constexpr int max_digits10{ 4 };
+			static constexpr int radix{ 2 };
+			static constexpr int min_exponent{ FLT_MIN_EXP };
+			static constexpr int min_exponent10{ FLT_MIN_10_EXP };
+			static constexpr int max_exponent{ FLT_MAX_EXP };
+			static constexpr int max_exponent10{ FLT_MAX_10_EXP };
+			static constexpr bool traps{ false };
+			static constexpr bool tinyness_before{ false };
+
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t min() noexcept { return bfloat16_t(0x0080, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t lowest() noexcept { return bfloat16_t(0xFF7F, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t max() noexcept { return bfloat16_t(0x7F7F, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t epsilon() noexcept { return bfloat16_t(0x3C00, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t round_error() noexcept { return bfloat16_t(0x3F00, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t infinity() noexcept { return bfloat16_t(0x7F80, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t quiet_NaN() noexcept { return bfloat16_t(0x7FC0, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t signaling_NaN() noexcept { return bfloat16_t(0x7FA0, true); }
+			static BIOVAULT_BFLOAT16_CONSTEXPR bfloat16_t denorm_min() noexcept { return min(); }
+		};
+
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_specialized;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_signed;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_integer;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_exact;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::has_infinity;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::has_quiet_NaN;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::has_signaling_NaN;
+		template <typename T> constexpr std::float_denorm_style bfloat16_numeric_limits<T>::has_denorm;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::has_denorm_loss;
+		template <typename T> constexpr std::float_round_style bfloat16_numeric_limits<T>::round_style;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_iec559;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_bounded;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::is_modulo;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::digits;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::digits10;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::max_digits10;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::radix;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::min_exponent;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::min_exponent10;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::max_exponent;
+		template <typename T> constexpr int bfloat16_numeric_limits<T>::max_exponent10;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::traps;
+		template <typename T> constexpr bool bfloat16_numeric_limits<T>::tinyness_before;
+	}
+
+}
+
+namespace std {
+
+	template <>
+	class numeric_limits<biovault::bfloat16_t> : public biovault::detail::bfloat16_numeric_limits<>
+	{
+	};
+
+	// Consistent with operator==, which considers -0 and +0 equal. (NaN is not equal
+	// to anything, so any hash value is fine for NaN.)
+	template <>
+	struct hash<biovault::bfloat16_t>
+	{
+		std::size_t operator()(const biovault::bfloat16_t value) const noexcept
+		{
+			const auto bits = get_raw_bits(value);
+			return hash<std::uint16_t>{}((bits == 0x8000U) ? std::uint16_t{} : bits);
+		}
+	};
+
 }
 
 #endif
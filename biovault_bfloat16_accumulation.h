@@ -0,0 +1,160 @@
+#ifndef BIOVAULT_BFLOAT16_ACCUMULATION_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_ACCUMULATION_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Concurrent accumulation into an array of partial sums, for parallel reductions
+// whose results are stored as bfloat16, for example when multiple threads scatter-add
+// gradients into the same array. The partial sums are kept in float, so that they
+// are only rounded to bfloat16 once, at the end, by the bulk conversion kernel.
+// Each partial sum is a 32-bit atomic word, to which the threads add lock-free, by
+// compare-and-swap.
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For min.
+#include <atomic>
+#include <cstddef>   // For size_t.
+#include <cstdint>
+#include <cstring>   // For memcpy.
+#include <memory>    // For unique_ptr.
+
+namespace biovault {
+
+	namespace detail {
+
+		// The number of partial sums that are converted at a time by
+		// concurrent_accumulation_buffer::flush, from a block on the stack.
+		constexpr std::size_t accumulation_flush_block_size{ 1024 };
+	}
+
+
+	// Array of float partial sums, to which multiple threads may add concurrently.
+	// The additions use relaxed memory ordering: the results are only meant to be
+	// retrieved (by get or flush) after the adding threads are synchronized with the
+	// retrieving thread, for example when they are joined, or when thread_pool::run
+	// returns. The order of the additions to the same element is unspecified, so that
+	// (as float addition is not associative) the rounding of the sums may vary.
+	class concurrent_accumulation_buffer
+	{
+	public:
+		// Creates n partial sums, each initialized to zero.
+		explicit concurrent_accumulation_buffer(const std::size_t n)
+			: size_{ n }, words_{ new std::atomic<std::uint32_t>[n] }
+		{
+			reset();
+		}
+
+		std::size_t size() const noexcept
+		{
+			return size_;
+		}
+
+		// Tells whether the additions are lock-free, which is the case on all common
+		// platforms.
+		bool is_lock_free() const noexcept
+		{
+			return (size_ == 0) || words_[0].is_lock_free();
+		}
+
+		// Adds the value to the partial sum at index i. Thread-safe.
+		void add(const std::size_t i, const float value) noexcept
+		{
+			auto& word = words_[i];
+			auto expected = word.load(std::memory_order_relaxed);
+
+			// On failure, compare_exchange_weak updates expected to the current value.
+			while (!word.compare_exchange_weak(expected, get_bits(get_float(expected) + value),
+				std::memory_order_relaxed))
+			{
+			}
+		}
+
+		// Adds each of the n values to the partial sum at the corresponding index, as
+		// by add(indices[j], values[j]). Thread-safe.
+		void add(const std::size_t* const indices, const float* const values, const std::size_t n) noexcept
+		{
+			for (std::size_t j{}; j < n; ++j)
+			{
+				add(indices[j], values[j]);
+			}
+		}
+
+		void add(const std::size_t* const indices, const bfloat16_t* const values, const std::size_t n) noexcept
+		{
+			for (std::size_t j{}; j < n; ++j)
+			{
+				add(indices[j], values[j]);
+			}
+		}
+
+		// Returns the partial sum at index i.
+		float get(const std::size_t i) const noexcept
+		{
+			return get_float(words_[i].load(std::memory_order_relaxed));
+		}
+
+		// Sets all partial sums to zero. Must not be called concurrently with add.
+		void reset() noexcept
+		{
+			for (std::size_t i{}; i < size_; ++i)
+			{
+				words_[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Stores all partial sums into dst (which must have size() elements), rounded
+		// to nearest even, by the bulk conversion kernel. Yields the same raw bits as
+		// bfloat16_t(get(i)), for each index i.
+		void flush(bfloat16_t* const dst) const
+		{
+			float block[detail::accumulation_flush_block_size];
+
+			for (std::size_t i{}; i < size_; i += detail::accumulation_flush_block_size)
+			{
+				const auto block_size = std::min(detail::accumulation_flush_block_size, size_ - i);
+
+				for (std::size_t j{}; j < block_size; ++j)
+				{
+					block[j] = get(i + j);
+				}
+				convert(block, dst + i, block_size);
+			}
+		}
+
+	private:
+		static float get_float(const std::uint32_t bits) noexcept
+		{
+			float result;
+			std::memcpy(&result, &bits, sizeof(result));
+			return result;
+		}
+
+		static std::uint32_t get_bits(const float f) noexcept
+		{
+			std::uint32_t result;
+			std::memcpy(&result, &f, sizeof(result));
+			return result;
+		}
+
+		std::size_t size_;
+		std::unique_ptr<std::atomic<std::uint32_t>[]> words_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_accumulation.h"
+#include "biovault_bfloat16_accumulation.h"
+
+#include "biovault_bfloat16_parallel.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstddef> // For size_t.
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::concurrent_accumulation_buffer;
+using biovault::test::for_each_supported_simd_kernel;
+
+
+GTEST_TEST(bfloat16_accumulation, IsInitializedToZero)
+{
+	const concurrent_accumulation_buffer buffer(3);
+
+	EXPECT_EQ(buffer.size(), 3);
+	EXPECT_TRUE(buffer.is_lock_free());
+
+	for (std::size_t i{}; i < buffer.size(); ++i)
+	{
+		EXPECT_EQ(buffer.get(i), 0.0f);
+	}
+}
+
+
+GTEST_TEST(bfloat16_accumulation, AddsScatteredValues)
+{
+	concurrent_accumulation_buffer buffer(4);
+
+	const std::size_t indices[] = { 1, 3, 1, 0, 1 };
+	const float float_values[] = { 0.5f, -2.0f, 0.25f, 8.0f, 1.0f };
+	const bfloat16_t bfloat16_values[] = { bfloat16_t(1.0f), bfloat16_t(1.0f), bfloat16_t(1.0f),
+		bfloat16_t(1.0f), bfloat16_t(1.0f) };
+
+	buffer.add(indices, float_values, 5);
+	buffer.add(indices, bfloat16_values, 5);
+	buffer.add(2, 3.0f);
+
+	EXPECT_EQ(buffer.get(0), 9.0f);
+	EXPECT_EQ(buffer.get(1), 4.75f);
+	EXPECT_EQ(buffer.get(2), 3.0f);
+	EXPECT_EQ(buffer.get(3), -1.0f);
+
+	buffer.reset();
+
+	for (std::size_t i{}; i < buffer.size(); ++i)
+	{
+		EXPECT_EQ(buffer.get(i), 0.0f);
+	}
+}
+
+
+GTEST_TEST(bfloat16_accumulation, ConcurrentAdditionsAreNotLost)
+{
+	// Few elements, to have many concurrent additions to the same element. The sums
+	// are integers below 2^24, so they are exact in float, regardless of the order
+	// of the additions.
+	constexpr std::size_t size{ 5 };
+	constexpr std::size_t number_of_additions_per_thread{ 40000 };
+	constexpr unsigned number_of_threads{ 4 };
+
+	biovault::thread_pool pool(number_of_threads);
+	concurrent_accumulation_buffer buffer(size);
+
+	pool.run(number_of_threads, [&buffer](const unsigned thread_index)
+		{
+			for (std::size_t j{}; j < number_of_additions_per_thread; ++j)
+			{
+				buffer.add((j + thread_index) % size, static_cast<float>(thread_index + 1));
+			}
+		});
+
+	// Each thread adds (thread_index + 1) to each element, n / size times.
+	const float expected{ (1 + 2 + 3 + 4) * (number_of_additions_per_thread / size) };
+
+	for (std::size_t i{}; i < size; ++i)
+	{
+		EXPECT_EQ(buffer.get(i), expected);
+	}
+}
+
+
+GTEST_TEST(bfloat16_accumulation, FlushEqualsConstructionFromPartialSums)
+{
+	// More elements than a single flush block, and not a multiple of it.
+	constexpr std::size_t size{ 2500 };
+	concurrent_accumulation_buffer buffer(size);
+	std::mt19937 generator;
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	for (std::size_t j{}; j < 4 * size; ++j)
+	{
+		buffer.add(j % size, distribution(generator));
+	}
+
+	for_each_supported_simd_kernel([&buffer]
+		{
+			std::vector<bfloat16_t> result(size);
+			buffer.flush(result.data());
+
+			for (std::size_t i{}; i < size; ++i)
+			{
+				EXPECT_EQ(get_raw_bits(result[i]), get_raw_bits(bfloat16_t(buffer.get(i))));
+			}
+		});
+}
@@ -0,0 +1,731 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Initial author: Niels Dekker (LKEB)
+
+// Benchmarks of the conversion and arithmetic hot paths. Each benchmark reports
+// its throughput in bytes per second (of both the source and the destination), and
+// its time per element. For example:
+//
+//   biovault_bfloat16_bench --benchmark_filter=BulkConversionFromFloat
+
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_gemm.h"
+#include "biovault_bfloat16_interop.h"
+#include "biovault_bfloat16_math.h"
+#include "biovault_bfloat16_quantize.h"
+#include "biovault_bfloat16_sort.h"
+#include "biovault_bfloat16_statistics.h"
+#include "biovault_bfloat16_strided.h"
+
+// Google Benchmark header file:
+#include <benchmark/benchmark.h>
+
+// Standard library header files:
+#include <algorithm> // For copy and sort.
+#include <cmath>     // For exp.
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::simd_kernel;
+
+namespace
+{
+	// Number of elements processed per iteration: large enough to amortize the loop
+	// overhead, small enough for the data to stay in the L2 cache.
+	constexpr std::size_t number_of_elements{ 1U << 14 };
+
+	enum distribution : std::int64_t
+	{
+		all_normal,
+		sparse_zeros, // 90% zero.
+		nan_heavy     // 50% NaN.
+	};
+
+	const char* get_name(const std::int64_t distribution)
+	{
+		switch (distribution)
+		{
+		case all_normal: return "all-normal";
+		case sparse_zeros: return "sparse-zeros";
+		case nan_heavy: return "NaN-heavy";
+		}
+		return "unknown";
+	}
+
+	const std::vector<std::int64_t> all_distributions{ all_normal, sparse_zeros, nan_heavy };
+
+	const std::vector<std::int64_t> all_simd_kernels{
+		static_cast<std::int64_t>(simd_kernel::scalar),
+		static_cast<std::int64_t>(simd_kernel::sse2),
+		static_cast<std::int64_t>(simd_kernel::avx2),
+		static_cast<std::int64_t>(simd_kernel::avx512),
+		static_cast<std::int64_t>(simd_kernel::avx512_bf16),
+		static_cast<std::int64_t>(simd_kernel::neon),
+		static_cast<std::int64_t>(simd_kernel::neon_bf16) };
+
+
+	std::vector<float> make_floats(const std::int64_t distribution)
+	{
+		std::mt19937 engine;
+		std::normal_distribution<float> normal_distribution;
+		std::uniform_real_distribution<float> uniform_distribution;
+		std::vector<float> result(number_of_elements);
+
+		for (auto& element : result)
+		{
+			element = normal_distribution(engine);
+
+			if ((distribution == sparse_zeros) && (uniform_distribution(engine) < 0.9f))
+			{
+				element = 0.0f;
+			}
+			if ((distribution == nan_heavy) && (uniform_distribution(engine) < 0.5f))
+			{
+				element = std::numeric_limits<float>::quiet_NaN();
+			}
+		}
+		return result;
+	}
+
+
+	std::vector<bfloat16_t> make_bfloats(const std::int64_t distribution)
+	{
+		const auto floats = make_floats(distribution);
+		std::vector<bfloat16_t> result(floats.size());
+		biovault::convert(floats.data(), result.data(), floats.size());
+		return result;
+	}
+
+
+	// Reports the throughput, given the number of bytes read and written per element.
+	void set_counters(benchmark::State& state, const std::size_t bytes_per_element)
+	{
+		const auto processed_elements = static_cast<std::int64_t>(state.iterations() * number_of_elements);
+
+		state.SetItemsProcessed(processed_elements);
+		state.SetBytesProcessed(processed_elements * static_cast<std::int64_t>(bytes_per_element));
+		state.counters["time/element"] = benchmark::Counter(static_cast<double>(processed_elements),
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	}
+
+
+	// Selects the kernel specified by the first argument of the benchmark. Returns
+	// false, and skips the benchmark, when the CPU does not support the kernel.
+	bool select_simd_kernel(benchmark::State& state)
+	{
+		const auto kernel = static_cast<simd_kernel>(state.range(0));
+
+		if (!biovault::set_simd_kernel(kernel))
+		{
+			state.SkipWithError((std::string{ get_name(kernel) } + " is not supported").c_str());
+			return false;
+		}
+		state.SetLabel(std::string{ get_name(kernel) } + "/" + get_name(state.range(1)));
+		return true;
+	}
+
+
+	void ScalarConversionFromFloat(benchmark::State& state)
+	{
+		const auto src = make_floats(state.range(0));
+		std::vector<bfloat16_t> dst(number_of_elements);
+
+		for (auto _ : state)
+		{
+			for (std::size_t i{}; i < number_of_elements; ++i)
+			{
+				dst[i] = bfloat16_t{ src[i] };
+			}
+			benchmark::DoNotOptimize(dst.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+	}
+
+
+	void BranchlessConversionFromFloat(benchmark::State& state)
+	{
+		const auto src = make_floats(state.range(0));
+		std::vector<bfloat16_t> dst(number_of_elements);
+
+		for (auto _ : state)
+		{
+			for (std::size_t i{}; i < number_of_elements; ++i)
+			{
+				dst[i] = bfloat16_t::from_float_branchless(src[i]);
+			}
+			benchmark::DoNotOptimize(dst.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+	}
+
+
+	void ScalarConversionToFloat(benchmark::State& state)
+	{
+		const auto src = make_bfloats(state.range(0));
+		std::vector<float> dst(number_of_elements);
+
+		for (auto _ : state)
+		{
+			for (std::size_t i{}; i < number_of_elements; ++i)
+			{
+				dst[i] = float{ src[i] };
+			}
+			benchmark::DoNotOptimize(dst.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(bfloat16_t) + sizeof(float));
+	}
+
+
+	void IntegerConstruction(benchmark::State& state)
+	{
+		std::vector<int> src(number_of_elements);
+		std::mt19937 engine;
+		std::uniform_int_distribution<int> uniform_distribution{ -100000, 100000 };
+
+		for (auto& element : src)
+		{
+			element = uniform_distribution(engine);
+		}
+		std::vector<bfloat16_t> dst(number_of_elements);
+
+		for (auto _ : state)
+		{
+			for (std::size_t i{}; i < number_of_elements; ++i)
+			{
+				dst[i] = bfloat16_t{ src[i] };
+			}
+			benchmark::DoNotOptimize(dst.data());
+			benchmark::ClobberMemory();
+		}
+		set_counters(state, sizeof(int) + sizeof(bfloat16_t));
+	}
+
+
+	void AddAssign(benchmark::State& state)
+	{
+		const auto src = make_floats(state.range(0));
+		std::vector<bfloat16_t> dst(number_of_elements, bfloat16_t{ 1.0f });
+
+		for (auto _ : state)
+		{
+			for (std::size_t i{}; i < number_of_elements; ++i)
+			{
+				dst[i] += src[i];
+			}
+			benchmark::DoNotOptimize(dst.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(float) + 2 * sizeof(bfloat16_t));
+	}
+
+
+	void BulkConversionFromFloat(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_floats(state.range(1));
+			std::vector<bfloat16_t> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	// Converts doubles (the floats of the distribution) directly, rounding only once.
+	void BulkConversionFromDouble(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto floats = make_floats(state.range(1));
+			const std::vector<double> src(floats.cbegin(), floats.cend());
+			std::vector<bfloat16_t> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(double) + sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	// Converts one channel of interleaved floats, the number of channels being the
+	// third argument, to contiguous bfloat16.
+	void StridedConversionFromFloat(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto stride = static_cast<std::ptrdiff_t>(state.range(2));
+			state.SetLabel(std::string{ get_name(biovault::get_simd_kernel()) } + "/" + get_name(state.range(1)) +
+				"/stride " + std::to_string(stride));
+
+			const auto floats = make_floats(state.range(1));
+			std::vector<float> src(floats.size() * static_cast<std::size_t>(stride));
+
+			for (std::size_t i{}; i < floats.size(); ++i)
+			{
+				src[i * static_cast<std::size_t>(stride)] = floats[i];
+			}
+			std::vector<bfloat16_t> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), stride, dst.data(), 1, number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	// Converts while measuring the error, per block of 256 elements.
+	void BulkConversionFromFloatWithError(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			constexpr std::size_t block_size{ 256 };
+			const auto src = make_floats(state.range(1));
+			std::vector<bfloat16_t> dst(number_of_elements);
+			std::vector<biovault::quantization_error> errors(biovault::get_number_of_blocks(number_of_elements, block_size));
+
+			for (auto _ : state)
+			{
+				biovault::convert_with_error(src.data(), dst.data(), number_of_elements, block_size, errors.data());
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::DoNotOptimize(errors.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void BulkConversionFromFp16(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto bfloats = make_bfloats(state.range(1));
+			std::vector<biovault::fp16_t> src(number_of_elements);
+			std::vector<bfloat16_t> dst(number_of_elements);
+			biovault::convert(bfloats.data(), src.data(), number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, 2 * sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void BulkConversionToFp16(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_bfloats(state.range(1));
+			std::vector<biovault::fp16_t> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, 2 * sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void BulkConversionFromFloatTowardZero(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_floats(state.range(1));
+			std::vector<bfloat16_t> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements, biovault::round_toward_zero);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void BulkStochasticConversionFromFloat(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_floats(state.range(1));
+			std::vector<bfloat16_t> dst(number_of_elements);
+			biovault::stochastic_rounding rounding;
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements, rounding);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(float) + sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void BulkConversionToFloat(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_bfloats(state.range(1));
+			std::vector<float> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(bfloat16_t) + sizeof(float));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	template <typename IntegerType>
+	void BulkConversionFromIntegers(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (biovault::set_simd_kernel(static_cast<simd_kernel>(state.range(0))))
+		{
+			std::vector<IntegerType> src(number_of_elements);
+			std::mt19937 engine;
+			std::uniform_int_distribution<int> uniform_distribution{
+				std::numeric_limits<IntegerType>::min(), std::numeric_limits<IntegerType>::max() };
+
+			for (auto& element : src)
+			{
+				element = static_cast<IntegerType>(uniform_distribution(engine));
+			}
+			std::vector<bfloat16_t> dst(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::convert(src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			state.SetLabel(get_name(biovault::get_simd_kernel()));
+			set_counters(state, sizeof(IntegerType) + sizeof(bfloat16_t));
+		}
+		else
+		{
+			state.SkipWithError("kernel is not supported");
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void Dot(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto a = make_bfloats(state.range(1));
+			const auto b = make_bfloats(all_normal);
+
+			for (auto _ : state)
+			{
+				benchmark::DoNotOptimize(biovault::dot(a.data(), b.data(), number_of_elements));
+			}
+			set_counters(state, 2 * sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void Axpy(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto x = make_bfloats(state.range(1));
+			std::vector<float> y(number_of_elements);
+
+			for (auto _ : state)
+			{
+				biovault::axpy(0.5f, x.data(), y.data(), number_of_elements);
+				benchmark::DoNotOptimize(y.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(bfloat16_t) + 2 * sizeof(float));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void Sum(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_bfloats(state.range(1));
+
+			for (auto _ : state)
+			{
+				benchmark::DoNotOptimize(biovault::sum(src.data(), number_of_elements));
+			}
+			set_counters(state, sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	// Computes the minimum, maximum and number of NaNs, and (when the third argument
+	// is nonzero) the histogram.
+	void Statistics(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_bfloats(state.range(1));
+			std::vector<std::uint64_t> histogram(biovault::histogram_size);
+			const auto histogram_data = (state.range(2) == 0) ? nullptr : histogram.data();
+
+			for (auto _ : state)
+			{
+				benchmark::DoNotOptimize(biovault::compute_statistics(src.data(), number_of_elements, histogram_data));
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	void RadixSort(benchmark::State& state)
+	{
+		const auto src = make_bfloats(state.range(0));
+		std::vector<bfloat16_t> data(number_of_elements);
+
+		for (auto _ : state)
+		{
+			std::copy(src.cbegin(), src.cend(), data.begin());
+			biovault::sort(data.data(), number_of_elements);
+			benchmark::DoNotOptimize(data.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(bfloat16_t));
+	}
+
+
+	// Reference for RadixSort: comparison sort, by the bfloat16 operator<.
+	void ComparisonSort(benchmark::State& state)
+	{
+		auto src = make_bfloats(state.range(0));
+
+		// NaN would violate the strict weak ordering that std::sort requires.
+		std::replace_if(src.begin(), src.end(), [](const bfloat16_t value) { return value != value; }, bfloat16_t{ 1.0f });
+
+		std::vector<bfloat16_t> data(number_of_elements);
+
+		for (auto _ : state)
+		{
+			std::copy(src.cbegin(), src.cend(), data.begin());
+			std::sort(data.begin(), data.end());
+			benchmark::DoNotOptimize(data.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(bfloat16_t));
+	}
+
+
+	// Selects the k smallest elements, with k specified by the second argument.
+	void TopK(benchmark::State& state)
+	{
+		const auto src = make_bfloats(state.range(0));
+		const auto k = static_cast<std::size_t>(state.range(1));
+		std::vector<std::size_t> indices(k);
+
+		for (auto _ : state)
+		{
+			biovault::top_k(src.data(), number_of_elements, k, indices.data(), biovault::select_smallest);
+			benchmark::DoNotOptimize(indices.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(bfloat16_t));
+	}
+
+
+	// Computes exp by table lookup.
+	void TableLookupExp(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (select_simd_kernel(state))
+		{
+			const auto src = make_bfloats(state.range(1));
+			std::vector<bfloat16_t> dst(number_of_elements);
+			const auto& table = biovault::bf16_math::get_exp_table();
+
+			for (auto _ : state)
+			{
+				biovault::bf16_math::apply(table, src.data(), dst.data(), number_of_elements);
+				benchmark::DoNotOptimize(dst.data());
+				benchmark::ClobberMemory();
+			}
+			set_counters(state, sizeof(bfloat16_t));
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+
+
+	// Computes exp by converting to float, calling std::exp, and converting back, for comparison.
+	void DirectExp(benchmark::State& state)
+	{
+		const auto src = make_bfloats(state.range(0));
+		std::vector<bfloat16_t> dst(number_of_elements);
+
+		for (auto _ : state)
+		{
+			for (std::size_t i{}; i < number_of_elements; ++i)
+			{
+				dst[i] = bfloat16_t(std::exp(float{ src[i] }));
+			}
+			benchmark::DoNotOptimize(dst.data());
+			benchmark::ClobberMemory();
+		}
+		state.SetLabel(get_name(state.range(0)));
+		set_counters(state, sizeof(bfloat16_t));
+	}
+
+
+	// Multiplies square matrices, of the size specified by the second argument.
+	void Gemm(benchmark::State& state)
+	{
+		const auto kernel = biovault::get_simd_kernel();
+
+		if (biovault::set_simd_kernel(static_cast<simd_kernel>(state.range(0))))
+		{
+			const auto size = static_cast<std::size_t>(state.range(1));
+			const std::vector<bfloat16_t> a(size * size, bfloat16_t{ 0.5f });
+			const std::vector<bfloat16_t> b(size * size, bfloat16_t{ 0.25f });
+			std::vector<float> c(size * size);
+
+			for (auto _ : state)
+			{
+				biovault::gemm(size, size, size, 1.0f, a.data(), size, b.data(), size, 0.0f, c.data(), size);
+				benchmark::DoNotOptimize(c.data());
+				benchmark::ClobberMemory();
+			}
+			state.SetLabel(get_name(biovault::get_simd_kernel()));
+			state.counters["FLOPS"] = benchmark::Counter(
+				2.0 * static_cast<double>(size * size * size), benchmark::Counter::kIsIterationInvariantRate);
+		}
+		else
+		{
+			state.SkipWithError("kernel is not supported");
+		}
+		biovault::set_simd_kernel(kernel);
+	}
+}
+
+
+BENCHMARK(ScalarConversionFromFloat)->ArgsProduct({ all_distributions });
+BENCHMARK(BranchlessConversionFromFloat)->ArgsProduct({ all_distributions });
+BENCHMARK(ScalarConversionToFloat)->ArgsProduct({ all_distributions });
+BENCHMARK(IntegerConstruction);
+BENCHMARK(AddAssign)->ArgsProduct({ all_distributions });
+BENCHMARK(BulkConversionFromFloat)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(BulkConversionFromDouble)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(StridedConversionFromFloat)->ArgsProduct({ all_simd_kernels, { all_normal }, { 2, 3, 4 } });
+BENCHMARK(BulkConversionFromFloatWithError)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(BulkConversionFromFp16)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(BulkConversionToFp16)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(BulkConversionFromFloatTowardZero)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(BulkStochasticConversionFromFloat)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(BulkConversionToFloat)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK_TEMPLATE(BulkConversionFromIntegers, std::uint8_t)->ArgsProduct({ all_simd_kernels });
+BENCHMARK_TEMPLATE(BulkConversionFromIntegers, std::int16_t)->ArgsProduct({ all_simd_kernels });
+BENCHMARK(Dot)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(Axpy)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(Sum)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(Statistics)->ArgsProduct({ all_simd_kernels, all_distributions, { 0, 1 } });
+BENCHMARK(RadixSort)->ArgsProduct({ all_distributions });
+BENCHMARK(ComparisonSort)->ArgsProduct({ all_distributions });
+BENCHMARK(TopK)->ArgsProduct({ all_distributions, { 10, 1000 } });
+BENCHMARK(TableLookupExp)->ArgsProduct({ all_simd_kernels, all_distributions });
+BENCHMARK(DirectExp)->ArgsProduct({ all_distributions });
+BENCHMARK(Gemm)->ArgsProduct({ all_simd_kernels, { 64, 256 } });
+
+BENCHMARK_MAIN();
@@ -0,0 +1,432 @@
+#ifndef BIOVAULT_BFLOAT16_BUFFER_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_BUFFER_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For fill_n and copy_n.
+#include <cstddef>   // For size_t.
+#include <cstdint>   // For uintptr_t.
+#include <mutex>
+#include <new>       // For bad_alloc.
+#include <utility>   // For swap.
+#include <vector>
+
+namespace biovault {
+
+	// The alignment of the data of a bfloat16_buffer, in bytes: the size of a cache
+	// line, and of an AVX-512 register.
+	constexpr std::size_t buffer_alignment{ 64 };
+
+	// Tag type, to construct a buffer without initializing its elements.
+	struct uninitialized_t {};
+
+	const uninitialized_t uninitialized{};
+
+
+	// Interface to the memory allocation of a bfloat16_buffer (similar to C++17
+	// std::pmr::memory_resource). Implementations must return memory that is aligned
+	// to buffer_alignment, and throw std::bad_alloc when they cannot allocate.
+	class buffer_memory_resource
+	{
+	public:
+		virtual ~buffer_memory_resource() = default;
+
+		virtual void* allocate(std::size_t size_in_bytes) = 0;
+
+		// Deallocates memory from allocate, with the same size_in_bytes.
+		virtual void deallocate(void* memory, std::size_t size_in_bytes) noexcept = 0;
+	};
+
+
+	// Allocates each block directly from the free store, by global operator new.
+	class new_delete_buffer_memory_resource : public buffer_memory_resource
+	{
+	public:
+		void* allocate(const std::size_t size_in_bytes) override
+		{
+			// Over-allocate, and store the pointer to the allocated memory just before
+			// the aligned block (C++14 does not have an aligned operator new).
+			void* const allocated{ ::operator new(size_in_bytes + buffer_alignment) };
+			const auto address = reinterpret_cast<std::uintptr_t>(allocated) + buffer_alignment;
+			void* const aligned{ reinterpret_cast<void*>(address - address % buffer_alignment) };
+			static_cast<void**>(aligned)[-1] = allocated;
+			return aligned;
+		}
+
+		void deallocate(void* const memory, std::size_t) noexcept override
+		{
+			if (memory != nullptr)
+			{
+				::operator delete(static_cast<void**>(memory)[-1]);
+			}
+		}
+	};
+
+
+	// Returns the memory resource that is used by default.
+	inline buffer_memory_resource& get_default_buffer_memory_resource()
+	{
+		static new_delete_buffer_memory_resource resource;
+		return resource;
+	}
+
+
+	// Thread-safe pool of reusable blocks. Deallocated blocks are cached by their
+	// size class (a power of two), and handed out again by a subsequent allocation
+	// of the same size class, so that scratch buffers that are repeatedly created
+	// and destructed do not need to go to the free store every time. The cached
+	// blocks are returned to the upstream resource by release(), or at destruction.
+	class buffer_pool : public buffer_memory_resource
+	{
+	public:
+		explicit buffer_pool(buffer_memory_resource& upstream = get_default_buffer_memory_resource())
+			: upstream_{ upstream }
+		{
+		}
+
+		buffer_pool(const buffer_pool&) = delete;
+		buffer_pool& operator=(const buffer_pool&) = delete;
+
+		~buffer_pool()
+		{
+			release();
+		}
+
+		void* allocate(const std::size_t size_in_bytes) override
+		{
+			if (size_in_bytes > (static_cast<std::size_t>(-1) >> 1))
+			{
+				throw std::bad_alloc{};
+			}
+			const auto size_class = get_size_class(size_in_bytes);
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+
+				if (size_class < free_blocks_.size() && !free_blocks_[size_class].empty())
+				{
+					void* const result{ free_blocks_[size_class].back() };
+					free_blocks_[size_class].pop_back();
+					return result;
+				}
+			}
+			return upstream_.allocate(get_block_size(size_class));
+		}
+
+		void deallocate(void* const memory, const std::size_t size_in_bytes) noexcept override
+		{
+			if (memory == nullptr)
+			{
+				return;
+			}
+			const auto size_class = get_size_class(size_in_bytes);
+			const std::lock_guard<std::mutex> lock{ mutex_ };
+
+			try
+			{
+				if (size_class >= free_blocks_.size())
+				{
+					free_blocks_.resize(size_class + 1);
+				}
+				free_blocks_[size_class].push_back(memory);
+			}
+			catch (const std::bad_alloc&)
+			{
+				upstream_.deallocate(memory, get_block_size(size_class));
+			}
+		}
+
+		// Returns all cached blocks to the upstream resource.
+		void release() noexcept
+		{
+			const std::lock_guard<std::mutex> lock{ mutex_ };
+
+			for (std::size_t size_class{}; size_class < free_blocks_.size(); ++size_class)
+			{
+				for (void* const block : free_blocks_[size_class])
+				{
+					upstream_.deallocate(block, get_block_size(size_class));
+				}
+				free_blocks_[size_class].clear();
+			}
+		}
+
+		// Returns the number of cached blocks, available for reuse.
+		std::size_t get_number_of_free_blocks() const
+		{
+			const std::lock_guard<std::mutex> lock{ mutex_ };
+			std::size_t result{};
+
+			for (const auto& blocks : free_blocks_)
+			{
+				result += blocks.size();
+			}
+			return result;
+		}
+
+	private:
+		// Size class k holds blocks of buffer_alignment * 2^k bytes.
+		static std::size_t get_size_class(const std::size_t size_in_bytes)
+		{
+			std::size_t size_class{};
+
+			while (get_block_size(size_class) < size_in_bytes)
+			{
+				++size_class;
+			}
+			return size_class;
+		}
+
+		static std::size_t get_block_size(const std::size_t size_class)
+		{
+			return buffer_alignment << size_class;
+		}
+
+		buffer_memory_resource& upstream_;
+		mutable std::mutex mutex_;
+		std::vector<std::vector<void*>> free_blocks_;
+	};
+
+
+	// Monotonic arena: allocates by bumping a pointer into large chunks of memory,
+	// which are only returned to the upstream resource by reset(), or at destruction.
+	// Deallocation of an individual block does nothing. Not thread-safe.
+	class buffer_arena : public buffer_memory_resource
+	{
+	public:
+		explicit buffer_arena(
+			const std::size_t chunk_size_in_bytes = std::size_t{ 1 } << 20,
+			buffer_memory_resource& upstream = get_default_buffer_memory_resource())
+			: chunk_size_in_bytes_{ round_up(chunk_size_in_bytes) }, upstream_{ upstream }
+		{
+		}
+
+		buffer_arena(const buffer_arena&) = delete;
+		buffer_arena& operator=(const buffer_arena&) = delete;
+
+		~buffer_arena()
+		{
+			reset();
+		}
+
+		void* allocate(std::size_t size_in_bytes) override
+		{
+			size_in_bytes = round_up(size_in_bytes);
+
+			if (chunks_.empty() || (size_in_bytes > chunks_.back().size_in_bytes - used_in_current_chunk_))
+			{
+				// Note: a block that does not fit a regular chunk gets a chunk of its own.
+				const auto new_chunk_size = std::max(size_in_bytes, chunk_size_in_bytes_);
+				chunks_.reserve(chunks_.size() + 1);
+				chunks_.push_back({ static_cast<char*>(upstream_.allocate(new_chunk_size)), new_chunk_size });
+				used_in_current_chunk_ = 0;
+			}
+			char* const result{ chunks_.back().memory + used_in_current_chunk_ };
+			used_in_current_chunk_ += size_in_bytes;
+			return result;
+		}
+
+		void deallocate(void*, std::size_t) noexcept override
+		{
+		}
+
+		// Returns all chunks to the upstream resource. Invalidates all memory that
+		// was allocated by this arena.
+		void reset() noexcept
+		{
+			for (const auto& chunk : chunks_)
+			{
+				upstream_.deallocate(chunk.memory, chunk.size_in_bytes);
+			}
+			chunks_.clear();
+			used_in_current_chunk_ = 0;
+		}
+
+	private:
+		struct chunk
+		{
+			char* memory;
+			std::size_t size_in_bytes;
+		};
+
+		static std::size_t round_up(const std::size_t size_in_bytes)
+		{
+			return (size_in_bytes + buffer_alignment - 1) / buffer_alignment * buffer_alignment;
+		}
+
+		const std::size_t chunk_size_in_bytes_;
+		buffer_memory_resource& upstream_;
+		std::vector<chunk> chunks_;
+		std::size_t used_in_current_chunk_{};
+	};
+
+
+	// Contiguous, fixed-size array of bfloat16_t elements, aligned to buffer_alignment,
+	// allocated by a pluggable buffer_memory_resource. Unlike std::vector, it supports
+	// construction without initializing the elements. The resource must outlive the buffer.
+	class bfloat16_buffer
+	{
+	public:
+		using value_type = bfloat16_t;
+		using size_type = std::size_t;
+		using iterator = bfloat16_t*;
+		using const_iterator = const bfloat16_t*;
+
+		bfloat16_buffer() noexcept = default;
+
+		// Constructs a buffer of n zero-initialized elements.
+		explicit bfloat16_buffer(const std::size_t n,
+			buffer_memory_resource& resource = get_default_buffer_memory_resource())
+			: bfloat16_buffer(n, uninitialized, resource)
+		{
+			std::fill_n(data_, n, bfloat16_t{});
+		}
+
+		// Constructs a buffer of n elements that have the specified value.
+		bfloat16_buffer(const std::size_t n, const bfloat16_t value,
+			buffer_memory_resource& resource = get_default_buffer_memory_resource())
+			: bfloat16_buffer(n, uninitialized, resource)
+		{
+			std::fill_n(data_, n, value);
+		}
+
+		// Constructs a buffer of n elements that have an indeterminate value, to be
+		// overwritten, for example by a bulk conversion.
+		bfloat16_buffer(const std::size_t n, uninitialized_t,
+			buffer_memory_resource& resource = get_default_buffer_memory_resource())
+			: resource_{ &resource }
+		{
+			if (n > 0)
+			{
+				if (n > static_cast<std::size_t>(-1) / (2 * sizeof(bfloat16_t)))
+				{
+					throw std::bad_alloc{};
+				}
+				data_ = static_cast<bfloat16_t*>(resource.allocate(n * sizeof(bfloat16_t)));
+				size_ = n;
+			}
+		}
+
+		bfloat16_buffer(const bfloat16_buffer& other)
+			: bfloat16_buffer(other.size_, uninitialized, *other.resource_)
+		{
+			std::copy_n(other.data_, size_, data_);
+		}
+
+		bfloat16_buffer(bfloat16_buffer&& other) noexcept
+		{
+			swap(other);
+		}
+
+		bfloat16_buffer& operator=(const bfloat16_buffer& other)
+		{
+			if (this != &other)
+			{
+				bfloat16_buffer{ other }.swap(*this);
+			}
+			return *this;
+		}
+
+		bfloat16_buffer& operator=(bfloat16_buffer&& other) noexcept
+		{
+			bfloat16_buffer{ std::move(other) }.swap(*this);
+			return *this;
+		}
+
+		~bfloat16_buffer()
+		{
+			resource_->deallocate(data_, size_ * sizeof(bfloat16_t));
+		}
+
+		void swap(bfloat16_buffer& other) noexcept
+		{
+			std::swap(data_, other.data_);
+			std::swap(size_, other.size_);
+			std::swap(resource_, other.resource_);
+		}
+
+		bfloat16_t* data() noexcept
+		{
+			return data_;
+		}
+
+		const bfloat16_t* data() const noexcept
+		{
+			return data_;
+		}
+
+		std::size_t size() const noexcept
+		{
+			return size_;
+		}
+
+		bool empty() const noexcept
+		{
+			return size_ == 0;
+		}
+
+		bfloat16_t& operator[](const std::size_t i) noexcept
+		{
+			return data_[i];
+		}
+
+		const bfloat16_t& operator[](const std::size_t i) const noexcept
+		{
+			return data_[i];
+		}
+
+		iterator begin() noexcept
+		{
+			return data_;
+		}
+
+		iterator end() noexcept
+		{
+			return data_ + size_;
+		}
+
+		const_iterator begin() const noexcept
+		{
+			return data_;
+		}
+
+		const_iterator end() const noexcept
+		{
+			return data_ + size_;
+		}
+
+		buffer_memory_resource& get_memory_resource() const noexcept
+		{
+			return *resource_;
+		}
+
+	private:
+		bfloat16_t* data_{};
+		std::size_t size_{};
+		buffer_memory_resource* resource_{ &get_default_buffer_memory_resource() };
+	};
+
+
+	inline void swap(bfloat16_buffer& lhs, bfloat16_buffer& rhs) noexcept
+	{
+		lhs.swap(rhs);
+	}
+
+}
+
+#endif
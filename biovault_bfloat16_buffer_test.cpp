@@ -0,0 +1,194 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_buffer.h"
+#include "biovault_bfloat16_buffer.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstdint>
+#include <utility> // For move.
+#include <vector>
+
+using biovault::bfloat16_buffer;
+using biovault::bfloat16_t;
+
+
+namespace
+{
+	bool is_aligned(const void* const memory)
+	{
+		return reinterpret_cast<std::uintptr_t>(memory) % biovault::buffer_alignment == 0;
+	}
+
+
+	// Counts the allocations that reach the default resource.
+	class counting_memory_resource : public biovault::buffer_memory_resource
+	{
+	public:
+		void* allocate(const std::size_t size_in_bytes) override
+		{
+			++number_of_allocations;
+			return biovault::get_default_buffer_memory_resource().allocate(size_in_bytes);
+		}
+
+		void deallocate(void* const memory, const std::size_t size_in_bytes) noexcept override
+		{
+			if (memory != nullptr)
+			{
+				++number_of_deallocations;
+			}
+			biovault::get_default_buffer_memory_resource().deallocate(memory, size_in_bytes);
+		}
+
+		int number_of_allocations{};
+		int number_of_deallocations{};
+	};
+}
+
+
+GTEST_TEST(bfloat16_buffer, DefaultConstructedBufferIsEmpty)
+{
+	const bfloat16_buffer buffer;
+
+	EXPECT_TRUE(buffer.empty());
+	EXPECT_EQ(buffer.size(), 0U);
+	EXPECT_EQ(buffer.begin(), buffer.end());
+}
+
+
+GTEST_TEST(bfloat16_buffer, DataIsAligned)
+{
+	for (std::size_t n{ 1 }; n <= 1000; ++n)
+	{
+		const bfloat16_buffer buffer(n, biovault::uninitialized);
+		ASSERT_EQ(buffer.size(), n);
+		ASSERT_TRUE(is_aligned(buffer.data()));
+	}
+}
+
+
+GTEST_TEST(bfloat16_buffer, ElementsAreZeroInitializedByDefault)
+{
+	const bfloat16_buffer buffer(1000);
+
+	for (const auto element : buffer)
+	{
+		ASSERT_EQ(get_raw_bits(element), 0U);
+	}
+}
+
+
+GTEST_TEST(bfloat16_buffer, ElementsCanBeInitializedByValue)
+{
+	const bfloat16_buffer buffer(1000, bfloat16_t{ 1.0f });
+
+	for (const auto element : buffer)
+	{
+		ASSERT_EQ(get_raw_bits(element), 0x3F80U);
+	}
+}
+
+
+GTEST_TEST(bfloat16_buffer, CopyAndMove)
+{
+	bfloat16_buffer original(100, bfloat16_t{ 2.0f });
+	const bfloat16_buffer copy{ original };
+
+	ASSERT_EQ(copy.size(), original.size());
+	EXPECT_NE(copy.data(), original.data());
+	EXPECT_EQ(get_raw_bits(copy[99]), get_raw_bits(original[99]));
+
+	const auto* const data = original.data();
+	bfloat16_buffer moved{ std::move(original) };
+
+	EXPECT_EQ(moved.data(), data);
+	EXPECT_EQ(moved.size(), 100U);
+
+	moved = copy;
+	EXPECT_EQ(moved.size(), copy.size());
+	EXPECT_NE(moved.data(), copy.data());
+}
+
+
+GTEST_TEST(bfloat16_buffer, UsesSpecifiedMemoryResource)
+{
+	counting_memory_resource resource;
+	{
+		const bfloat16_buffer buffer(42, biovault::uninitialized, resource);
+		EXPECT_EQ(&buffer.get_memory_resource(), &resource);
+		EXPECT_EQ(resource.number_of_allocations, 1);
+	}
+	EXPECT_EQ(resource.number_of_deallocations, 1);
+}
+
+
+GTEST_TEST(bfloat16_buffer, PoolReusesDeallocatedBlocks)
+{
+	counting_memory_resource upstream;
+	{
+		biovault::buffer_pool pool{ upstream };
+		const bfloat16_t* previous_data{};
+
+		// All these buffers fit in a block of 2048 bytes.
+
+		for (int i{}; i < 100; ++i)
+		{
+			bfloat16_buffer buffer(900 + i, biovault::uninitialized, pool);
+			ASSERT_TRUE(is_aligned(buffer.data()));
+
+			if (i > 0)
+			{
+				ASSERT_EQ(buffer.data(), previous_data);
+			}
+			previous_data = buffer.data();
+		}
+		EXPECT_EQ(upstream.number_of_allocations, 1);
+		EXPECT_EQ(pool.get_number_of_free_blocks(), 1U);
+
+		pool.release();
+		EXPECT_EQ(pool.get_number_of_free_blocks(), 0U);
+		EXPECT_EQ(upstream.number_of_deallocations, 1);
+	}
+	EXPECT_EQ(upstream.number_of_deallocations, 1);
+}
+
+
+GTEST_TEST(bfloat16_buffer, ArenaAllocatesAlignedBlocksFromChunks)
+{
+	counting_memory_resource upstream;
+	{
+		biovault::buffer_arena arena{ 4096, upstream };
+		std::vector<bfloat16_buffer> buffers;
+
+		for (int i{}; i < 100; ++i)
+		{
+			buffers.emplace_back(10, biovault::uninitialized, arena);
+			ASSERT_TRUE(is_aligned(buffers.back().data()));
+		}
+		// Each block of 20 bytes is rounded up to 64 bytes, so 64 blocks fit a chunk.
+		EXPECT_EQ(upstream.number_of_allocations, 2);
+
+		// A large block gets its own chunk.
+		const bfloat16_buffer large_buffer(100000, biovault::uninitialized, arena);
+		EXPECT_EQ(upstream.number_of_allocations, 3);
+		EXPECT_EQ(upstream.number_of_deallocations, 0);
+	}
+	EXPECT_EQ(upstream.number_of_deallocations, 3);
+}
@@ -0,0 +1,521 @@
+#ifndef BIOVAULT_BFLOAT16_EIGEN_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_EIGEN_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Integration of bfloat16_t into the Eigen library (https://eigen.tuxfamily.org),
+// allowing Eigen matrices and arrays of bfloat16_t. Requires Eigen 3.4 (or later),
+// which is not included with this library.
+//
+// Defines Eigen::NumTraits<bfloat16_t>, and the scalar math functions that Eigen
+// looks up by argument-dependent lookup. On x86 and x64, it also defines packet
+// math, processing eight bfloat16 values at a time, so that coefficient-wise
+// expressions, reductions and products vectorize. Each packet operation computes
+// in float, and rounds the result only once to bfloat16, like the corresponding
+// scalar operator. The packets use the SSE2 helpers of the bulk conversion
+// kernels. They do not use the run-time dispatch of those kernels, as Eigen
+// selects its packet types at compile time. The packet math is switched off by
+// defining EIGEN_DONT_VECTORIZE or BIOVAULT_BFLOAT16_NO_SIMD.
+
+#include "biovault_bfloat16.h"
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <cstdint>
+#include <limits> // For numeric_limits.
+
+namespace biovault {
+
+	// Scalar math functions, found by Eigen via argument-dependent lookup (for
+	// example, by numext::abs, numext::sqrt and numext::isnan).
+	inline bfloat16_t abs(const bfloat16_t x)
+	{
+		return bfloat16_t(static_cast<std::uint16_t>(get_raw_bits(x) & 0x7FFFU), true);
+	}
+
+	inline bfloat16_t sqrt(const bfloat16_t x)
+	{
+		return bfloat16_t::from_float_branchless(std::sqrt(static_cast<float>(x)));
+	}
+
+	inline bool isnan(const bfloat16_t x)
+	{
+		return detail::is_nan_bits(get_raw_bits(x));
+	}
+
+	inline bool isinf(const bfloat16_t x)
+	{
+		return (get_raw_bits(x) & 0x7FFFU) == 0x7F80U;
+	}
+
+	inline bool isfinite(const bfloat16_t x)
+	{
+		return (get_raw_bits(x) & 0x7F80U) != 0x7F80U;
+	}
+
+}
+
+
+namespace Eigen {
+
+	template <>
+	struct NumTraits<biovault::bfloat16_t> : GenericNumTraits<biovault::bfloat16_t>
+	{
+		typedef biovault::bfloat16_t Real;
+		typedef biovault::bfloat16_t NonInteger;
+		typedef biovault::bfloat16_t Literal;
+
+		static biovault::bfloat16_t epsilon()
+		{
+			return std::numeric_limits<biovault::bfloat16_t>::epsilon();
+		}
+
+		// About 0.05, like the dummy_precision of Eigen::bfloat16.
+		static biovault::bfloat16_t dummy_precision()
+		{
+			return biovault::bfloat16_t(0x3D4D, true);
+		}
+
+		static biovault::bfloat16_t highest()
+		{
+			return std::numeric_limits<biovault::bfloat16_t>::max();
+		}
+
+		static biovault::bfloat16_t lowest()
+		{
+			return std::numeric_limits<biovault::bfloat16_t>::lowest();
+		}
+
+		static biovault::bfloat16_t infinity()
+		{
+			return std::numeric_limits<biovault::bfloat16_t>::infinity();
+		}
+
+		static biovault::bfloat16_t quiet_NaN()
+		{
+			return std::numeric_limits<biovault::bfloat16_t>::quiet_NaN();
+		}
+
+		static int digits10()
+		{
+			return std::numeric_limits<biovault::bfloat16_t>::digits10;
+		}
+	};
+
+}
+
+
+#if defined(BIOVAULT_BFLOAT16_SSE2) && defined(EIGEN_VECTORIZE_SSE2)
+#define BIOVAULT_BFLOAT16_EIGEN_PACKET_MATH
+
+namespace biovault {
+
+	namespace detail {
+
+		// Eight bfloat16 values. The number 64 distinguishes this packet type from the
+		// other eigen_packet_wrapper<__m128i, N> types, defined by Eigen itself.
+		// (GCC warns that the vector attributes of __m128i are ignored in a template
+		// argument, like it does for the packet types of Eigen.)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+		using eigen_packet = Eigen::internal::eigen_packet_wrapper<__m128i, 64>;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+		namespace sse2 {
+
+			// Rounds two times four floats to eight bfloat16 values.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i round_to_bfloat16(const __m128 low, const __m128 high)
+			{
+				return pack(convert_to_bits_of_bfloat16(low), convert_to_bits_of_bfloat16(high));
+			}
+
+			// Applies the specified operation to the float values of the packets.
+			template <typename Operation>
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i apply_in_float(
+				const __m128i a, const __m128i b, const Operation operation)
+			{
+				return round_to_bfloat16(
+					operation(widen_low(a), widen_low(b)),
+					operation(widen_high(a), widen_high(b)));
+			}
+
+			// Returns a 16-bit mask for each element, telling whether the float value of
+			// a is less than that of b.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i get_less_mask(const __m128i a, const __m128i b)
+			{
+				// As the comparison masks are either 0 or -1, the signed saturating pack
+				// keeps them intact, as 16-bit masks.
+				return _mm_packs_epi32(
+					_mm_castps_si128(_mm_cmplt_ps(widen_low(a), widen_low(b))),
+					_mm_castps_si128(_mm_cmplt_ps(widen_high(a), widen_high(b))));
+			}
+
+			// Selects the elements of a where the mask is set, and those of b elsewhere.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128i select_bits(const __m128i mask, const __m128i a, const __m128i b)
+			{
+				return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+			}
+
+			// Returns the sum of the four floats of the argument.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline float get_horizontal_sum(const __m128 f)
+			{
+				const __m128 sum = _mm_add_ps(f, _mm_movehl_ps(f, f));
+				return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+			}
+		}
+	}
+
+}
+
+
+namespace Eigen {
+
+	namespace internal {
+
+		template <>
+		struct is_arithmetic<biovault::detail::eigen_packet>
+		{
+			enum { value = true };
+		};
+
+		template <>
+		struct packet_traits<biovault::bfloat16_t> : default_packet_traits
+		{
+			typedef biovault::detail::eigen_packet type;
+			typedef biovault::detail::eigen_packet half;
+
+			enum
+			{
+				Vectorizable = 1,
+				AlignedOnScalar = 1,
+				size = 8,
+				HasHalfPacket = 0,
+
+				HasAdd = 1,
+				HasSub = 1,
+				HasMul = 1,
+				HasDiv = 1,
+				HasNegate = 1,
+				HasAbs = 1,
+				HasAbs2 = 0,
+				HasMin = 1,
+				HasMax = 1,
+				HasConj = 1,
+				HasSetLinear = 0,
+				HasBlend = 0,
+				HasCmp = 0
+			};
+		};
+
+		template <>
+		struct unpacket_traits<biovault::detail::eigen_packet>
+		{
+			typedef biovault::bfloat16_t type;
+			typedef biovault::detail::eigen_packet half;
+
+			enum
+			{
+				size = 8,
+				alignment = Aligned16,
+				vectorizable = true,
+				masked_load_available = false,
+				masked_store_available = false
+			};
+		};
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pset1<biovault::detail::eigen_packet>(
+			const biovault::bfloat16_t& from)
+		{
+			return _mm_set1_epi16(static_cast<short>(get_raw_bits(from)));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::bfloat16_t pfirst<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& from)
+		{
+			return biovault::bfloat16_t(static_cast<std::uint16_t>(_mm_extract_epi16(from, 0)), true);
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pload<biovault::detail::eigen_packet>(
+			const biovault::bfloat16_t* const from)
+		{
+			return _mm_load_si128(reinterpret_cast<const __m128i*>(from));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet ploadu<biovault::detail::eigen_packet>(
+			const biovault::bfloat16_t* const from)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+		}
+
+		// Loads from[0], from[0], from[1], from[1], ..., from[3], from[3].
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet ploaddup<biovault::detail::eigen_packet>(
+			const biovault::bfloat16_t* const from)
+		{
+			const __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(from));
+			return _mm_unpacklo_epi16(bits, bits);
+		}
+
+		// Loads four times from[0], followed by four times from[1].
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet ploadquad<biovault::detail::eigen_packet>(
+			const biovault::bfloat16_t* const from)
+		{
+			const __m128i bits = _mm_set1_epi32(static_cast<int>(
+				get_raw_bits(from[0]) | (static_cast<std::uint32_t>(get_raw_bits(from[1])) << 16)));
+			const __m128i pairs = _mm_unpacklo_epi16(bits, bits);
+			return _mm_unpacklo_epi32(pairs, pairs);
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE void pstore<biovault::bfloat16_t>(
+			biovault::bfloat16_t* const to, const biovault::detail::eigen_packet& from)
+		{
+			_mm_store_si128(reinterpret_cast<__m128i*>(to), from);
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE void pstoreu<biovault::bfloat16_t>(
+			biovault::bfloat16_t* const to, const biovault::detail::eigen_packet& from)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(to), from);
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pgather<biovault::bfloat16_t, biovault::detail::eigen_packet>(
+			const biovault::bfloat16_t* const from, const Index stride)
+		{
+			const auto get = [from, stride](const Index i)
+			{
+				return static_cast<short>(get_raw_bits(from[i * stride]));
+			};
+			return _mm_set_epi16(get(7), get(6), get(5), get(4), get(3), get(2), get(1), get(0));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE void pscatter<biovault::bfloat16_t, biovault::detail::eigen_packet>(
+			biovault::bfloat16_t* const to, const biovault::detail::eigen_packet& from, const Index stride)
+		{
+			alignas(16) biovault::bfloat16_t elements[8];
+			_mm_store_si128(reinterpret_cast<__m128i*>(elements), from);
+
+			for (Index i{}; i < 8; ++i)
+			{
+				to[i * stride] = elements[i];
+			}
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet padd<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a, const biovault::detail::eigen_packet& b)
+		{
+			return biovault::detail::sse2::apply_in_float(a, b,
+				[](const __m128 x, const __m128 y) { return _mm_add_ps(x, y); });
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet psub<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a, const biovault::detail::eigen_packet& b)
+		{
+			return biovault::detail::sse2::apply_in_float(a, b,
+				[](const __m128 x, const __m128 y) { return _mm_sub_ps(x, y); });
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pmul<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a, const biovault::detail::eigen_packet& b)
+		{
+			return biovault::detail::sse2::apply_in_float(a, b,
+				[](const __m128 x, const __m128 y) { return _mm_mul_ps(x, y); });
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pdiv<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a, const biovault::detail::eigen_packet& b)
+		{
+			return biovault::detail::sse2::apply_in_float(a, b,
+				[](const __m128 x, const __m128 y) { return _mm_div_ps(x, y); });
+		}
+
+		// Computes a * b + c in float, and rounds only once to bfloat16. (The float
+		// product of two bfloat16 values is exact.)
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pmadd(const biovault::detail::eigen_packet& a,
+			const biovault::detail::eigen_packet& b, const biovault::detail::eigen_packet& c)
+		{
+			using namespace biovault::detail::sse2;
+			return round_to_bfloat16(
+				_mm_add_ps(_mm_mul_ps(widen_low(a), widen_low(b)), widen_low(c)),
+				_mm_add_ps(_mm_mul_ps(widen_high(a), widen_high(b)), widen_high(c)));
+		}
+
+		// Like bfloat16_t::operator-(), only flips the sign bits.
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pnegate(const biovault::detail::eigen_packet& a)
+		{
+			return _mm_xor_si128(a, _mm_set1_epi16(static_cast<short>(0x8000)));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pconj(const biovault::detail::eigen_packet& a)
+		{
+			return a;
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pabs(const biovault::detail::eigen_packet& a)
+		{
+			return _mm_and_si128(a, _mm_set1_epi16(0x7FFF));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pmin<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a, const biovault::detail::eigen_packet& b)
+		{
+			// Like std::min(a, b): b < a ? b : a.
+			using namespace biovault::detail::sse2;
+			return select_bits(get_less_mask(b, a), b, a);
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet pmax<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a, const biovault::detail::eigen_packet& b)
+		{
+			// Like std::max(a, b): a < b ? b : a.
+			using namespace biovault::detail::sse2;
+			return select_bits(get_less_mask(a, b), b, a);
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::detail::eigen_packet preverse(const biovault::detail::eigen_packet& a)
+		{
+			const __m128i swapped_halves = _mm_shuffle_epi32(a, 0x4E);
+			return _mm_shufflehi_epi16(_mm_shufflelo_epi16(swapped_halves, 0x1B), 0x1B);
+		}
+
+		// The reductions compute in float, and round only once to bfloat16.
+		template <>
+		EIGEN_STRONG_INLINE biovault::bfloat16_t predux<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a)
+		{
+			using namespace biovault::detail::sse2;
+			return biovault::bfloat16_t::from_float_branchless(
+				get_horizontal_sum(_mm_add_ps(widen_low(a), widen_high(a))));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::bfloat16_t predux_mul<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a)
+		{
+			using namespace biovault::detail::sse2;
+			const __m128 products = _mm_mul_ps(widen_low(a), widen_high(a));
+			const __m128 pairs = _mm_mul_ps(products, _mm_movehl_ps(products, products));
+			return biovault::bfloat16_t::from_float_branchless(
+				_mm_cvtss_f32(_mm_mul_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1))));
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::bfloat16_t predux_min<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a)
+		{
+			alignas(16) biovault::bfloat16_t elements[8];
+			_mm_store_si128(reinterpret_cast<__m128i*>(elements), a);
+			auto result = elements[0];
+
+			for (const auto element : elements)
+			{
+				result = numext::mini(result, element);
+			}
+			return result;
+		}
+
+		template <>
+		EIGEN_STRONG_INLINE biovault::bfloat16_t predux_max<biovault::detail::eigen_packet>(
+			const biovault::detail::eigen_packet& a)
+		{
+			alignas(16) biovault::bfloat16_t elements[8];
+			_mm_store_si128(reinterpret_cast<__m128i*>(elements), a);
+			auto result = elements[0];
+
+			for (const auto element : elements)
+			{
+				result = numext::maxi(result, element);
+			}
+			return result;
+		}
+
+		// Transposes a block of eight packets, as used by the matrix product kernels.
+		EIGEN_STRONG_INLINE void ptranspose(PacketBlock<biovault::detail::eigen_packet, 8>& kernel)
+		{
+			const __m128i a = _mm_unpacklo_epi16(kernel.packet[0], kernel.packet[1]);
+			const __m128i b = _mm_unpacklo_epi16(kernel.packet[2], kernel.packet[3]);
+			const __m128i c = _mm_unpacklo_epi16(kernel.packet[4], kernel.packet[5]);
+			const __m128i d = _mm_unpacklo_epi16(kernel.packet[6], kernel.packet[7]);
+			const __m128i e = _mm_unpackhi_epi16(kernel.packet[0], kernel.packet[1]);
+			const __m128i f = _mm_unpackhi_epi16(kernel.packet[2], kernel.packet[3]);
+			const __m128i g = _mm_unpackhi_epi16(kernel.packet[4], kernel.packet[5]);
+			const __m128i h = _mm_unpackhi_epi16(kernel.packet[6], kernel.packet[7]);
+
+			const __m128i ab_low = _mm_unpacklo_epi32(a, b);
+			const __m128i ab_high = _mm_unpackhi_epi32(a, b);
+			const __m128i cd_low = _mm_unpacklo_epi32(c, d);
+			const __m128i cd_high = _mm_unpackhi_epi32(c, d);
+			const __m128i ef_low = _mm_unpacklo_epi32(e, f);
+			const __m128i ef_high = _mm_unpackhi_epi32(e, f);
+			const __m128i gh_low = _mm_unpacklo_epi32(g, h);
+			const __m128i gh_high = _mm_unpackhi_epi32(g, h);
+
+			kernel.packet[0] = _mm_unpacklo_epi64(ab_low, cd_low);
+			kernel.packet[1] = _mm_unpackhi_epi64(ab_low, cd_low);
+			kernel.packet[2] = _mm_unpacklo_epi64(ab_high, cd_high);
+			kernel.packet[3] = _mm_unpackhi_epi64(ab_high, cd_high);
+			kernel.packet[4] = _mm_unpacklo_epi64(ef_low, gh_low);
+			kernel.packet[5] = _mm_unpackhi_epi64(ef_low, gh_low);
+			kernel.packet[6] = _mm_unpacklo_epi64(ef_high, gh_high);
+			kernel.packet[7] = _mm_unpackhi_epi64(ef_high, gh_high);
+		}
+
+		// Transposes the first four elements of four packets into the first halves of
+		// the packets, and the last four elements into their second halves.
+		EIGEN_STRONG_INLINE void ptranspose(PacketBlock<biovault::detail::eigen_packet, 4>& kernel)
+		{
+			const __m128i a = _mm_unpacklo_epi16(kernel.packet[0], kernel.packet[1]);
+			const __m128i b = _mm_unpacklo_epi16(kernel.packet[2], kernel.packet[3]);
+			const __m128i c = _mm_unpackhi_epi16(kernel.packet[0], kernel.packet[1]);
+			const __m128i d = _mm_unpackhi_epi16(kernel.packet[2], kernel.packet[3]);
+
+			kernel.packet[0] = _mm_unpacklo_epi32(a, b);
+			kernel.packet[1] = _mm_unpackhi_epi32(a, b);
+			kernel.packet[2] = _mm_unpacklo_epi32(c, d);
+			kernel.packet[3] = _mm_unpackhi_epi32(c, d);
+		}
+	}
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_eigen.h"
+#include "biovault_bfloat16_eigen.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstddef> // For size_t.
+#include <cstdint>
+#include <limits>
+#include <random>
+
+using biovault::bfloat16_t;
+
+
+namespace
+{
+	using bfloat16_array = Eigen::Array<bfloat16_t, Eigen::Dynamic, 1>;
+	using bfloat16_matrix = Eigen::Matrix<bfloat16_t, Eigen::Dynamic, Eigen::Dynamic>;
+
+	// An odd number of elements, to check the tail that does not fill a packet.
+	constexpr Eigen::Index array_size{ 1003 };
+
+
+	bfloat16_t raw_bits_to_bfloat16(const std::uint32_t bits)
+	{
+		return bfloat16_t(static_cast<std::uint16_t>(bits), true);
+	}
+
+
+	// Returns random bfloat16 values, of which the bits are either entirely random
+	// (including NaNs, infinities and denormals), or limited by the specified mask.
+	bfloat16_array make_bfloats(const unsigned seed, const std::uint16_t mask = 0xFFFF)
+	{
+		std::mt19937 generator(seed);
+		bfloat16_array result(array_size);
+
+		for (auto& element : result)
+		{
+			element = raw_bits_to_bfloat16(static_cast<std::uint32_t>(generator()) & mask);
+		}
+		return result;
+	}
+
+
+	// Returns random small integers, from -2 to 2, so that sums and products of
+	// them (as computed by the tests) are exact, in bfloat16.
+	bfloat16_matrix make_small_integers(const Eigen::Index rows, const Eigen::Index cols, const unsigned seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_int_distribution<int> distribution(-2, 2);
+		bfloat16_matrix result(rows, cols);
+
+		for (Eigen::Index j{}; j < cols; ++j)
+		{
+			for (Eigen::Index i{}; i < rows; ++i)
+			{
+				result(i, j) = bfloat16_t(distribution(generator));
+			}
+		}
+		return result;
+	}
+
+
+	template <typename Expression, typename Operation>
+	void expect_each_element_equals_scalar_operation(const Expression& expression,
+		const bfloat16_array& a, const bfloat16_array& b, const Operation operation)
+	{
+		const bfloat16_array result = expression;
+		ASSERT_EQ(result.size(), a.size());
+
+		for (Eigen::Index i{}; i < a.size(); ++i)
+		{
+			EXPECT_EQ(get_raw_bits(result[i]), get_raw_bits(operation(a[i], b[i])));
+		}
+	}
+
+}
+
+
+GTEST_TEST(bfloat16_eigen, NumTraits)
+{
+	using num_traits = Eigen::NumTraits<bfloat16_t>;
+
+	static_assert(!num_traits::IsInteger, "bfloat16 is not an integer type");
+	static_assert(num_traits::IsSigned, "bfloat16 is signed");
+
+	EXPECT_EQ(get_raw_bits(num_traits::epsilon()), get_raw_bits(std::numeric_limits<bfloat16_t>::epsilon()));
+	EXPECT_EQ(get_raw_bits(num_traits::highest()), get_raw_bits(std::numeric_limits<bfloat16_t>::max()));
+	EXPECT_EQ(get_raw_bits(num_traits::lowest()), get_raw_bits(std::numeric_limits<bfloat16_t>::lowest()));
+	EXPECT_EQ(num_traits::digits10(), std::numeric_limits<bfloat16_t>::digits10);
+	EXPECT_TRUE(Eigen::numext::isnan(num_traits::quiet_NaN()));
+	EXPECT_TRUE(Eigen::numext::isinf(num_traits::infinity()));
+	EXPECT_FALSE(Eigen::numext::isfinite(num_traits::infinity()));
+	EXPECT_TRUE(Eigen::numext::isfinite(num_traits::highest()));
+	EXPECT_LT(num_traits::epsilon(), num_traits::dummy_precision());
+}
+
+
+GTEST_TEST(bfloat16_eigen, HasPacketMathOnX86)
+{
+#ifdef BIOVAULT_BFLOAT16_EIGEN_PACKET_MATH
+	EXPECT_TRUE(Eigen::internal::packet_traits<bfloat16_t>::Vectorizable);
+	EXPECT_EQ(Eigen::internal::packet_traits<bfloat16_t>::size, 8);
+	EXPECT_EQ(Eigen::internal::unpacket_traits<Eigen::internal::packet_traits<bfloat16_t>::type>::size, 8);
+#else
+	GTEST_SKIP() << "The packet math is not available.";
+#endif
+}
+
+
+GTEST_TEST(bfloat16_eigen, CoefficientWiseOperationsEqualScalarOperators)
+{
+	const auto a = make_bfloats(1);
+	const auto b = make_bfloats(2);
+
+	expect_each_element_equals_scalar_operation(a + b, a, b, [](bfloat16_t x, bfloat16_t y) { return x + y; });
+	expect_each_element_equals_scalar_operation(a - b, a, b, [](bfloat16_t x, bfloat16_t y) { return x - y; });
+	expect_each_element_equals_scalar_operation(a * b, a, b, [](bfloat16_t x, bfloat16_t y) { return x * y; });
+	expect_each_element_equals_scalar_operation(a / b, a, b, [](bfloat16_t x, bfloat16_t y) { return x / y; });
+	expect_each_element_equals_scalar_operation(-a, a, b, [](bfloat16_t x, bfloat16_t) { return -x; });
+	expect_each_element_equals_scalar_operation(a.abs(), a, b,
+		[](bfloat16_t x, bfloat16_t) { return biovault::abs(x); });
+	expect_each_element_equals_scalar_operation(a.min(b), a, b,
+		[](bfloat16_t x, bfloat16_t y) { return (y < x) ? y : x; });
+	expect_each_element_equals_scalar_operation(a.max(b), a, b,
+		[](bfloat16_t x, bfloat16_t y) { return (x < y) ? y : x; });
+}
+
+
+GTEST_TEST(bfloat16_eigen, Reductions)
+{
+	const bfloat16_matrix a = make_small_integers(array_size, 1, 3);
+	const bfloat16_matrix b = make_small_integers(array_size, 1, 4);
+
+	float expected_sum{};
+	float expected_dot{};
+	float expected_min{ std::numeric_limits<float>::infinity() };
+	float expected_max{ -std::numeric_limits<float>::infinity() };
+
+	for (Eigen::Index i{}; i < a.size(); ++i)
+	{
+		expected_sum += a(i);
+		expected_dot += a(i) * b(i);
+		expected_min = std::min(expected_min, static_cast<float>(a(i)));
+		expected_max = std::max(expected_max, static_cast<float>(a(i)));
+	}
+
+	EXPECT_EQ(a.sum(), expected_sum);
+	EXPECT_EQ(a.col(0).dot(b.col(0)), expected_dot);
+	EXPECT_EQ(a.minCoeff(), expected_min);
+	EXPECT_EQ(a.maxCoeff(), expected_max);
+
+	// The product of 24 elements, which are either -1, 1 or 2.
+	const bfloat16_matrix factors = make_small_integers(24, 1, 5).unaryExpr([](const bfloat16_t x)
+		{
+			return (x < bfloat16_t(1)) ? bfloat16_t(x < bfloat16_t(0) ? -1 : 1) : x;
+		});
+	float expected_product{ 1 };
+
+	for (Eigen::Index i{}; i < factors.size(); ++i)
+	{
+		expected_product *= factors(i);
+	}
+	EXPECT_EQ(factors.prod(), expected_product);
+}
+
+
+GTEST_TEST(bfloat16_eigen, MatrixProduct)
+{
+	// Sizes that are not multiples of the packet size. With at most 40 terms of at
+	// most 4 in absolute value, each partial sum is an integer that is exactly
+	// representable by bfloat16.
+	const bfloat16_matrix a = make_small_integers(37, 40, 6);
+	const bfloat16_matrix b = make_small_integers(40, 19, 7);
+	const bfloat16_matrix product = a * b;
+	const Eigen::MatrixXf expected = a.cast<float>() * b.cast<float>();
+
+	ASSERT_EQ(product.rows(), expected.rows());
+	ASSERT_EQ(product.cols(), expected.cols());
+
+	for (Eigen::Index j{}; j < product.cols(); ++j)
+	{
+		for (Eigen::Index i{}; i < product.rows(); ++i)
+		{
+			EXPECT_EQ(product(i, j), expected(i, j));
+		}
+	}
+
+	// A matrix-vector product.
+	const bfloat16_matrix column_product = a * b.col(0);
+
+	for (Eigen::Index i{}; i < column_product.rows(); ++i)
+	{
+		EXPECT_EQ(column_product(i), expected(i, 0));
+	}
+}
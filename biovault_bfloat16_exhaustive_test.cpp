@@ -0,0 +1,290 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Exhaustive verification of the bulk conversion kernels: each SIMD kernel that is
+// supported by the CPU is cross-checked bit by bit against the scalar reference, for
+// all 2^32 inputs of 32-bit types. Built as a separate executable, as it is meant to
+// be run separately from the other tests (for example, when adding a kernel). The work
+// is spread across all threads of the default thread pool of biovault_bfloat16_parallel.h.
+
+// The files to be tested.
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_parallel.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <algorithm> // For min.
+#include <atomic>
+#include <cstddef>   // For size_t.
+#include <cstdint>
+#include <cstring>   // For memcmp and memcpy.
+#include <mutex>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::simd_kernel;
+
+
+namespace
+{
+	// The number of inputs that a thread verifies at once. Small enough for the
+	// buffers of a chunk to stay in the L2 cache.
+	constexpr std::size_t chunk_size{ std::size_t{ 1 } << 16 };
+	constexpr std::size_t number_of_chunks{ (std::uint64_t{ 1 } << 32) / chunk_size };
+
+
+	// The mismatches of a kernel: their number, and the first one (with the lowest input bits).
+	struct mismatch_report
+	{
+		std::uint64_t number_of_mismatches;
+		std::uint32_t first_input_bits;
+		std::uint16_t first_expected_bits;
+		std::uint16_t first_actual_bits;
+	};
+
+
+	void add_mismatch(mismatch_report& report, const std::uint32_t input_bits, const std::uint16_t expected_bits,
+		const std::uint16_t actual_bits)
+	{
+		if ((report.number_of_mismatches == 0) || (input_bits < report.first_input_bits))
+		{
+			report.first_input_bits = input_bits;
+			report.first_expected_bits = expected_bits;
+			report.first_actual_bits = actual_bits;
+		}
+		++report.number_of_mismatches;
+	}
+
+
+	void merge_report(mismatch_report& report, const mismatch_report& other)
+	{
+		if (other.number_of_mismatches > 0)
+		{
+			add_mismatch(report, other.first_input_bits, other.first_expected_bits, other.first_actual_bits);
+			report.number_of_mismatches += other.number_of_mismatches - 1;
+		}
+	}
+
+
+	std::vector<simd_kernel> get_supported_simd_kernels()
+	{
+		std::vector<simd_kernel> result;
+
+		for (const auto kernel : biovault::test::all_simd_kernels)
+		{
+			if (biovault::is_supported(kernel))
+			{
+				result.push_back(kernel);
+			}
+		}
+		return result;
+	}
+
+
+	// For all 2^32 input bit patterns, checks that each supported kernel yields the
+	// same raw bits as the reference. The input of type T is produced by
+	// get_input(bits). The reference is called as reference(src, dst, n, first_bits),
+	// and the kernels as convert(kernel_table, src, dst, n, first_bits), where
+	// first_bits are the bits of src[0]. The chunks are distributed dynamically over
+	// the threads, each of which gathers its own mismatch reports, which are merged
+	// at the end.
+	template <typename T, typename GetInput, typename Reference, typename Convert>
+	void expect_each_supported_kernel_equals_reference_for_all_inputs(
+		const GetInput& get_input, const Reference& reference, const Convert& convert)
+	{
+		const auto kernels = get_supported_simd_kernels();
+		std::vector<mismatch_report> reports(kernels.size());
+		std::mutex reports_mutex;
+		std::atomic<std::size_t> next_chunk{ 0 };
+
+		auto& pool = biovault::get_default_thread_pool();
+
+		pool.run(pool.get_number_of_threads(), [&](unsigned)
+			{
+				std::vector<T> src(chunk_size);
+				std::vector<bfloat16_t> expected(chunk_size);
+				std::vector<bfloat16_t> actual(chunk_size);
+				std::vector<mismatch_report> thread_reports(kernels.size());
+
+				for (auto chunk = next_chunk++; chunk < number_of_chunks; chunk = next_chunk++)
+				{
+					const auto first_bits = static_cast<std::uint32_t>(chunk * chunk_size);
+
+					for (std::size_t i{}; i < chunk_size; ++i)
+					{
+						src[i] = get_input(static_cast<std::uint32_t>(first_bits + i));
+					}
+					reference(src.data(), expected.data(), chunk_size, first_bits);
+
+					for (std::size_t kernel_index{}; kernel_index < kernels.size(); ++kernel_index)
+					{
+						convert(biovault::detail::get_kernel_table(kernels[kernel_index]),
+							src.data(), actual.data(), chunk_size, first_bits);
+
+						if (std::memcmp(actual.data(), expected.data(), chunk_size * sizeof(bfloat16_t)) == 0)
+						{
+							continue;
+						}
+						for (std::size_t i{}; i < chunk_size; ++i)
+						{
+							const auto expected_bits = get_raw_bits(expected[i]);
+							const auto actual_bits = get_raw_bits(actual[i]);
+
+							if (expected_bits != actual_bits)
+							{
+								add_mismatch(thread_reports[kernel_index], static_cast<std::uint32_t>(first_bits + i),
+									expected_bits, actual_bits);
+							}
+						}
+					}
+				}
+
+				const std::lock_guard<std::mutex> lock{ reports_mutex };
+
+				for (std::size_t kernel_index{}; kernel_index < kernels.size(); ++kernel_index)
+				{
+					merge_report(reports[kernel_index], thread_reports[kernel_index]);
+				}
+			});
+
+		for (std::size_t kernel_index{}; kernel_index < kernels.size(); ++kernel_index)
+		{
+			const auto& report = reports[kernel_index];
+
+			EXPECT_EQ(report.number_of_mismatches, 0U) << biovault::get_name(kernels[kernel_index])
+				<< std::hex << ": first mismatch at input bits 0x" << report.first_input_bits
+				<< ", expected bits 0x" << report.first_expected_bits
+				<< ", actual bits 0x" << report.first_actual_bits;
+		}
+	}
+
+
+	float get_float_from_bits(const std::uint32_t bits)
+	{
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+}
+
+
+GTEST_TEST(bfloat16_exhaustive, EachKernelConvertsEachFloatLikeConstruction)
+{
+	expect_each_supported_kernel_equals_reference_for_all_inputs<float>(get_float_from_bits,
+		[](const float* const src, bfloat16_t* const dst, const std::size_t n, std::uint32_t)
+		{
+			for (std::size_t i{}; i < n; ++i)
+			{
+				dst[i] = bfloat16_t(src[i]);
+			}
+		},
+		[](const biovault::detail::kernel_table& table, const float* const src, bfloat16_t* const dst,
+			const std::size_t n, std::uint32_t)
+		{
+			table.convert_from_float(src, dst, n);
+		});
+}
+
+
+GTEST_TEST(bfloat16_exhaustive, EachKernelConvertsEachFloatTowardZeroLikeConstruction)
+{
+	expect_each_supported_kernel_equals_reference_for_all_inputs<float>(get_float_from_bits,
+		[](const float* const src, bfloat16_t* const dst, const std::size_t n, std::uint32_t)
+		{
+			for (std::size_t i{}; i < n; ++i)
+			{
+				dst[i] = bfloat16_t(src[i], biovault::round_toward_zero);
+			}
+		},
+		[](const biovault::detail::kernel_table& table, const float* const src, bfloat16_t* const dst,
+			const std::size_t n, std::uint32_t)
+		{
+			table.convert_from_float_toward_zero(src, dst, n);
+		});
+}
+
+
+GTEST_TEST(bfloat16_exhaustive, EachKernelConvertsEachFloatStochasticallyLikeScalarKernel)
+{
+	// The counter of the random bits is the index of the element, which is equal to its bits.
+	constexpr std::uint32_t seed{ 42 };
+
+	const auto convert_stochastic = [seed](const biovault::detail::kernel_table& table, const float* const src,
+		bfloat16_t* const dst, const std::size_t n, const std::uint32_t first_bits)
+	{
+		biovault::stochastic_rounding rounding{ seed, first_bits };
+		table.convert_from_float_stochastic(src, dst, n, rounding);
+	};
+
+	expect_each_supported_kernel_equals_reference_for_all_inputs<float>(get_float_from_bits,
+		[convert_stochastic](const float* const src, bfloat16_t* const dst, const std::size_t n,
+			const std::uint32_t first_bits)
+		{
+			convert_stochastic(biovault::detail::get_kernel_table(simd_kernel::scalar), src, dst, n, first_bits);
+		},
+		convert_stochastic);
+}
+
+
+GTEST_TEST(bfloat16_exhaustive, EachKernelConvertsEachFloatAsDoubleLikeConstruction)
+{
+	expect_each_supported_kernel_equals_reference_for_all_inputs<double>(
+		[](const std::uint32_t bits)
+		{
+			return static_cast<double>(get_float_from_bits(bits));
+		},
+		[](const double* const src, bfloat16_t* const dst, const std::size_t n, std::uint32_t)
+		{
+			for (std::size_t i{}; i < n; ++i)
+			{
+				dst[i] = bfloat16_t(static_cast<float>(src[i]));
+			}
+		},
+		[](const biovault::detail::kernel_table& table, const double* const src, bfloat16_t* const dst,
+			const std::size_t n, std::uint32_t)
+		{
+			table.convert_from_double(src, dst, n);
+		});
+}
+
+
+GTEST_TEST(bfloat16_exhaustive, EachKernelConvertsEachInt32LikeConstruction)
+{
+	expect_each_supported_kernel_equals_reference_for_all_inputs<std::int32_t>(
+		[](const std::uint32_t bits)
+		{
+			std::int32_t result;
+			std::memcpy(&result, &bits, sizeof(result));
+			return result;
+		},
+		[](const std::int32_t* const src, bfloat16_t* const dst, const std::size_t n, std::uint32_t)
+		{
+			for (std::size_t i{}; i < n; ++i)
+			{
+				dst[i] = bfloat16_t(src[i]);
+			}
+		},
+		[](const biovault::detail::kernel_table& table, const std::int32_t* const src, bfloat16_t* const dst,
+			const std::size_t n, std::uint32_t)
+		{
+			table.convert_from_int32(src, dst, n);
+		});
+}
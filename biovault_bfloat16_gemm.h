@@ -0,0 +1,571 @@
+#ifndef BIOVAULT_BFLOAT16_GEMM_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_GEMM_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For min.
+#include <array>
+#include <cmath>     // For fpclassify.
+#include <cstddef>   // For size_t.
+#include <cstring>
+#include <vector>
+
+// Asks the compiler to fully unroll the loops over the rows of a register tile, so
+// that the tile is kept in registers, also when loop unrolling is not enabled for
+// the entire project.
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 8))
+#define BIOVAULT_BFLOAT16_UNROLL _Pragma("GCC unroll 8")
+#else
+#define BIOVAULT_BFLOAT16_UNROLL
+#endif
+
+namespace biovault {
+
+	namespace detail {
+
+		// General matrix multiplication is blocked as follows, for row-major matrices:
+		// B is processed in blocks of gemm_block_depth rows by gemm_block_width columns,
+		// which are packed into panels of nr columns, laid out for the micro-kernel. The
+		// corresponding mr rows of A are packed as well. Each micro-kernel call then
+		// multiplies the packed rows of A by one packed panel, keeping the mr x nr tile
+		// of C in registers, accumulating in float.
+		constexpr std::size_t gemm_block_depth{ 256 };
+		constexpr std::size_t gemm_block_width{ 256 };
+
+		// The maximum tile size of any micro-kernel.
+		constexpr std::size_t gemm_max_mr{ 6 };
+		constexpr std::size_t gemm_max_nr{ 32 };
+
+		struct gemm_kernel
+		{
+			std::size_t mr;
+			std::size_t nr;
+
+			// Packs kc columns of at most mr rows of A, padded with zero rows. Occupies at
+			// most kc * mr floats.
+			void (*pack_a)(std::size_t kc, std::size_t rows, const bfloat16_t* a, std::size_t lda, float* packed_a);
+
+			// Packs kc rows of at most nr columns of B into a panel, padded with zero
+			// columns. Occupies at most kc * nr floats.
+			void (*pack_b)(std::size_t kc, std::size_t columns, const bfloat16_t* b, std::size_t ldb, float* panel);
+
+			// Adds alpha times the product of the packed rows of A and a packed panel of B
+			// to the mr x nr tile of C.
+			void (*multiply)(std::size_t kc, float alpha, const float* packed_a, const float* panel,
+				float* c, std::size_t ldc);
+		};
+
+		namespace scalar {
+
+			// Packs A as floats, element [r][p] at p * MR + r.
+			template <std::size_t MR>
+			void pack_a_as_float(const std::size_t kc, const std::size_t rows,
+				const bfloat16_t* const a, const std::size_t lda, float* const packed_a)
+			{
+				std::fill_n(packed_a, kc * MR, 0.0f);
+
+				for (std::size_t r{}; r < rows; ++r)
+				{
+					for (std::size_t p{}; p < kc; ++p)
+					{
+						packed_a[p * MR + r] = a[r * lda + p];
+					}
+				}
+			}
+
+			// Packs B as floats, element [p][j] at p * NR + j.
+			template <std::size_t NR>
+			void pack_b_as_float(const std::size_t kc, const std::size_t columns,
+				const bfloat16_t* const b, const std::size_t ldb, float* const panel)
+			{
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					::biovault::convert(b + p * ldb, panel + p * NR, columns);
+					std::fill(panel + p * NR + columns, panel + (p + 1) * NR, 0.0f);
+				}
+			}
+
+			template <std::size_t MR, std::size_t NR>
+			void multiply(const std::size_t kc, const float alpha, const float* const packed_a,
+				const float* const panel, float* const c, const std::size_t ldc)
+			{
+				float tile[MR][NR]{};
+
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					for (std::size_t r{}; r < MR; ++r)
+					{
+						for (std::size_t j{}; j < NR; ++j)
+						{
+							tile[r][j] += packed_a[p * MR + r] * panel[p * NR + j];
+						}
+					}
+				}
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					for (std::size_t j{}; j < NR; ++j)
+					{
+						c[r * ldc + j] += alpha * tile[r][j];
+					}
+				}
+			}
+		}
+
+#ifdef BIOVAULT_BFLOAT16_SSE2
+		namespace sse2 {
+
+			template <std::size_t MR>
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void multiply(const std::size_t kc, const float alpha,
+				const float* const packed_a, const float* const panel, float* const c, const std::size_t ldc)
+			{
+				__m128 tile[MR][2];
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					tile[r][0] = _mm_setzero_ps();
+					tile[r][1] = _mm_setzero_ps();
+				}
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					const __m128 b0 = _mm_loadu_ps(panel + p * 8);
+					const __m128 b1 = _mm_loadu_ps(panel + p * 8 + 4);
+
+					BIOVAULT_BFLOAT16_UNROLL
+					for (std::size_t r{}; r < MR; ++r)
+					{
+						const __m128 a_element = _mm_set1_ps(packed_a[p * MR + r]);
+						tile[r][0] = _mm_add_ps(tile[r][0], _mm_mul_ps(a_element, b0));
+						tile[r][1] = _mm_add_ps(tile[r][1], _mm_mul_ps(a_element, b1));
+					}
+				}
+				const __m128 alpha_vector = _mm_set1_ps(alpha);
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					float* const c_row{ c + r * ldc };
+					_mm_storeu_ps(c_row, _mm_add_ps(_mm_loadu_ps(c_row), _mm_mul_ps(alpha_vector, tile[r][0])));
+					_mm_storeu_ps(c_row + 4, _mm_add_ps(_mm_loadu_ps(c_row + 4), _mm_mul_ps(alpha_vector, tile[r][1])));
+				}
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			template <std::size_t MR>
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void multiply(const std::size_t kc, const float alpha,
+				const float* const packed_a, const float* const panel, float* const c, const std::size_t ldc)
+			{
+				__m256 tile[MR][2];
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					tile[r][0] = _mm256_setzero_ps();
+					tile[r][1] = _mm256_setzero_ps();
+				}
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					const __m256 b0 = _mm256_loadu_ps(panel + p * 16);
+					const __m256 b1 = _mm256_loadu_ps(panel + p * 16 + 8);
+
+					BIOVAULT_BFLOAT16_UNROLL
+					for (std::size_t r{}; r < MR; ++r)
+					{
+						const __m256 a_element = _mm256_broadcast_ss(packed_a + p * MR + r);
+						tile[r][0] = _mm256_fmadd_ps(a_element, b0, tile[r][0]);
+						tile[r][1] = _mm256_fmadd_ps(a_element, b1, tile[r][1]);
+					}
+				}
+				const __m256 alpha_vector = _mm256_set1_ps(alpha);
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					float* const c_row{ c + r * ldc };
+					_mm256_storeu_ps(c_row, _mm256_fmadd_ps(alpha_vector, tile[r][0], _mm256_loadu_ps(c_row)));
+					_mm256_storeu_ps(c_row + 8, _mm256_fmadd_ps(alpha_vector, tile[r][1], _mm256_loadu_ps(c_row + 8)));
+				}
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			template <std::size_t MR>
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void multiply(const std::size_t kc, const float alpha,
+				const float* const packed_a, const float* const panel, float* const c, const std::size_t ldc)
+			{
+				__m512 tile[MR][2];
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					tile[r][0] = _mm512_setzero_ps();
+					tile[r][1] = _mm512_setzero_ps();
+				}
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					const __m512 b0 = _mm512_loadu_ps(panel + p * 32);
+					const __m512 b1 = _mm512_loadu_ps(panel + p * 32 + 16);
+
+					BIOVAULT_BFLOAT16_UNROLL
+					for (std::size_t r{}; r < MR; ++r)
+					{
+						const __m512 a_element = _mm512_set1_ps(packed_a[p * MR + r]);
+						tile[r][0] = _mm512_fmadd_ps(a_element, b0, tile[r][0]);
+						tile[r][1] = _mm512_fmadd_ps(a_element, b1, tile[r][1]);
+					}
+				}
+				const __m512 alpha_vector = _mm512_set1_ps(alpha);
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					float* const c_row{ c + r * ldc };
+					_mm512_storeu_ps(c_row, _mm512_fmadd_ps(alpha_vector, tile[r][0], _mm512_loadu_ps(c_row)));
+					_mm512_storeu_ps(c_row + 16, _mm512_fmadd_ps(alpha_vector, tile[r][1], _mm512_loadu_ps(c_row + 16)));
+				}
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512_BF16
+		namespace avx512_bf16 {
+
+			// Packs A as pairs of bfloat16 values of consecutive columns, element [r][p] at
+			// (p / 2) * 2 * MR + 2 * r + (p % 2). An odd number of columns is padded with zero.
+			template <std::size_t MR>
+			void pack_a(const std::size_t kc, const std::size_t rows,
+				const bfloat16_t* const a, const std::size_t lda, float* const packed_a)
+			{
+				bfloat16_t* const pairs{ reinterpret_cast<bfloat16_t*>(packed_a) };
+				std::fill_n(pairs, (kc + 1) / 2 * 2 * MR, bfloat16_t{});
+
+				for (std::size_t r{}; r < rows; ++r)
+				{
+					for (std::size_t p{}; p < kc; ++p)
+					{
+						pairs[(p / 2) * 2 * MR + 2 * r + (p % 2)] = a[r * lda + p];
+					}
+				}
+			}
+
+			// Packs B as pairs of bfloat16 values of consecutive rows, element [p][j] at
+			// (p / 2) * 2 * NR + 2 * j + (p % 2), as expected by VDPBF16PS. An odd number
+			// of rows is padded with a zero row.
+			template <std::size_t NR>
+			void pack_b(const std::size_t kc, const std::size_t columns,
+				const bfloat16_t* const b, const std::size_t ldb, float* const panel)
+			{
+				bfloat16_t* const pairs{ reinterpret_cast<bfloat16_t*>(panel) };
+				std::fill_n(pairs, (kc + 1) / 2 * 2 * NR, bfloat16_t{});
+
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					for (std::size_t j{}; j < columns; ++j)
+					{
+						pairs[(p / 2) * 2 * NR + 2 * j + (p % 2)] = b[p * ldb + j];
+					}
+				}
+			}
+
+			// Uses VDPBF16PS, multiplying two columns of A by two rows of B at once. Note
+			// that VDPBF16PS treats denormal inputs as zero.
+			template <std::size_t MR>
+			BIOVAULT_BFLOAT16_TARGET_AVX512_BF16 inline void multiply(const std::size_t kc, const float alpha,
+				const float* const packed_a, const float* const panel, float* const c, const std::size_t ldc)
+			{
+				constexpr std::size_t nr{ 32 };
+				const bfloat16_t* const a_pairs{ reinterpret_cast<const bfloat16_t*>(packed_a) };
+				const bfloat16_t* const b_pairs{ reinterpret_cast<const bfloat16_t*>(panel) };
+				__m512 tile[MR][2];
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					tile[r][0] = _mm512_setzero_ps();
+					tile[r][1] = _mm512_setzero_ps();
+				}
+				for (std::size_t p{}; p < kc; p += 2)
+				{
+					__m512bh b0, b1;
+					std::memcpy(&b0, b_pairs + p * nr, sizeof(b0));
+					std::memcpy(&b1, b_pairs + p * nr + nr, sizeof(b1));
+
+					BIOVAULT_BFLOAT16_UNROLL
+					for (std::size_t r{}; r < MR; ++r)
+					{
+						std::int32_t a_pair_bits;
+						std::memcpy(&a_pair_bits, a_pairs + p * MR + 2 * r, sizeof(a_pair_bits));
+						const __m512i a_pair_vector = _mm512_set1_epi32(a_pair_bits);
+						__m512bh a_pair;
+						std::memcpy(&a_pair, &a_pair_vector, sizeof(a_pair));
+						tile[r][0] = _mm512_dpbf16_ps(tile[r][0], a_pair, b0);
+						tile[r][1] = _mm512_dpbf16_ps(tile[r][1], a_pair, b1);
+					}
+				}
+				const __m512 alpha_vector = _mm512_set1_ps(alpha);
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					float* const c_row{ c + r * ldc };
+					_mm512_storeu_ps(c_row, _mm512_fmadd_ps(alpha_vector, tile[r][0], _mm512_loadu_ps(c_row)));
+					_mm512_storeu_ps(c_row + 16, _mm512_fmadd_ps(alpha_vector, tile[r][1], _mm512_loadu_ps(c_row + 16)));
+				}
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON
+		namespace neon {
+
+			template <std::size_t MR>
+			inline void multiply(const std::size_t kc, const float alpha,
+				const float* const packed_a, const float* const panel, float* const c, const std::size_t ldc)
+			{
+				float32x4_t tile[MR][2];
+
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					tile[r][0] = vdupq_n_f32(0.0f);
+					tile[r][1] = vdupq_n_f32(0.0f);
+				}
+				for (std::size_t p{}; p < kc; ++p)
+				{
+					const float32x4_t b0 = vld1q_f32(panel + p * 8);
+					const float32x4_t b1 = vld1q_f32(panel + p * 8 + 4);
+
+					BIOVAULT_BFLOAT16_UNROLL
+					for (std::size_t r{}; r < MR; ++r)
+					{
+						const float a_element{ packed_a[p * MR + r] };
+						tile[r][0] = vfmaq_n_f32(tile[r][0], b0, a_element);
+						tile[r][1] = vfmaq_n_f32(tile[r][1], b1, a_element);
+					}
+				}
+				BIOVAULT_BFLOAT16_UNROLL
+				for (std::size_t r{}; r < MR; ++r)
+				{
+					float* const c_row{ c + r * ldc };
+					vst1q_f32(c_row, vfmaq_n_f32(vld1q_f32(c_row), tile[r][0], alpha));
+					vst1q_f32(c_row + 4, vfmaq_n_f32(vld1q_f32(c_row + 4), tile[r][1], alpha));
+				}
+			}
+		}
+#endif
+
+		// Returns the micro-kernel that corresponds to the active SIMD kernel.
+		inline const gemm_kernel& get_gemm_kernel()
+		{
+			switch (get_simd_kernel())
+			{
+#ifdef BIOVAULT_BFLOAT16_SSE2
+			case simd_kernel::sse2:
+			{
+				static const gemm_kernel kernel{ 4, 8, scalar::pack_a_as_float<4>, scalar::pack_b_as_float<8>, sse2::multiply<4> };
+				return kernel;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+			{
+				static const gemm_kernel kernel{ 6, 16, scalar::pack_a_as_float<6>, scalar::pack_b_as_float<16>, avx2::multiply<6> };
+				return kernel;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			{
+				static const gemm_kernel kernel{ 6, 32, scalar::pack_a_as_float<6>, scalar::pack_b_as_float<32>, avx512::multiply<6> };
+				return kernel;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512_BF16
+			case simd_kernel::avx512_bf16:
+			{
+				static const gemm_kernel kernel{ 6, 32, avx512_bf16::pack_a<6>, avx512_bf16::pack_b<32>, avx512_bf16::multiply<6> };
+				return kernel;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON
+			case simd_kernel::neon:
+			case simd_kernel::neon_bf16:
+			{
+				static const gemm_kernel kernel{ 4, 8, scalar::pack_a_as_float<4>, scalar::pack_b_as_float<8>, neon::multiply<4> };
+				return kernel;
+			}
+#endif
+			default:
+			{
+				static const gemm_kernel kernel{ 4, 8, scalar::pack_a_as_float<4>, scalar::pack_b_as_float<8>, scalar::multiply<4, 8> };
+				return kernel;
+			}
+			}
+		}
+
+		// Adds alpha * A * B to C, where A is m x k, B is k x n, and C is m x n. The
+		// packed_b workspace is resized as needed.
+		inline void gemm_accumulate(const std::size_t m, const std::size_t n, const std::size_t k, const float alpha,
+			const bfloat16_t* const a, const std::size_t lda, const bfloat16_t* const b, const std::size_t ldb,
+			float* const c, const std::size_t ldc, std::vector<float>& packed_b)
+		{
+			const auto& kernel = get_gemm_kernel();
+			const auto mr = kernel.mr;
+			const auto nr = kernel.nr;
+			const std::size_t panels_per_block{ (gemm_block_width + nr - 1) / nr };
+
+			packed_b.resize(panels_per_block * gemm_block_depth * nr);
+			std::array<float, gemm_max_mr * gemm_block_depth> packed_a;
+
+			// Zero-padded tile of C, at the bottom and right edges.
+			std::array<float, gemm_max_mr * gemm_max_nr> c_edge;
+
+			for (std::size_t jc{}; jc < n; jc += gemm_block_width)
+			{
+				const auto block_width = std::min(gemm_block_width, n - jc);
+
+				for (std::size_t pc{}; pc < k; pc += gemm_block_depth)
+				{
+					const auto kc = std::min(gemm_block_depth, k - pc);
+
+					for (std::size_t jr{}; jr < block_width; jr += nr)
+					{
+						kernel.pack_b(kc, std::min(nr, block_width - jr), b + pc * ldb + jc + jr, ldb,
+							packed_b.data() + (jr / nr) * kc * nr);
+					}
+					for (std::size_t i{}; i < m; i += mr)
+					{
+						const auto rows = std::min(mr, m - i);
+						kernel.pack_a(kc, rows, a + i * lda + pc, lda, packed_a.data());
+
+						for (std::size_t jr{}; jr < block_width; jr += nr)
+						{
+							const auto columns = std::min(nr, block_width - jr);
+							const float* const panel{ packed_b.data() + (jr / nr) * kc * nr };
+							float* const c_tile{ c + i * ldc + jc + jr };
+
+							if ((rows == mr) && (columns == nr))
+							{
+								kernel.multiply(kc, alpha, packed_a.data(), panel, c_tile, ldc);
+							}
+							else
+							{
+								c_edge.fill(0.0f);
+								kernel.multiply(kc, alpha, packed_a.data(), panel, c_edge.data(), nr);
+
+								for (std::size_t r{}; r < rows; ++r)
+								{
+									for (std::size_t j{}; j < columns; ++j)
+									{
+										c_tile[r * ldc + j] += c_edge[r * nr + j];
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// Multiplies the m x n matrix C by beta. When beta is zero, C is set to zero,
+		// even when it contains NaN or infinity (as specified by BLAS).
+		inline void gemm_scale(const std::size_t m, const std::size_t n, const float beta, float* const c, const std::size_t ldc)
+		{
+			for (std::size_t i{}; i < m; ++i)
+			{
+				float* const c_row{ c + i * ldc };
+
+				if (std::fpclassify(beta) == FP_ZERO)
+				{
+					std::fill_n(c_row, n, 0.0f);
+				}
+				else
+				{
+					for (std::size_t j{}; j < n; ++j)
+					{
+						c_row[j] *= beta;
+					}
+				}
+			}
+		}
+	}
+
+
+	// General matrix multiplication, computing C = alpha * A * B + beta * C, for
+	// row-major matrices, with A being m x k, B being k x n, and C being m x n. The
+	// leading dimensions lda, ldb and ldc specify the distance between the rows of
+	// each matrix, in elements. Accumulates in float, by a cache-blocked and
+	// register-tiled micro-kernel, which uses VDPBF16PS when the AVX512_BF16 kernel
+	// is active (typically slightly less accurate than a float FMA per element).
+	inline void gemm(const std::size_t m, const std::size_t n, const std::size_t k, const float alpha,
+		const bfloat16_t* const a, const std::size_t lda, const bfloat16_t* const b, const std::size_t ldb,
+		const float beta, float* const c, const std::size_t ldc)
+	{
+		detail::gemm_scale(m, n, beta, c, ldc);
+		std::vector<float> packed_b;
+		detail::gemm_accumulate(m, n, k, alpha, a, lda, b, ldb, c, ldc, packed_b);
+	}
+
+
+	// General matrix multiplication with a bfloat16 result. Accumulates in float, and
+	// rounds each element of C only once, at the end.
+	inline void gemm(const std::size_t m, const std::size_t n, const std::size_t k, const float alpha,
+		const bfloat16_t* const a, const std::size_t lda, const bfloat16_t* const b, const std::size_t ldb,
+		const float beta, bfloat16_t* const c, const std::size_t ldc)
+	{
+		// Process C by blocks, using a float copy of each block as accumulator.
+		constexpr std::size_t block_height{ 64 };
+		constexpr std::size_t block_width{ detail::gemm_block_width };
+		std::vector<float> c_block(block_height * block_width);
+		std::vector<float> packed_b;
+
+		for (std::size_t ic{}; ic < m; ic += block_height)
+		{
+			const auto rows = std::min(block_height, m - ic);
+
+			for (std::size_t jc{}; jc < n; jc += block_width)
+			{
+				const auto columns = std::min(block_width, n - jc);
+
+				for (std::size_t r{}; r < rows; ++r)
+				{
+					convert(c + (ic + r) * ldc + jc, c_block.data() + r * block_width, columns);
+				}
+				detail::gemm_scale(rows, columns, beta, c_block.data(), block_width);
+				detail::gemm_accumulate(rows, columns, k, alpha, a + ic * lda, lda, b + jc, ldb,
+					c_block.data(), block_width, packed_b);
+
+				for (std::size_t r{}; r < rows; ++r)
+				{
+					convert(c_block.data() + r * block_width, c + (ic + r) * ldc + jc, columns);
+				}
+			}
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_gemm.h"
+#include "biovault_bfloat16_gemm.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <algorithm> // For fill_n.
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::test::for_each_supported_simd_kernel;
+
+
+namespace
+{
+	// Row-major matrix of small whole numbers, which have exact products and sums.
+	struct matrix
+	{
+		matrix(const std::size_t rows, const std::size_t columns, const std::size_t stride, const int seed)
+			: rows{ rows }, columns{ columns }, stride{ stride }, elements(rows * stride)
+		{
+			for (std::size_t i{}; i < elements.size(); ++i)
+			{
+				elements[i] = bfloat16_t{ static_cast<int>((i * 7 + static_cast<std::size_t>(seed)) % 9) - 4 };
+			}
+		}
+
+		float operator()(const std::size_t i, const std::size_t j) const
+		{
+			return elements[i * stride + j];
+		}
+
+		std::size_t rows;
+		std::size_t columns;
+		std::size_t stride;
+		std::vector<bfloat16_t> elements;
+	};
+
+
+	// Checks C = alpha * A * B + beta * C, for small whole numbers, which should be exact.
+	void expect_exact_gemm(const std::size_t m, const std::size_t n, const std::size_t k)
+	{
+		const matrix a{ m, k, k + 3, 1 };
+		const matrix b{ k, n, n + 5, 2 };
+		const std::size_t ldc{ n + 1 };
+		std::vector<float> c(m * ldc);
+
+		for (std::size_t i{}; i < c.size(); ++i)
+		{
+			c[i] = static_cast<float>(i % 5);
+		}
+		const auto initial_c = c;
+		biovault::gemm(m, n, k, 2.0f, a.elements.data(), a.stride, b.elements.data(), b.stride, -1.0f, c.data(), ldc);
+
+		for (std::size_t i{}; i < m; ++i)
+		{
+			for (std::size_t j{}; j < n; ++j)
+			{
+				double expected{ -initial_c[i * ldc + j] };
+
+				for (std::size_t p{}; p < k; ++p)
+				{
+					expected += 2.0 * a(i, p) * b(p, j);
+				}
+				ASSERT_EQ(c[i * ldc + j], expected) << "m = " << m << ", n = " << n << ", k = " << k << ", i = " << i << ", j = " << j;
+			}
+			// The padding between the rows of C must be left untouched.
+			ASSERT_EQ(c[i * ldc + n], initial_c[i * ldc + n]);
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_gemm, EachKernelIsExactForSmallWholeNumbers)
+{
+	for_each_supported_simd_kernel([]
+		{
+			for (const std::size_t m : { 1, 3, 4, 5, 17, 70 })
+			{
+				for (const std::size_t n : { 1, 7, 8, 16, 33, 65, 300 })
+				{
+					for (const std::size_t k : { 0, 1, 2, 3, 31, 257, 600 })
+					{
+						expect_exact_gemm(m, n, k);
+					}
+				}
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_gemm, ZeroBetaIgnoresNaNInOutput)
+{
+	const std::vector<bfloat16_t> a(4, bfloat16_t{ 1.0f });
+	const std::vector<bfloat16_t> b(4, bfloat16_t{ 2.0f });
+	std::vector<float> c(4, std::numeric_limits<float>::quiet_NaN());
+
+	biovault::gemm(2, 2, 2, 1.0f, a.data(), 2, b.data(), 2, 0.0f, c.data(), 2);
+
+	for (const float element : c)
+	{
+		EXPECT_EQ(element, 4.0f);
+	}
+}
+
+
+GTEST_TEST(bfloat16_gemm, BFloat16OutputRoundsAccumulatedFloatOnce)
+{
+	for_each_supported_simd_kernel([]
+		{
+			// 1 + 3 * 2^-9 rounds to 1 + 2^-7. Rounding after each addition would yield 1
+			// instead.
+			constexpr std::size_t m{ 100 };
+			constexpr std::size_t k{ 4 };
+			constexpr std::size_t n{ 300 };
+			const std::vector<bfloat16_t> a(m * k, bfloat16_t{ 1.0f });
+			std::vector<bfloat16_t> b(k * n, bfloat16_t{ 0.001953125f });
+			std::fill_n(b.begin(), n, bfloat16_t{ 1.0f });
+			std::vector<bfloat16_t> c(m * n, bfloat16_t{ 5.0f });
+
+			biovault::gemm(m, n, k, 1.0f, a.data(), k, b.data(), n, 0.0f, c.data(), n);
+
+			for (const auto element : c)
+			{
+				ASSERT_EQ(get_raw_bits(element), get_raw_bits(bfloat16_t{ 1.0078125f }));
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_gemm, EachKernelApproximatesDoublePrecisionProduct)
+{
+	constexpr std::size_t m{ 37 };
+	constexpr std::size_t n{ 71 };
+	constexpr std::size_t k{ 300 };
+	std::vector<bfloat16_t> a(m * k);
+	std::vector<bfloat16_t> b(k * n);
+	std::uint32_t state{ 1 };
+
+	for (auto* matrix : { &a, &b })
+	{
+		for (auto& element : *matrix)
+		{
+			state = biovault::stochastic_rounding::hash(state);
+			element = bfloat16_t{ static_cast<float>(state) / 4294967296.0f - 0.5f };
+		}
+	}
+
+	for_each_supported_simd_kernel([&a, &b]
+		{
+			std::vector<float> c(m * n);
+			biovault::gemm(m, n, k, 1.0f, a.data(), k, b.data(), n, 0.0f, c.data(), n);
+
+			for (std::size_t i{}; i < m; ++i)
+			{
+				for (std::size_t j{}; j < n; ++j)
+				{
+					double expected{};
+					double magnitude{};
+
+					for (std::size_t p{}; p < k; ++p)
+					{
+						const double product{ double{ float{ a[i * k + p] } } * float{ b[p * n + j] } };
+						expected += product;
+						magnitude += std::abs(product);
+					}
+					ASSERT_NEAR(c[i * n + j], expected, magnitude * 1e-6);
+				}
+			}
+		});
+}
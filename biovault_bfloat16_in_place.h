@@ -0,0 +1,158 @@
+#ifndef BIOVAULT_BFLOAT16_IN_PLACE_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_IN_PLACE_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// In-place conversion of a float buffer to bfloat16 (compaction into its front half),
+// and back (expansion). Avoids holding both the floats and their bfloat16 results in
+// memory at the same time. The conversions use the bulk kernels of
+// biovault_bfloat16.h, on blocks whose source and destination do not overlap: the
+// compaction moves forward, with growing blocks, and the expansion moves backward,
+// with shrinking blocks.
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For min.
+#include <cstddef>   // For size_t.
+#include <cstdint>   // For uintptr_t.
+
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#	define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <sys/mman.h> // For madvise.
+#	include <unistd.h>   // For sysconf.
+#endif
+
+namespace biovault {
+
+	// Tag type, to let compact_in_place release the memory pages of the unused tail
+	// of the buffer.
+	struct release_tail_t {};
+
+	const release_tail_t release_tail{};
+
+
+	namespace detail {
+
+		// The maximum number of elements per block of an in-place conversion: small
+		// enough for both the source and the destination of a block to fit in the L2 cache.
+		constexpr std::size_t in_place_block_size{ std::size_t{ 1 } << 14 };
+
+		inline std::size_t get_page_size()
+		{
+#ifdef _WIN32
+			SYSTEM_INFO system_info;
+			::GetSystemInfo(&system_info);
+			return system_info.dwPageSize;
+#else
+			return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+		}
+
+		// Tells the operating system that the whole pages within [begin, end) are no
+		// longer needed, so that their physical memory may be reclaimed. The pages stay
+		// mapped, but their contents become unspecified (on Linux, zero, for anonymous
+		// memory). Best effort: failures are ignored.
+		inline void release_whole_pages(void* const begin, void* const end)
+		{
+			const auto page_size = get_page_size();
+			const auto first_page = (reinterpret_cast<std::uintptr_t>(begin) + page_size - 1) / page_size * page_size;
+			const auto end_page = reinterpret_cast<std::uintptr_t>(end) / page_size * page_size;
+
+			if (first_page < end_page)
+			{
+#ifdef _WIN32
+				static_cast<void>(::VirtualAlloc(reinterpret_cast<void*>(first_page), end_page - first_page, MEM_RESET, PAGE_READWRITE));
+#else
+				static_cast<void>(::madvise(reinterpret_cast<void*>(first_page), end_page - first_page, MADV_DONTNEED));
+#endif
+			}
+		}
+	}
+
+
+	// Converts the n floats of buffer to bfloat16, storing the results in the first
+	// half of the buffer (its first n * sizeof(bfloat16_t) bytes), and returns a
+	// pointer to them. Yields the same raw bits as convert(const float*, bfloat16_t*, n).
+	// The contents of the second half of the buffer become unspecified.
+	inline bfloat16_t* compact_in_place(float* const buffer, const std::size_t n)
+	{
+		const auto dst = reinterpret_cast<bfloat16_t*>(buffer);
+
+		if (n > 0)
+		{
+			// The destination of the first element overlaps its source, so it is converted
+			// from a copy. (Converting it directly would let the instrumentation, if enabled,
+			// read the source after it is overwritten.) The floats of a block of k elements
+			// starting at element i are beyond its bfloat16 results, as long as k <= i.
+			const float first{ buffer[0] };
+			convert(&first, dst, 1);
+
+			for (std::size_t i{ 1 }; i < n;)
+			{
+				const auto k = std::min({ i, detail::in_place_block_size, n - i });
+				convert(buffer + i, dst + i, k);
+				i += k;
+			}
+		}
+		return dst;
+	}
+
+
+	// Like compact_in_place(buffer, n), and additionally releases the whole memory
+	// pages of the second half of the buffer (by madvise(MADV_DONTNEED) on POSIX, and
+	// VirtualAlloc(MEM_RESET) on Windows), to reduce the resident memory. The pages
+	// remain accessible, so that the buffer may still be expanded in place, later.
+	inline bfloat16_t* compact_in_place(float* const buffer, const std::size_t n, release_tail_t)
+	{
+		const auto result = compact_in_place(buffer, n);
+		detail::release_whole_pages(result + n, buffer + n);
+		return result;
+	}
+
+
+	// The reverse of compact_in_place: converts the n bfloat16 values at the front of
+	// buffer to float, storing the results in the entire buffer, and returns a pointer
+	// to them. The buffer must be suitably aligned for float, and have room for n
+	// floats. Lossless, just like convert(const bfloat16_t*, float*, n).
+	inline float* expand_in_place(bfloat16_t* const buffer, const std::size_t n)
+	{
+		const auto dst = reinterpret_cast<float*>(buffer);
+
+		// Walks backward. The float results of a block of k elements ending at element
+		// i are beyond its bfloat16 values, as long as k <= i / 2.
+		auto i = n;
+
+		while (i > 1)
+		{
+			const auto k = std::min(i / 2, detail::in_place_block_size);
+			i -= k;
+			convert(buffer + i, dst + i, k);
+		}
+		if (i == 1)
+		{
+			convert(buffer, dst, 1);
+		}
+		return dst;
+	}
+
+}
+
+#endif
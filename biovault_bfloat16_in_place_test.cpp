@@ -0,0 +1,121 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_in_place.h"
+#include "biovault_bfloat16_in_place.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstddef> // For size_t.
+#include <cstring> // For memcpy.
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::test::make_floats;
+
+
+namespace
+{
+	// Sizes around the block boundaries of the in-place conversions, which are at the
+	// powers of two (while the blocks grow) and the multiples of the maximum block size.
+	const std::size_t sizes[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000,
+		(std::size_t{ 1 } << 14) + 1, 3 * (std::size_t{ 1 } << 14) - 1, 100000 };
+}
+
+
+GTEST_TEST(bfloat16_in_place, EachKernelCompactsLikeBulkConversion)
+{
+	biovault::test::for_each_supported_simd_kernel([&]
+		{
+			for (const auto n : sizes)
+			{
+				const auto floats = make_floats(n);
+				std::vector<bfloat16_t> expected(n);
+				biovault::convert(floats.data(), expected.data(), n);
+
+				auto buffer = floats;
+				const bfloat16_t* const result = biovault::compact_in_place(buffer.data(), n);
+
+				ASSERT_EQ(static_cast<const void*>(result), static_cast<const void*>(buffer.data()));
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					ASSERT_EQ(get_raw_bits(result[i]), get_raw_bits(expected[i])) << "n = " << n << ", i = " << i;
+				}
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_in_place, EachKernelExpandsLikeBulkConversion)
+{
+	biovault::test::for_each_supported_simd_kernel([&]
+		{
+			for (const auto n : sizes)
+			{
+				const auto floats = make_floats(n);
+				std::vector<bfloat16_t> bfloats(n);
+				biovault::convert(floats.data(), bfloats.data(), n);
+
+				std::vector<float> buffer(n);
+
+				if (n > 0)
+				{
+					std::memcpy(buffer.data(), bfloats.data(), n * sizeof(bfloat16_t));
+				}
+				const float* const result = biovault::expand_in_place(reinterpret_cast<bfloat16_t*>(buffer.data()), n);
+
+				ASSERT_EQ(result, buffer.data());
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					ASSERT_EQ(get_raw_bits(bfloat16_t(result[i])), get_raw_bits(bfloats[i]))
+						<< "n = " << n << ", i = " << i;
+				}
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_in_place, CompactsWithReleaseOfTailAndExpandsAgain)
+{
+	constexpr std::size_t n{ std::size_t{ 1 } << 20 };
+	const auto floats = make_floats(n);
+	std::vector<bfloat16_t> expected(n);
+	biovault::convert(floats.data(), expected.data(), n);
+
+	auto buffer = floats;
+	const auto compacted = biovault::compact_in_place(buffer.data(), n, biovault::release_tail);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		ASSERT_EQ(get_raw_bits(compacted[i]), get_raw_bits(expected[i])) << "i = " << i;
+	}
+
+	// The released pages must still be usable.
+	const auto expanded = biovault::expand_in_place(compacted, n);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		ASSERT_EQ(get_raw_bits(bfloat16_t(expanded[i])), get_raw_bits(expected[i])) << "i = " << i;
+	}
+}
@@ -0,0 +1,229 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Built as a separate executable, because all translation units of a program must
+// agree on whether the instrumentation is enabled.
+#define BIOVAULT_BFLOAT16_INSTRUMENTATION
+
+// The file to be tested, and the headers whose conversions are counted as well.
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_in_place.h"
+#include "biovault_bfloat16_parallel.h"
+#include "biovault_bfloat16_quantize.h"
+#include "biovault_bfloat16_strided.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <algorithm> // For copy and rotate.
+#include <cstddef>   // For ptrdiff_t and size_t.
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+using biovault::bfloat16_t;
+
+
+namespace
+{
+	using float_limits = std::numeric_limits<float>;
+
+	// One float of each classification, and FLT_MAX, which rounds to infinity.
+	const std::vector<float> floats_of_each_classification{
+		0.0f, -0.0f, float_limits::denorm_min(), 1.0f, float_limits::max(),
+		float_limits::infinity(), float_limits::quiet_NaN() };
+
+
+	// Constructed before the first use of the instrumentation, so destructed after
+	// the end of main, while its worker threads still have counters registered.
+	biovault::thread_pool static_thread_pool{ 4 };
+
+
+	void expect_counts_of_each_classification(const biovault::conversion_counters& counters, const std::uint64_t n)
+	{
+		EXPECT_EQ(counters.zero, 2 * n);
+		EXPECT_EQ(counters.subnormal, n);
+		EXPECT_EQ(counters.normal, 2 * n);
+		EXPECT_EQ(counters.infinite, n);
+		EXPECT_EQ(counters.nan, n);
+		EXPECT_EQ(counters.overflow_to_infinity, n);
+	}
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, CountsScalarConversionsPerClassification)
+{
+	biovault::reset_conversion_counters();
+
+	for (const float f : floats_of_each_classification)
+	{
+		(void)bfloat16_t{ f };
+		(void)bfloat16_t(f, biovault::round_to_nearest_even);
+	}
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), 2);
+
+	biovault::reset_conversion_counters();
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), 0);
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, CountsEachElementOfBulkConversionOnce)
+{
+	constexpr std::uint64_t number_of_repetitions{ 100 };
+	std::vector<float> src;
+
+	for (std::uint64_t i{}; i < number_of_repetitions; ++i)
+	{
+		src.insert(src.end(), floats_of_each_classification.cbegin(), floats_of_each_classification.cend());
+	}
+	std::vector<bfloat16_t> dst(src.size());
+
+	biovault::reset_conversion_counters();
+	biovault::convert(src.data(), dst.data(), src.size());
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), number_of_repetitions);
+
+	biovault::reset_conversion_counters();
+	biovault::stochastic_rounding rounding;
+	biovault::convert(src.data(), dst.data(), src.size(), rounding);
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), number_of_repetitions);
+
+	// Truncation never rounds a finite float to infinity.
+	biovault::reset_conversion_counters();
+	biovault::convert(src.data(), dst.data(), src.size(), biovault::round_toward_zero);
+	EXPECT_EQ(biovault::get_conversion_counters().normal, 2 * number_of_repetitions);
+	EXPECT_EQ(biovault::get_conversion_counters().overflow_to_infinity, 0U);
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, CountsInPlaceCompactionLikeBulkConversion)
+{
+	// Each classification as the first element, which overlaps its own destination.
+	auto floats = floats_of_each_classification;
+
+	for (std::size_t i{}; i < floats.size(); ++i)
+	{
+		std::vector<float> buffer(floats);
+
+		biovault::reset_conversion_counters();
+		biovault::compact_in_place(buffer.data(), buffer.size());
+		expect_counts_of_each_classification(biovault::get_conversion_counters(), 1);
+
+		std::rotate(floats.begin(), floats.begin() + 1, floats.end());
+	}
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, CountsEachElementOfStridedConversionOnce)
+{
+	const auto n = floats_of_each_classification.size();
+	const std::ptrdiff_t max_stride{ 5 };
+	std::vector<float> src(n * max_stride);
+	std::vector<bfloat16_t> dst(n * max_stride);
+
+	// The dedicated kernels (strides 2, 3 and 4), and the generic loop (stride 5).
+	for (std::ptrdiff_t src_stride{ 1 }; src_stride <= max_stride; ++src_stride)
+	{
+		for (std::size_t i{}; i < n; ++i)
+		{
+			src[i * static_cast<std::size_t>(src_stride)] = floats_of_each_classification[i];
+		}
+		biovault::reset_conversion_counters();
+		biovault::convert(src.data(), src_stride, dst.data(), 1, n);
+		expect_counts_of_each_classification(biovault::get_conversion_counters(), 1);
+
+		biovault::reset_conversion_counters();
+		biovault::convert(src.data(), src_stride, dst.data(), 2, n);
+		expect_counts_of_each_classification(biovault::get_conversion_counters(), 1);
+	}
+
+	// Negative strides, iterating both arrays backward.
+	std::copy(floats_of_each_classification.cbegin(), floats_of_each_classification.cend(), src.begin());
+	biovault::reset_conversion_counters();
+	biovault::convert(src.data() + n - 1, -1, dst.data() + n - 1, -1, n);
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), 1);
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, CountsScaledFloatsOfQuantization)
+{
+	// The first block (having FLT_MAX) is not scaled, while the second block, a
+	// single denormal, is scaled up to a normal float.
+	auto src = floats_of_each_classification;
+	const auto block_size = src.size();
+	src.push_back(float_limits::denorm_min());
+
+	const auto number_of_blocks = biovault::get_number_of_blocks(src.size(), block_size);
+	std::vector<bfloat16_t> dst(src.size());
+	std::vector<float> scales(number_of_blocks);
+	std::vector<biovault::quantization_error> errors(number_of_blocks);
+
+	biovault::reset_conversion_counters();
+	biovault::convert_scaled(src.data(), dst.data(), scales.data(), src.size(), block_size, errors.data());
+
+	const auto counters = biovault::get_conversion_counters();
+	EXPECT_EQ(counters.zero, 2U);
+	EXPECT_EQ(counters.subnormal, 1U);
+	EXPECT_EQ(counters.normal, 3U);
+	EXPECT_EQ(counters.infinite, 1U);
+	EXPECT_EQ(counters.nan, 1U);
+	EXPECT_EQ(counters.overflow_to_infinity, 1U);
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, MergesCountersOfOtherThreads)
+{
+	biovault::reset_conversion_counters();
+	{
+		std::vector<std::thread> threads;
+
+		for (int i{}; i < 4; ++i)
+		{
+			threads.emplace_back([]
+				{
+					for (const float f : floats_of_each_classification)
+					{
+						(void)bfloat16_t{ f };
+					}
+				});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+	// The counts of the threads are kept, after those threads have exited.
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), 4);
+}
+
+
+GTEST_TEST(bfloat16_instrumentation, CountsParallelConversionOnPool)
+{
+	// Large enough to be spread over all four threads of the pool.
+	const std::uint64_t number_of_repetitions{ (std::uint64_t{ 4 } << 20) / floats_of_each_classification.size() + 1 };
+	std::vector<float> src;
+
+	for (std::uint64_t i{}; i < number_of_repetitions; ++i)
+	{
+		src.insert(src.end(), floats_of_each_classification.cbegin(), floats_of_each_classification.cend());
+	}
+	std::vector<bfloat16_t> dst(src.size());
+
+	biovault::reset_conversion_counters();
+	biovault::parallel_convert(src.data(), dst.data(), src.size(), static_thread_pool);
+	expect_counts_of_each_classification(biovault::get_conversion_counters(), number_of_repetitions);
+}
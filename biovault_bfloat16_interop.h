@@ -0,0 +1,499 @@
+#ifndef BIOVAULT_BFLOAT16_INTEROP_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_INTEROP_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Conversions between bfloat16 and other small floating point formats: IEEE 754
+// binary16 ("fp16", "half") and the 8-bit formats E4M3 and E5M2 ("fp8", as
+// specified by the Open Compute Project).
+//
+// Each conversion yields the same result as converting via float: to bfloat16 as
+// by bfloat16_t(float), which quiets NaNs, and to the smaller formats by rounding
+// to nearest even. As float represents each value of these formats exactly, there
+// is only a single rounding. Results that are too small for fp16 and fp8 become
+// denormals, or zero. Results that are too large become infinity, except for E4M3,
+// which has no infinity, so then they become NaN.
+//
+// The fp16 conversions use F16C (VCVTPH2PS/VCVTPS2PH) via the AVX2 kernel, AVX-512,
+// or the NEON conversion instructions, when available. The fp8 conversions use
+// tables, built on their first use, as these CPUs have no fp8 instructions.
+
+#include "biovault_bfloat16.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef> // For size_t.
+#include <cstdint>
+#include <cstring> // For memcpy.
+#include <limits>
+
+// The NEON conversions between float and fp16 are always available on AArch64,
+// but optional on 32-bit ARM.
+#if defined(BIOVAULT_BFLOAT16_NEON) && \
+	(defined(__aarch64__) || defined(_M_ARM64) || (defined(__ARM_FP) && ((__ARM_FP & 2) != 0)))
+#define BIOVAULT_BFLOAT16_NEON_FP16
+#endif
+
+namespace biovault {
+
+	// An IEEE 754 binary16 value, represented by its raw bits.
+	struct fp16_t
+	{
+		std::uint16_t bits;
+	};
+
+	// An 8-bit floating point value, represented by its raw bits, having 4 exponent
+	// bits and 3 mantissa bits. Its largest finite value is 448.
+	struct fp8_e4m3_t
+	{
+		std::uint8_t bits;
+	};
+
+	// An 8-bit floating point value, represented by its raw bits, having 5 exponent
+	// bits and 2 mantissa bits. Its largest finite value is 57344.
+	struct fp8_e5m2_t
+	{
+		std::uint8_t bits;
+	};
+
+
+	namespace detail {
+
+		inline float get_float_from_bits(const std::uint32_t bits)
+		{
+			float result;
+			std::memcpy(&result, &bits, sizeof(result));
+			return result;
+		}
+
+		inline std::uint32_t get_bits_of_float(const float f)
+		{
+			std::uint32_t result;
+			std::memcpy(&result, &f, sizeof(result));
+			return result;
+		}
+
+		inline float get_float_from_fp16_bits(const std::uint16_t bits)
+		{
+			const std::uint32_t sign{ std::uint32_t{ bits & 0x8000U } << 16 };
+			const std::uint32_t exponent{ (bits >> 10) & 0x1FU };
+			const std::uint32_t mantissa{ bits & 0x3FFU };
+
+			if (exponent == 0x1F)
+			{
+				return get_float_from_bits(sign | 0x7F800000U | (mantissa << 13));
+			}
+			if (exponent == 0)
+			{
+				// Zero or denormal, 2^-24 times the mantissa.
+				const float magnitude{ static_cast<float>(mantissa) * (1.0f / 16777216.0f) };
+				return get_float_from_bits(sign | get_bits_of_float(magnitude));
+			}
+			return get_float_from_bits(sign | ((exponent + 112) << 23) | (mantissa << 13));
+		}
+
+		// Rounds to nearest even, just like VCVTPS2PH with rounding control 0. NaNs keep
+		// their sign and the upper bits of their payload, and are quieted.
+		inline std::uint16_t get_fp16_bits_from_float(const float f)
+		{
+			const std::uint32_t bits{ get_bits_of_float(f) };
+			const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000U);
+			const std::uint32_t magnitude{ bits & 0x7FFFFFFFU };
+
+			if (magnitude > 0x7F800000U)
+			{
+				return static_cast<std::uint16_t>(sign | 0x7E00U | ((magnitude & 0x7FFFFFU) >> 13));
+			}
+			if (magnitude >= 0x477FF000U)
+			{
+				// Infinity, or at least 65520, the midpoint between the largest finite fp16
+				// (65504) and the next power of two.
+				return static_cast<std::uint16_t>(sign | 0x7C00U);
+			}
+			if (magnitude < 0x38800000U)
+			{
+				// Less than 2^-14: a denormal or zero. Adding 0.5 shifts the mantissa to the
+				// lower bits of the sum, rounded to nearest even by the floating point addition.
+				const std::uint32_t sum{ get_bits_of_float(get_float_from_bits(magnitude) + 0.5f) };
+				return static_cast<std::uint16_t>(sign | (sum - 0x3F000000U));
+			}
+			const std::uint32_t lsb{ (magnitude >> 13) & 1U };
+			const std::uint32_t rebiased{ magnitude - (std::uint32_t{ 127 - 15 } << 23) };
+			return static_cast<std::uint16_t>(sign | ((rebiased + 0xFFFU + lsb) >> 13));
+		}
+
+
+		// The parameters of the 8-bit floating point formats. Besides the number of
+		// mantissa bits and the exponent bias, the bits of the magnitude (the lower seven
+		// bits) of the largest finite value, of the result of an overflow (infinity, or
+		// NaN when there is no infinity), and of NaN.
+		struct e4m3_format
+		{
+			static constexpr unsigned mantissa_bits{ 3 };
+			static constexpr int bias{ 7 };
+			static constexpr std::uint32_t max_finite_bits{ 0x7E };
+			static constexpr std::uint32_t overflow_bits{ 0x7F };
+			static constexpr std::uint32_t nan_bits{ 0x7F };
+		};
+
+		struct e5m2_format
+		{
+			static constexpr unsigned mantissa_bits{ 2 };
+			static constexpr int bias{ 15 };
+			static constexpr std::uint32_t max_finite_bits{ 0x7B };
+			static constexpr std::uint32_t overflow_bits{ 0x7C };
+			static constexpr std::uint32_t nan_bits{ 0x7E };
+		};
+
+		template <typename Format>
+		float get_float_from_fp8_bits(const std::uint8_t bits)
+		{
+			const std::uint32_t magnitude{ bits & 0x7FU };
+			float result;
+
+			if (magnitude > Format::max_finite_bits)
+			{
+				result = ((magnitude == Format::overflow_bits) && (Format::overflow_bits != Format::nan_bits)) ?
+					std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+			}
+			else
+			{
+				const std::uint32_t exponent{ magnitude >> Format::mantissa_bits };
+				const std::uint32_t mantissa{ magnitude & ((1U << Format::mantissa_bits) - 1) };
+				const int mantissa_bits{ static_cast<int>(Format::mantissa_bits) };
+
+				result = (exponent == 0) ?
+					std::ldexp(static_cast<float>(mantissa), 1 - Format::bias - mantissa_bits) :
+					std::ldexp(static_cast<float>(mantissa | (1U << Format::mantissa_bits)),
+						static_cast<int>(exponent) - Format::bias - mantissa_bits);
+			}
+			return ((bits & 0x80U) == 0) ? result : -result;
+		}
+
+		template <typename Format>
+		std::uint8_t get_fp8_bits_from_float(const float f)
+		{
+			const std::uint32_t bits{ get_bits_of_float(f) };
+			const std::uint32_t sign{ (bits >> 24) & 0x80U };
+			const std::uint32_t magnitude{ bits & 0x7FFFFFFFU };
+			const int mantissa_bits{ static_cast<int>(Format::mantissa_bits) };
+			std::uint32_t result;
+
+			if (magnitude > 0x7F800000U)
+			{
+				result = Format::nan_bits;
+			}
+			else if (magnitude < (static_cast<std::uint32_t>(128 - Format::bias) << 23))
+			{
+				// Less than the smallest normal value of the format: a denormal or zero.
+				// Exact scaling by a power of two, followed by rounding to nearest even.
+				result = static_cast<std::uint32_t>(
+					std::nearbyint(std::ldexp(get_float_from_bits(magnitude), Format::bias - 1 + mantissa_bits)));
+			}
+			else
+			{
+				const unsigned shift{ 23 - Format::mantissa_bits };
+				const std::uint32_t lsb{ (magnitude >> shift) & 1U };
+				const std::uint32_t rounded{ (magnitude + (1U << (shift - 1)) - 1 + lsb) >> shift };
+				result = rounded - (static_cast<std::uint32_t>(127 - Format::bias) << Format::mantissa_bits);
+
+				if (result > Format::max_finite_bits)
+				{
+					result = Format::overflow_bits;
+				}
+			}
+			return static_cast<std::uint8_t>(sign | result);
+		}
+
+
+		// Returns the table of the 256 bfloat16 values of an fp8 Format::
+		template <typename Format>
+		const std::array<bfloat16_t, 256>& get_bfloat16_table_of_fp8()
+		{
+			static const auto table = []
+			{
+				std::array<bfloat16_t, 256> result{};
+
+				for (unsigned bits{}; bits < result.size(); ++bits)
+				{
+					result[bits] = bfloat16_t(get_float_from_fp8_bits<Format>(static_cast<std::uint8_t>(bits)));
+				}
+				return result;
+			}();
+			return table;
+		}
+
+		// Returns the table of fp8 values of all bfloat16 values, indexed by their raw bits.
+		template <typename Format>
+		const std::array<std::uint8_t, 65536>& get_fp8_table_of_bfloat16()
+		{
+			static const auto table = []
+			{
+				std::array<std::uint8_t, 65536> result{};
+
+				for (std::uint32_t bits{}; bits < result.size(); ++bits)
+				{
+					result[bits] = get_fp8_bits_from_float<Format>(
+						static_cast<float>(bfloat16_t(static_cast<std::uint16_t>(bits), true)));
+				}
+				return result;
+			}();
+			return table;
+		}
+
+
+		namespace scalar {
+
+			inline void convert(const fp16_t* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = bfloat16_t::from_float_branchless(get_float_from_fp16_bits(src[i].bits));
+				}
+			}
+
+			inline void convert(const bfloat16_t* const src, fp16_t* const dst, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i].bits = get_fp16_bits_from_float(static_cast<float>(src[i]));
+				}
+			}
+		}
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2_F16C inline void convert(const fp16_t* const src, bfloat16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256 low = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+					const __m256 high = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+						pack(convert_to_bits_of_bfloat16(low), convert_to_bits_of_bfloat16(high)));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2_F16C inline void convert(const bfloat16_t* const src, fp16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+						_mm256_cvtps_ph(load_as_float(src + i), _MM_FROUND_TO_NEAREST_INT));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert(const fp16_t* const src, bfloat16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m512 f = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+						_mm512_cvtepi32_epi16(convert_to_bits_of_bfloat16(f)));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert(const bfloat16_t* const src, fp16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+						_mm512_cvtps_ph(load_as_float(src + i), _MM_FROUND_TO_NEAREST_INT));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON_FP16
+		namespace neon {
+
+			inline void convert(const fp16_t* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const float16x4_t low = vreinterpret_f16_u16(vld1_u16(reinterpret_cast<const std::uint16_t*>(src + i)));
+					const float16x4_t high = vreinterpret_f16_u16(vld1_u16(reinterpret_cast<const std::uint16_t*>(src + i + 4)));
+					const uint32x4_t low_bits = convert_to_bits_of_bfloat16(vcvt_f32_f16(low));
+					const uint32x4_t high_bits = convert_to_bits_of_bfloat16(vcvt_f32_f16(high));
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i), vcombine_u16(vmovn_u32(low_bits), vmovn_u32(high_bits)));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+
+			inline void convert(const bfloat16_t* const src, fp16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 4 <= n; i += 4)
+				{
+					const uint16x4_t bits = vld1_u16(reinterpret_cast<const std::uint16_t*>(src + i));
+					const float32x4_t f = vreinterpretq_f32_u32(vshll_n_u16(bits, 16));
+					vst1_u16(reinterpret_cast<std::uint16_t*>(dst + i), vreinterpret_u16_f16(vcvt_f16_f32(f)));
+				}
+				scalar::convert(src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+		struct fp16_kernels
+		{
+			void (*convert_from_fp16)(const fp16_t*, bfloat16_t*, std::size_t);
+			void (*convert_to_fp16)(const bfloat16_t*, fp16_t*, std::size_t);
+		};
+
+		// F16C is not part of SSE2 (and in theory, not even of AVX2), so the SSE2 kernel,
+		// and the AVX2 kernel without F16C, use the scalar conversions.
+		inline fp16_kernels get_fp16_kernels()
+		{
+			switch (get_simd_kernel())
+			{
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+				if (get_cpu_features().f16c)
+				{
+					return { avx2::convert, avx2::convert };
+				}
+				break;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			case simd_kernel::avx512_bf16:
+				return { avx512::convert, avx512::convert };
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON_FP16
+			case simd_kernel::neon:
+			case simd_kernel::neon_bf16:
+				return { neon::convert, neon::convert };
+#endif
+			default:
+				break;
+			}
+			return { scalar::convert, scalar::convert };
+		}
+	}
+
+
+	inline bfloat16_t to_bfloat16(const fp16_t x)
+	{
+		return bfloat16_t(detail::get_float_from_fp16_bits(x.bits));
+	}
+
+	inline bfloat16_t to_bfloat16(const fp8_e4m3_t x)
+	{
+		return detail::get_bfloat16_table_of_fp8<detail::e4m3_format>()[x.bits];
+	}
+
+	inline bfloat16_t to_bfloat16(const fp8_e5m2_t x)
+	{
+		return detail::get_bfloat16_table_of_fp8<detail::e5m2_format>()[x.bits];
+	}
+
+	inline fp16_t to_fp16(const bfloat16_t x)
+	{
+		return { detail::get_fp16_bits_from_float(static_cast<float>(x)) };
+	}
+
+	inline fp8_e4m3_t to_fp8_e4m3(const bfloat16_t x)
+	{
+		return { detail::get_fp8_table_of_bfloat16<detail::e4m3_format>()[get_raw_bits(x)] };
+	}
+
+	inline fp8_e5m2_t to_fp8_e5m2(const bfloat16_t x)
+	{
+		return { detail::get_fp8_table_of_bfloat16<detail::e5m2_format>()[get_raw_bits(x)] };
+	}
+
+
+	// Converts n elements from src, storing the results in dst. Equivalent to calling
+	// to_bfloat16, to_fp16, to_fp8_e4m3, or to_fp8_e5m2 on each element.
+	inline void convert(const fp16_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		detail::get_fp16_kernels().convert_from_fp16(src, dst, n);
+	}
+
+	inline void convert(const bfloat16_t* const src, fp16_t* const dst, const std::size_t n)
+	{
+		detail::get_fp16_kernels().convert_to_fp16(src, dst, n);
+	}
+
+	inline void convert(const fp8_e4m3_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		const auto& table = detail::get_bfloat16_table_of_fp8<detail::e4m3_format>();
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			dst[i] = table[src[i].bits];
+		}
+	}
+
+	inline void convert(const fp8_e5m2_t* const src, bfloat16_t* const dst, const std::size_t n)
+	{
+		const auto& table = detail::get_bfloat16_table_of_fp8<detail::e5m2_format>();
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			dst[i] = table[src[i].bits];
+		}
+	}
+
+	inline void convert(const bfloat16_t* const src, fp8_e4m3_t* const dst, const std::size_t n)
+	{
+		const auto& table = detail::get_fp8_table_of_bfloat16<detail::e4m3_format>();
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			dst[i].bits = table[get_raw_bits(src[i])];
+		}
+	}
+
+	inline void convert(const bfloat16_t* const src, fp8_e5m2_t* const dst, const std::size_t n)
+	{
+		const auto& table = detail::get_fp8_table_of_bfloat16<detail::e5m2_format>();
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			dst[i].bits = table[get_raw_bits(src[i])];
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,273 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_interop.h"
+#include "biovault_bfloat16_interop.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::fp16_t;
+using biovault::fp8_e4m3_t;
+using biovault::fp8_e5m2_t;
+using biovault::test::for_each_supported_simd_kernel;
+
+
+namespace
+{
+	std::vector<bfloat16_t> make_all_bfloat16_values()
+	{
+		std::vector<bfloat16_t> result;
+
+		for (std::uint32_t bits{}; bits <= 0xFFFFU; ++bits)
+		{
+			result.push_back(bfloat16_t(static_cast<std::uint16_t>(bits), true));
+		}
+		return result;
+	}
+
+
+	// Computes the value of an IEEE-like floating point format (without NaN and
+	// infinity) straightforwardly, by its definition.
+	float compute_value(const std::uint32_t bits, const int exponent_bits, const int mantissa_bits)
+	{
+		const int bias{ (1 << (exponent_bits - 1)) - 1 };
+		const int exponent{ static_cast<int>((bits >> mantissa_bits) & ((1U << exponent_bits) - 1)) };
+		const int mantissa{ static_cast<int>(bits & ((1U << mantissa_bits) - 1)) };
+		const float magnitude{ (exponent == 0) ?
+			std::ldexp(static_cast<float>(mantissa), 1 - bias - mantissa_bits) :
+			std::ldexp(static_cast<float>(mantissa + (1 << mantissa_bits)), exponent - bias - mantissa_bits) };
+		return ((bits >> (exponent_bits + mantissa_bits)) == 0) ? magnitude : -magnitude;
+	}
+
+
+	// Returns the raw bits of the fp8 value nearest to x (ties to even), by trying
+	// all finite candidates, or the specified overflow bits when x is too large.
+	std::uint32_t get_nearest_fp8(const float x, const int exponent_bits, const std::uint32_t max_finite_bits,
+		const std::uint32_t overflow_bits)
+	{
+		const int mantissa_bits{ 7 - exponent_bits };
+		const float max_finite{ compute_value(max_finite_bits, exponent_bits, mantissa_bits) };
+		const float ulp{ max_finite - compute_value(max_finite_bits - 1, exponent_bits, mantissa_bits) };
+		const std::uint32_t sign{ std::signbit(x) ? 0x80U : 0U };
+
+		// A tie between the largest finite value and the next one only overflows when
+		// the largest finite value is odd (which it is not for E4M3, whose largest
+		// finite value has mantissa 110, as 111 is NaN).
+		const float threshold{ max_finite + ulp / 2 };
+
+		if (std::isgreater(std::fabs(x), threshold) ||
+			(!std::islessgreater(std::fabs(x), threshold) && ((max_finite_bits & 1U) != 0)))
+		{
+			return sign | overflow_bits;
+		}
+		std::uint32_t result{};
+		float minimum_distance{ std::numeric_limits<float>::infinity() };
+
+		for (std::uint32_t bits{}; bits <= max_finite_bits; ++bits)
+		{
+			const auto distance = std::fabs(std::fabs(x) - compute_value(bits, exponent_bits, mantissa_bits));
+
+			if (std::isless(distance, minimum_distance) ||
+				(!std::islessgreater(distance, minimum_distance) && ((bits & 1U) == 0)))
+			{
+				minimum_distance = distance;
+				result = bits;
+			}
+		}
+		return sign | result;
+	}
+}
+
+
+GTEST_TEST(bfloat16_interop, ConversionFromFp16)
+{
+	std::vector<fp16_t> src;
+
+	for (std::uint32_t bits{}; bits <= 0xFFFFU; ++bits)
+	{
+		src.push_back(fp16_t{ static_cast<std::uint16_t>(bits) });
+	}
+
+	for (const auto x : src)
+	{
+		const auto result = biovault::to_bfloat16(x);
+
+		if ((x.bits & 0x7C00U) == 0x7C00U)
+		{
+			// Infinity or NaN: the upper bits are retained (and NaN is quieted).
+			const std::uint16_t expected_bits(((x.bits & 0x8000U) | 0x7F80U | ((x.bits & 0x3FFU) >> 3) |
+				(((x.bits & 0x3FFU) != 0) ? 0x40U : 0U)));
+			EXPECT_EQ(get_raw_bits(result), expected_bits) << x.bits;
+		}
+		else
+		{
+			EXPECT_EQ(get_raw_bits(result), get_raw_bits(bfloat16_t(compute_value(x.bits, 5, 10)))) << x.bits;
+		}
+	}
+
+	for_each_supported_simd_kernel([&src]
+		{
+			std::vector<bfloat16_t> dst(src.size());
+			biovault::convert(src.data(), dst.data(), src.size());
+
+			for (std::size_t i{}; i < src.size(); ++i)
+			{
+				ASSERT_EQ(get_raw_bits(dst[i]), get_raw_bits(biovault::to_bfloat16(src[i])));
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_interop, ConversionToFp16)
+{
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ 1.0f }).bits, 0x3C00U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ -2.0f }).bits, 0xC000U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ 65280.0f }).bits, 0x7BF8U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ 65536.0f }).bits, 0x7C00U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ std::ldexp(1.0f, -24) }).bits, 0x0001U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ std::ldexp(1.0f, -25) }).bits, 0x0000U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ std::ldexp(3.0f, -25) }).bits, 0x0002U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ -std::ldexp(1.0f, -30) }).bits, 0x8000U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ std::numeric_limits<float>::infinity() }).bits, 0x7C00U);
+	EXPECT_EQ(biovault::to_fp16(bfloat16_t{ std::numeric_limits<float>::quiet_NaN() }).bits & 0x7E00U, 0x7E00U);
+
+	const auto src = make_all_bfloat16_values();
+
+	// Round trip: each fp16 value that is also a bfloat16 value remains the same.
+	for (const auto x : src)
+	{
+		const float f{ x };
+
+		if (!std::isnan(f))
+		{
+			const auto result = biovault::to_fp16(x);
+
+			if ((result.bits & 0x7C00U) == 0x7C00U)
+			{
+				EXPECT_GE(std::fabs(f), 65520.0f);
+			}
+			else if (!std::islessgreater(f, compute_value(result.bits, 5, 10)))
+			{
+				EXPECT_EQ(get_raw_bits(biovault::to_bfloat16(result)), get_raw_bits(x));
+			}
+			else if (std::isless(std::fabs(f), 65504.0f))
+			{
+				// Otherwise the result is one of the two nearest fp16 values.
+				const auto distance = std::fabs(f - compute_value(result.bits, 5, 10));
+				EXPECT_LE(distance, std::fabs(f - compute_value(result.bits + 1U, 5, 10))) << get_raw_bits(x);
+				EXPECT_LE(distance, std::fabs(f - compute_value(result.bits - 1U, 5, 10))) << get_raw_bits(x);
+			}
+		}
+	}
+
+	for_each_supported_simd_kernel([&src]
+		{
+			std::vector<fp16_t> dst(src.size());
+			biovault::convert(src.data(), dst.data(), src.size());
+
+			for (std::size_t i{}; i < src.size(); ++i)
+			{
+				ASSERT_EQ(dst[i].bits, biovault::to_fp16(src[i]).bits) << i;
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_interop, ConversionsOfFp8)
+{
+	EXPECT_EQ(float{ biovault::to_bfloat16(fp8_e4m3_t{ 0x7E }) }, 448.0f);
+	EXPECT_EQ(float{ biovault::to_bfloat16(fp8_e4m3_t{ 0x01 }) }, std::ldexp(1.0f, -9));
+	EXPECT_TRUE(std::isnan(float{ biovault::to_bfloat16(fp8_e4m3_t{ 0xFF }) }));
+	EXPECT_EQ(float{ biovault::to_bfloat16(fp8_e5m2_t{ 0x7B }) }, 57344.0f);
+	EXPECT_EQ(float{ biovault::to_bfloat16(fp8_e5m2_t{ 0xFC }) }, -std::numeric_limits<float>::infinity());
+	EXPECT_TRUE(std::isnan(float{ biovault::to_bfloat16(fp8_e5m2_t{ 0x7D }) }));
+
+	// E4M3 has no infinity, so overflow yields NaN. 464 is a tie, rounded to even: 448.
+	EXPECT_EQ(biovault::to_fp8_e4m3(bfloat16_t{ 464.0f }).bits, 0x7EU);
+	EXPECT_EQ(biovault::to_fp8_e4m3(bfloat16_t{ 468.0f }).bits, 0x7FU);
+	EXPECT_EQ(biovault::to_fp8_e4m3(bfloat16_t{ -std::numeric_limits<float>::infinity() }).bits, 0xFFU);
+	EXPECT_EQ(biovault::to_fp8_e5m2(bfloat16_t{ 61440.0f }).bits, 0x7CU);
+
+	const auto src = make_all_bfloat16_values();
+	std::vector<fp8_e4m3_t> e4m3(src.size());
+	std::vector<fp8_e5m2_t> e5m2(src.size());
+	biovault::convert(src.data(), e4m3.data(), src.size());
+	biovault::convert(src.data(), e5m2.data(), src.size());
+
+	for (std::size_t i{}; i < src.size(); ++i)
+	{
+		const float f{ src[i] };
+
+		if (std::isnan(f))
+		{
+			EXPECT_EQ(e4m3[i].bits & 0x7FU, 0x7FU);
+			EXPECT_EQ(e5m2[i].bits & 0x7FU, 0x7EU);
+		}
+		else
+		{
+			ASSERT_EQ(e4m3[i].bits, get_nearest_fp8(f, 4, 0x7E, 0x7F)) << i;
+			ASSERT_EQ(e5m2[i].bits, get_nearest_fp8(f, 5, 0x7B, 0x7C)) << i;
+		}
+	}
+
+	// Each fp8 value (other than NaN) remains the same, after a round trip via bfloat16.
+	std::vector<fp8_e4m3_t> all_e4m3;
+	std::vector<fp8_e5m2_t> all_e5m2;
+
+	for (unsigned bits{}; bits < 256U; ++bits)
+	{
+		all_e4m3.push_back(fp8_e4m3_t{ static_cast<std::uint8_t>(bits) });
+		all_e5m2.push_back(fp8_e5m2_t{ static_cast<std::uint8_t>(bits) });
+	}
+	std::vector<bfloat16_t> dst(256);
+
+	biovault::convert(all_e4m3.data(), dst.data(), 256);
+
+	for (unsigned bits{}; bits < 256U; ++bits)
+	{
+		if ((bits & 0x7FU) != 0x7FU)
+		{
+			EXPECT_EQ(float{ dst[bits] }, compute_value(bits, 4, 3));
+			EXPECT_EQ(biovault::to_fp8_e4m3(dst[bits]).bits, bits);
+		}
+	}
+
+	biovault::convert(all_e5m2.data(), dst.data(), 256);
+
+	for (unsigned bits{}; bits < 256U; ++bits)
+	{
+		if ((bits & 0x7FU) <= 0x7CU)
+		{
+			EXPECT_EQ(biovault::to_fp8_e5m2(dst[bits]).bits, bits);
+		}
+		if ((bits & 0x7FU) < 0x7CU)
+		{
+			EXPECT_EQ(float{ dst[bits] }, compute_value(bits, 5, 2));
+		}
+	}
+}
@@ -0,0 +1,625 @@
+#ifndef BIOVAULT_BFLOAT16_IO_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_IO_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Minimal file format for bfloat16 tensors, which can be memory-mapped and used
+// without any parsing or copying of the payload. A file consists of:
+// - a fixed-size header (tensor_file_header), specifying the shape and the strides
+//   of the tensor, the byte order, and the alignment of the payload;
+// - zero padding, up to the payload offset (a multiple of the alignment);
+// - the payload: the raw bits of the elements, in the byte order of the header.
+
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_buffer.h"
+
+#include <algorithm> // For copy_n, find and max.
+#include <cerrno>
+#include <cstddef>   // For size_t.
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#	define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>    // For open.
+#	include <sys/mman.h> // For mmap.
+#	include <sys/stat.h> // For fstat.
+#	include <unistd.h>   // For close.
+#endif
+
+namespace biovault {
+
+	constexpr std::size_t tensor_file_max_rank{ 8 };
+	constexpr std::uint64_t tensor_file_default_alignment{ 4096 };
+
+	// Thrown when a file is not a valid tensor file, or does not match the request.
+	class tensor_file_error : public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	// The header at the start of each tensor file. All its fields are stored in the
+	// byte order of the writer, which is recognizable by the byte order mark.
+	struct tensor_file_header
+	{
+		char magic[8];
+		std::uint32_t byte_order_mark;
+		std::uint32_t version;
+		std::uint32_t rank;
+		std::uint32_t reserved;
+		// The byte offset of the payload is a multiple of the alignment.
+		std::uint64_t alignment;
+		std::uint64_t payload_offset;
+		// The number of elements in the payload.
+		std::uint64_t payload_size;
+		std::uint64_t shape[tensor_file_max_rank];
+		// The distance between consecutive elements of each dimension, in elements.
+		std::uint64_t strides[tensor_file_max_rank];
+	};
+
+	static_assert(sizeof(tensor_file_header) == 176, "The header of a tensor file must be 176 bytes");
+
+
+	namespace detail {
+
+		constexpr char tensor_file_magic[8] = { 'B', 'V', 'B', 'F', '1', '6', 'T', 'F' };
+		constexpr std::uint32_t tensor_file_byte_order_mark{ 0x01020304U };
+		constexpr std::uint32_t tensor_file_version{ 1 };
+
+		// The number of elements that is written or read at once, as a std::streamsize
+		// might not hold the entire payload size.
+		constexpr std::uint64_t tensor_file_chunk_size{ std::uint64_t{ 1 } << 26 };
+
+		constexpr std::uint64_t uint64_max{ std::numeric_limits<std::uint64_t>::max() };
+
+		inline std::uint32_t swap_bytes(const std::uint32_t value)
+		{
+			return (value >> 24) | ((value >> 8) & 0xFF00U) | ((value << 8) & 0xFF0000U) | (value << 24);
+		}
+
+		inline std::uint64_t swap_bytes(const std::uint64_t value)
+		{
+			return (std::uint64_t{ swap_bytes(static_cast<std::uint32_t>(value)) } << 32) |
+				swap_bytes(static_cast<std::uint32_t>(value >> 32));
+		}
+
+		inline void swap_bytes(tensor_file_header& header)
+		{
+			header.byte_order_mark = swap_bytes(header.byte_order_mark);
+			header.version = swap_bytes(header.version);
+			header.rank = swap_bytes(header.rank);
+			header.reserved = swap_bytes(header.reserved);
+			header.alignment = swap_bytes(header.alignment);
+			header.payload_offset = swap_bytes(header.payload_offset);
+			header.payload_size = swap_bytes(header.payload_size);
+
+			for (std::size_t i{}; i < tensor_file_max_rank; ++i)
+			{
+				header.shape[i] = swap_bytes(header.shape[i]);
+				header.strides[i] = swap_bytes(header.strides[i]);
+			}
+		}
+
+		// Tells whether the specified alignment of the payload is supported: a power of
+		// two, and at least the alignment of bfloat16_t.
+		inline bool is_valid_tensor_file_alignment(const std::uint64_t alignment)
+		{
+			return (alignment >= alignof(bfloat16_t)) && ((alignment & (alignment - 1)) == 0);
+		}
+
+		// Tells whether any of the extents is zero. (Rather than whether their product
+		// is zero, which may wrap around to zero when the extents are large.)
+		inline bool has_zero_extent(const std::uint64_t* const shape, const std::size_t rank)
+		{
+			return std::find(shape, shape + rank, std::uint64_t{}) != (shape + rank);
+		}
+
+		// Checks the header, as read from a file of the specified size (in bytes).
+		// Returns true when its byte order is the native byte order of this platform;
+		// otherwise swaps the bytes of its fields, and returns false.
+		inline bool check_header(tensor_file_header& header, const std::uint64_t file_size)
+		{
+			if (std::memcmp(header.magic, tensor_file_magic, sizeof(tensor_file_magic)) != 0)
+			{
+				throw tensor_file_error{ "Not a bfloat16 tensor file" };
+			}
+			const bool is_native_byte_order{ header.byte_order_mark == tensor_file_byte_order_mark };
+
+			if (!is_native_byte_order)
+			{
+				swap_bytes(header);
+
+				if (header.byte_order_mark != tensor_file_byte_order_mark)
+				{
+					throw tensor_file_error{ "Invalid byte order mark in bfloat16 tensor file" };
+				}
+			}
+			if (header.version != tensor_file_version)
+			{
+				throw tensor_file_error{ "Unsupported version of bfloat16 tensor file: " + std::to_string(header.version) };
+			}
+			if ((header.rank > tensor_file_max_rank) || !is_valid_tensor_file_alignment(header.alignment) ||
+				(header.payload_offset < sizeof(header)) || (header.payload_offset % alignof(bfloat16_t) != 0) ||
+				(header.payload_offset % header.alignment != 0))
+			{
+				throw tensor_file_error{ "Invalid header of bfloat16 tensor file" };
+			}
+			if ((file_size < header.payload_offset) ||
+				(header.payload_size > (file_size - header.payload_offset) / sizeof(bfloat16_t)))
+			{
+				throw tensor_file_error{ "Truncated bfloat16 tensor file" };
+			}
+			if (!has_zero_extent(header.shape, header.rank))
+			{
+				// The element with the largest offset must be within the payload.
+				std::uint64_t last_offset{};
+
+				for (std::size_t i{}; i < header.rank; ++i)
+				{
+					const auto extent = header.shape[i] - 1;
+
+					if ((header.strides[i] > 0) && (extent > (header.payload_size - last_offset) / header.strides[i]))
+					{
+						throw tensor_file_error{ "Strides of bfloat16 tensor file exceed its payload" };
+					}
+					last_offset += extent * header.strides[i];
+				}
+				if (last_offset >= header.payload_size)
+				{
+					throw tensor_file_error{ "Strides of bfloat16 tensor file exceed its payload" };
+				}
+			}
+			return is_native_byte_order;
+		}
+	}
+
+
+	// The shape and strides of a tensor, in elements, and the alignment of its payload
+	// in a file.
+	struct tensor_layout
+	{
+		std::vector<std::uint64_t> shape;
+		// Empty strides mean: row-major (C order), without gaps.
+		std::vector<std::uint64_t> strides;
+		std::uint64_t alignment{ tensor_file_default_alignment };
+	};
+
+
+	// Returns the strides of a row-major tensor of the specified shape. Throws
+	// tensor_file_error when a stride does not fit in 64 bits.
+	inline std::vector<std::uint64_t> get_row_major_strides(const std::vector<std::uint64_t>& shape)
+	{
+		std::vector<std::uint64_t> strides(shape.size());
+		std::uint64_t stride{ 1 };
+
+		for (auto i = shape.size(); i > 0; --i)
+		{
+			strides[i - 1] = stride;
+
+			if (i > 1)
+			{
+				if ((shape[i - 1] > 0) && (stride > detail::uint64_max / shape[i - 1]))
+				{
+					throw tensor_file_error{ "The strides of a bfloat16 tensor must fit in 64 bits" };
+				}
+				stride *= shape[i - 1];
+			}
+		}
+		return strides;
+	}
+
+
+	// Returns the number of elements of a tensor of the specified shape. Throws
+	// tensor_file_error when the number does not fit in 64 bits.
+	inline std::uint64_t get_number_of_elements(const std::vector<std::uint64_t>& shape)
+	{
+		if (detail::has_zero_extent(shape.data(), shape.size()))
+		{
+			return 0;
+		}
+		std::uint64_t result{ 1 };
+
+		for (const auto extent : shape)
+		{
+			if (result > detail::uint64_max / extent)
+			{
+				throw tensor_file_error{ "The number of elements of a bfloat16 tensor must fit in 64 bits" };
+			}
+			result *= extent;
+		}
+		return result;
+	}
+
+
+	// Returns the header of a tensor file, for the specified layout. Throws
+	// tensor_file_error when the layout is not supported, including when the size of
+	// its payload (in bytes) does not fit in 64 bits.
+	inline tensor_file_header make_tensor_file_header(const tensor_layout& layout)
+	{
+		if (layout.shape.size() > tensor_file_max_rank)
+		{
+			throw tensor_file_error{ "The rank of a bfloat16 tensor file must not exceed " + std::to_string(tensor_file_max_rank) };
+		}
+		if (!layout.strides.empty() && (layout.strides.size() != layout.shape.size()))
+		{
+			throw tensor_file_error{ "The strides must match the shape of a bfloat16 tensor" };
+		}
+		if (!detail::is_valid_tensor_file_alignment(layout.alignment))
+		{
+			throw tensor_file_error{ "The alignment of a bfloat16 tensor file must be a power of two, of at least " +
+				std::to_string(alignof(bfloat16_t)) };
+		}
+		const auto strides = layout.strides.empty() ? get_row_major_strides(layout.shape) : layout.strides;
+
+		tensor_file_header header{};
+		std::memcpy(header.magic, detail::tensor_file_magic, sizeof(header.magic));
+		header.byte_order_mark = detail::tensor_file_byte_order_mark;
+		header.version = detail::tensor_file_version;
+		header.rank = static_cast<std::uint32_t>(layout.shape.size());
+		header.alignment = layout.alignment;
+		header.payload_offset = (sizeof(header) + layout.alignment - 1) / layout.alignment * layout.alignment;
+
+		// The payload spans up to the element with the largest offset.
+		header.payload_size = detail::has_zero_extent(layout.shape.data(), layout.shape.size()) ? 0 : 1;
+
+		for (std::size_t i{}; i < layout.shape.size(); ++i)
+		{
+			header.shape[i] = layout.shape[i];
+			header.strides[i] = strides[i];
+
+			if (header.payload_size > 0)
+			{
+				const auto extent = layout.shape[i] - 1;
+
+				if ((strides[i] > 0) && (extent > (detail::uint64_max - header.payload_size) / strides[i]))
+				{
+					throw tensor_file_error{ "The payload of a bfloat16 tensor must fit in 64 bits" };
+				}
+				header.payload_size += extent * strides[i];
+			}
+		}
+		if (header.payload_size > (detail::uint64_max - header.payload_offset) / sizeof(bfloat16_t))
+		{
+			throw tensor_file_error{ "The payload of a bfloat16 tensor must fit in 64 bits" };
+		}
+		return header;
+	}
+
+
+	// Writes a tensor file, storing the payload_size elements of the payload (as
+	// specified by make_tensor_file_header(layout)) from data. Throws std::system_error
+	// when the file cannot be written.
+	inline void write_tensor_file(const std::string& file_name, const tensor_layout& layout, const bfloat16_t* const data)
+	{
+		const auto header = make_tensor_file_header(layout);
+		std::ofstream stream{ file_name, std::ios::binary | std::ios::trunc };
+
+		if (stream)
+		{
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			const std::vector<char> padding(header.payload_offset - sizeof(header));
+			stream.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+			for (std::uint64_t offset{}; offset < header.payload_size; offset += detail::tensor_file_chunk_size)
+			{
+				stream.write(reinterpret_cast<const char*>(data + offset), static_cast<std::streamsize>(
+					std::min(detail::tensor_file_chunk_size, header.payload_size - offset) * sizeof(bfloat16_t)));
+			}
+			stream.close();
+		}
+		if (!stream)
+		{
+			throw std::system_error{ errno, std::generic_category(), "Failed to write bfloat16 tensor file \"" + file_name + "\"" };
+		}
+	}
+
+
+	// Read-only, contiguous sequence of bfloat16 values (similar to C++20 std::span).
+	class bfloat16_span
+	{
+	public:
+		using value_type = bfloat16_t;
+		using iterator = const bfloat16_t*;
+
+		bfloat16_span() noexcept = default;
+
+		bfloat16_span(const bfloat16_t* const data, const std::size_t size) noexcept
+			: data_{ data }, size_{ size }
+		{
+		}
+
+		const bfloat16_t* data() const noexcept
+		{
+			return data_;
+		}
+
+		std::size_t size() const noexcept
+		{
+			return size_;
+		}
+
+		bool empty() const noexcept
+		{
+			return size_ == 0;
+		}
+
+		const bfloat16_t& operator[](const std::size_t i) const noexcept
+		{
+			return data_[i];
+		}
+
+		iterator begin() const noexcept
+		{
+			return data_;
+		}
+
+		iterator end() const noexcept
+		{
+			return data_ + size_;
+		}
+
+	private:
+		const bfloat16_t* data_{};
+		std::size_t size_{};
+	};
+
+
+	// Read-only memory mapping of a tensor file. Opening is instant, whatever the size
+	// of the file: the payload is only paged in when it is accessed, directly from the
+	// page cache. Requires the file to have the native byte order of the platform
+	// (otherwise use read_tensor_file).
+	class mapped_tensor_file
+	{
+	public:
+		explicit mapped_tensor_file(const std::string& file_name)
+		{
+			map(file_name);
+
+			try
+			{
+				if (size_ < sizeof(header_))
+				{
+					throw tensor_file_error{ "Truncated bfloat16 tensor file" };
+				}
+				std::memcpy(&header_, address_, sizeof(header_));
+
+				if (!detail::check_header(header_, size_))
+				{
+					throw tensor_file_error{ "The byte order of the bfloat16 tensor file differs from this platform" };
+				}
+			}
+			catch (...)
+			{
+				unmap();
+				throw;
+			}
+		}
+
+		mapped_tensor_file(const mapped_tensor_file&) = delete;
+		mapped_tensor_file& operator=(const mapped_tensor_file&) = delete;
+
+		mapped_tensor_file(mapped_tensor_file&& other) noexcept
+			: address_{ other.address_ }, size_{ other.size_ }, header_(other.header_)
+		{
+			other.address_ = nullptr;
+			other.size_ = 0;
+		}
+
+		~mapped_tensor_file()
+		{
+			unmap();
+		}
+
+		const tensor_file_header& get_header() const noexcept
+		{
+			return header_;
+		}
+
+		std::vector<std::uint64_t> get_shape() const
+		{
+			return std::vector<std::uint64_t>(header_.shape, header_.shape + header_.rank);
+		}
+
+		std::vector<std::uint64_t> get_strides() const
+		{
+			return std::vector<std::uint64_t>(header_.strides, header_.strides + header_.rank);
+		}
+
+		// Returns a zero-copy view of the payload. Valid as long as the mapping exists.
+		bfloat16_span get_span() const noexcept
+		{
+			// The payload offset is a multiple of the alignment (a power of two, of at
+			// least alignof(bfloat16_t), as checked by check_header), so the elements are
+			// properly aligned for bfloat16_t.
+			return bfloat16_span{ reinterpret_cast<const bfloat16_t*>(static_cast<const char*>(address_) + header_.payload_offset),
+				static_cast<std::size_t>(header_.payload_size) };
+		}
+
+	private:
+#ifdef _WIN32
+		void map(const std::string& file_name)
+		{
+			const HANDLE file = ::CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				throw std::system_error{ static_cast<int>(::GetLastError()), std::system_category(),
+					"Failed to open bfloat16 tensor file \"" + file_name + "\"" };
+			}
+			LARGE_INTEGER file_size;
+
+			if (!::GetFileSizeEx(file, &file_size))
+			{
+				const auto error = ::GetLastError();
+				::CloseHandle(file);
+				throw std::system_error{ static_cast<int>(error), std::system_category(), "Failed to get file size" };
+			}
+			size_ = static_cast<std::size_t>(file_size.QuadPart);
+
+			if (size_ > 0)
+			{
+				const HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				const auto error = ::GetLastError();
+				::CloseHandle(file);
+
+				if (mapping == nullptr)
+				{
+					throw std::system_error{ static_cast<int>(error), std::system_category(), "Failed to map file" };
+				}
+				address_ = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				const auto map_error = ::GetLastError();
+				::CloseHandle(mapping);
+
+				if (address_ == nullptr)
+				{
+					throw std::system_error{ static_cast<int>(map_error), std::system_category(), "Failed to map file" };
+				}
+			}
+			else
+			{
+				::CloseHandle(file);
+			}
+		}
+
+		void unmap() noexcept
+		{
+			if (address_ != nullptr)
+			{
+				::UnmapViewOfFile(address_);
+			}
+		}
+#else
+		void map(const std::string& file_name)
+		{
+			const int file_descriptor{ ::open(file_name.c_str(), O_RDONLY) };
+
+			if (file_descriptor < 0)
+			{
+				throw std::system_error{ errno, std::generic_category(),
+					"Failed to open bfloat16 tensor file \"" + file_name + "\"" };
+			}
+			struct stat file_status;
+
+			if (::fstat(file_descriptor, &file_status) != 0)
+			{
+				const int error{ errno };
+				::close(file_descriptor);
+				throw std::system_error{ error, std::generic_category(), "Failed to get file size" };
+			}
+			size_ = static_cast<std::size_t>(file_status.st_size);
+
+			if (size_ > 0)
+			{
+				void* const address{ ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_descriptor, 0) };
+				const int error{ errno };
+				::close(file_descriptor);
+
+				if (address == MAP_FAILED)
+				{
+					throw std::system_error{ error, std::generic_category(), "Failed to map file" };
+				}
+				address_ = address;
+			}
+			else
+			{
+				::close(file_descriptor);
+			}
+		}
+
+		void unmap() noexcept
+		{
+			if (address_ != nullptr)
+			{
+				::munmap(address_, size_);
+			}
+		}
+#endif
+
+		void* address_{};
+		std::size_t size_{};
+		tensor_file_header header_{};
+	};
+
+
+	// The contents of a tensor file, read into memory.
+	struct tensor_file_contents
+	{
+		tensor_layout layout;
+		bfloat16_buffer payload;
+	};
+
+
+	// Reads a tensor file into memory, converting the byte order when necessary.
+	inline tensor_file_contents read_tensor_file(const std::string& file_name)
+	{
+		std::ifstream stream{ file_name, std::ios::binary | std::ios::ate };
+
+		if (!stream)
+		{
+			throw std::system_error{ errno, std::generic_category(), "Failed to open bfloat16 tensor file \"" + file_name + "\"" };
+		}
+		const auto file_size = static_cast<std::uint64_t>(stream.tellg());
+		tensor_file_header header{};
+
+		stream.seekg(0);
+		if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			throw tensor_file_error{ "Truncated bfloat16 tensor file" };
+		}
+		const bool is_native_byte_order{ detail::check_header(header, file_size) };
+
+		tensor_file_contents result{ { std::vector<std::uint64_t>(header.shape, header.shape + header.rank),
+			std::vector<std::uint64_t>(header.strides, header.strides + header.rank), header.alignment },
+			bfloat16_buffer(static_cast<std::size_t>(header.payload_size), uninitialized) };
+
+		stream.seekg(static_cast<std::streamoff>(header.payload_offset));
+
+		for (std::uint64_t offset{}; offset < header.payload_size; offset += detail::tensor_file_chunk_size)
+		{
+			if (!stream.read(reinterpret_cast<char*>(result.payload.data() + offset), static_cast<std::streamsize>(
+				std::min(detail::tensor_file_chunk_size, header.payload_size - offset) * sizeof(bfloat16_t))))
+			{
+				throw tensor_file_error{ "Failed to read the payload of bfloat16 tensor file \"" + file_name + "\"" };
+			}
+		}
+		if (!is_native_byte_order)
+		{
+			for (auto& element : result.payload)
+			{
+				const auto bits = get_raw_bits(element);
+				element = bfloat16_t{ static_cast<std::uint16_t>((bits >> 8) | (bits << 8)), true };
+			}
+		}
+		return result;
+	}
+
+}
+
+#endif
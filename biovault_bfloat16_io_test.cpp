@@ -0,0 +1,280 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_io.h"
+#include "biovault_bfloat16_io.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstdint>
+#include <cstdio>  // For remove.
+#include <fstream>
+#include <iterator> // For istreambuf_iterator.
+#include <string>
+#include <system_error>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::tensor_layout;
+
+
+namespace
+{
+	std::string get_temporary_file_name(const char* const name)
+	{
+		return testing::TempDir() + "biovault_bfloat16_io_test_" + name + ".bf16";
+	}
+
+
+	std::vector<bfloat16_t> make_sequence(const std::size_t n)
+	{
+		std::vector<bfloat16_t> result;
+		result.reserve(n);
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			result.push_back(bfloat16_t(static_cast<float>(i) - 0.5f));
+		}
+		return result;
+	}
+
+
+	// Writes a file with the specified (possibly invalid) header, followed by zero
+	// padding up to the payload offset, and then a payload of zeros.
+	void write_file_with_header(const std::string& file_name, const biovault::tensor_file_header& header,
+		const std::size_t number_of_payload_elements)
+	{
+		std::ofstream stream{ file_name, std::ios::binary };
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		const std::string padding_and_payload(
+			header.payload_offset - sizeof(header) + number_of_payload_elements * sizeof(bfloat16_t), '\0');
+		stream.write(padding_and_payload.data(), static_cast<std::streamsize>(padding_and_payload.size()));
+	}
+}
+
+
+GTEST_TEST(bfloat16_io, MappedFileHasSameLayoutAndPayloadAsWritten)
+{
+	const auto file_name = get_temporary_file_name("round_trip");
+	const tensor_layout layout{ { 3, 5, 7 }, {}, 64 };
+	const auto elements = make_sequence(3 * 5 * 7);
+
+	biovault::write_tensor_file(file_name, layout, elements.data());
+	{
+		const biovault::mapped_tensor_file mapped_file{ file_name };
+
+		EXPECT_EQ(mapped_file.get_shape(), layout.shape);
+		EXPECT_EQ(mapped_file.get_strides(), (std::vector<std::uint64_t>{ 35, 7, 1 }));
+		EXPECT_EQ(mapped_file.get_header().payload_offset % 64, 0U);
+
+		const auto span = mapped_file.get_span();
+		ASSERT_EQ(span.size(), elements.size());
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(span.data()) % 64, 0U);
+
+		for (std::size_t i{}; i < span.size(); ++i)
+		{
+			EXPECT_EQ(get_raw_bits(span[i]), get_raw_bits(elements[i]));
+		}
+	}
+	EXPECT_EQ(std::remove(file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_io, PayloadOfStridedTensorSpansUpToLastElement)
+{
+	const auto file_name = get_temporary_file_name("strided");
+
+	// A 2 x 3 view of every other column of a 2 x 6 matrix.
+	const tensor_layout layout{ { 2, 3 }, { 6, 2 } };
+	const auto header = biovault::make_tensor_file_header(layout);
+
+	EXPECT_EQ(header.payload_size, 6U + 2U * 2U + 1U);
+	EXPECT_EQ(header.payload_offset, biovault::tensor_file_default_alignment);
+
+	const auto elements = make_sequence(header.payload_size);
+	biovault::write_tensor_file(file_name, layout, elements.data());
+	{
+		const biovault::mapped_tensor_file mapped_file{ file_name };
+		EXPECT_EQ(mapped_file.get_strides(), layout.strides);
+		EXPECT_EQ(mapped_file.get_span().size(), header.payload_size);
+		EXPECT_EQ(get_raw_bits(mapped_file.get_span()[6 + 2 * 2]), get_raw_bits(elements.back()));
+	}
+	EXPECT_EQ(std::remove(file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_io, ReadFileConvertsForeignByteOrder)
+{
+	const auto file_name = get_temporary_file_name("foreign_byte_order");
+	const tensor_layout layout{ { 4, 2 }, {}, 256 };
+	const auto elements = make_sequence(8);
+
+	// Write the file as if it were written on a platform with the opposite byte order.
+	{
+		auto header = biovault::make_tensor_file_header(layout);
+		biovault::detail::swap_bytes(header);
+
+		std::ofstream stream{ file_name, std::ios::binary };
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(std::string(256 - sizeof(header), '\0').data(), 256 - sizeof(header));
+
+		for (const auto element : elements)
+		{
+			const auto bits = get_raw_bits(element);
+			const char bytes[] = { static_cast<char>(bits >> 8), static_cast<char>(bits & 0xFF) };
+			stream.write(bytes, sizeof(bytes));
+		}
+	}
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+
+	const auto contents = biovault::read_tensor_file(file_name);
+	EXPECT_EQ(contents.layout.shape, layout.shape);
+	EXPECT_EQ(contents.layout.strides, (std::vector<std::uint64_t>{ 2, 1 }));
+	EXPECT_EQ(contents.layout.alignment, 256U);
+	ASSERT_EQ(contents.payload.size(), elements.size());
+
+	for (std::size_t i{}; i < elements.size(); ++i)
+	{
+		EXPECT_EQ(get_raw_bits(contents.payload[i]), get_raw_bits(elements[i]));
+	}
+	EXPECT_EQ(std::remove(file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_io, InvalidFilesAreRejected)
+{
+	const auto file_name = get_temporary_file_name("invalid");
+	const auto elements = make_sequence(16);
+
+	std::ofstream{ file_name, std::ios::binary } << "Not a tensor file, but long enough to hold a header, "
+		"which has a size of 176 bytes, as checked by a static_assert in the header file. Some more text, to be sure.";
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+	EXPECT_THROW(biovault::read_tensor_file(file_name), biovault::tensor_file_error);
+
+	// Truncate a valid file.
+	biovault::write_tensor_file(file_name, tensor_layout{ { 16 }, {} }, elements.data());
+	std::string bytes;
+	{
+		std::ifstream stream{ file_name, std::ios::binary };
+		bytes.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+	}
+	bytes.pop_back();
+	std::ofstream{ file_name, std::ios::binary } << bytes;
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+	EXPECT_THROW(biovault::read_tensor_file(file_name), biovault::tensor_file_error);
+
+	EXPECT_EQ(std::remove(file_name.c_str()), 0);
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, std::system_error);
+	EXPECT_THROW(biovault::make_tensor_file_header(tensor_layout{ std::vector<std::uint64_t>(9, 1), {} }), biovault::tensor_file_error);
+}
+
+
+GTEST_TEST(bfloat16_io, UnalignedPayloadIsRejected)
+{
+	for (const std::uint64_t alignment : { 0, 1, 3, 6, 100 })
+	{
+		EXPECT_THROW(biovault::make_tensor_file_header(tensor_layout{ { 4 }, {}, alignment }),
+			biovault::tensor_file_error);
+	}
+	EXPECT_EQ(biovault::make_tensor_file_header(tensor_layout{ { 4 }, {}, 2 }).payload_offset, 176U);
+
+	const auto file_name = get_temporary_file_name("unaligned");
+	const auto valid_header = biovault::make_tensor_file_header(tensor_layout{ { 4 }, {}, 16 });
+
+	// An alignment of 1, with an odd payload offset.
+	auto header = valid_header;
+	header.alignment = 1;
+	header.payload_offset = 177;
+	write_file_with_header(file_name, header, 4);
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+	EXPECT_THROW(biovault::read_tensor_file(file_name), biovault::tensor_file_error);
+
+	// An alignment that is not a power of two.
+	header = valid_header;
+	header.alignment = 3;
+	header.payload_offset = 177;
+	write_file_with_header(file_name, header, 4);
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+	EXPECT_THROW(biovault::read_tensor_file(file_name), biovault::tensor_file_error);
+
+	// A valid alignment, but an odd payload offset.
+	header = valid_header;
+	header.alignment = 2;
+	header.payload_offset = 179;
+	write_file_with_header(file_name, header, 4);
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+	EXPECT_THROW(biovault::read_tensor_file(file_name), biovault::tensor_file_error);
+
+	// The unmodified header is accepted.
+	write_file_with_header(file_name, valid_header, 4);
+	EXPECT_EQ(biovault::mapped_tensor_file{ file_name }.get_span().size(), 4U);
+
+	EXPECT_EQ(std::remove(file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_io, StridesExceedingPayloadAreRejectedWhenNumberOfElementsWraps)
+{
+	const auto file_name = get_temporary_file_name("wrapping_shape");
+
+	// The product of the extents, 2^64, wraps around to zero, but the tensor is not
+	// empty: its last element would be at offset 2 * (2^32 - 1), far beyond the payload.
+	auto header = biovault::make_tensor_file_header(tensor_layout{ { 4, 4 }, { 1, 1 } });
+	header.shape[0] = std::uint64_t{ 1 } << 32;
+	header.shape[1] = std::uint64_t{ 1 } << 32;
+	write_file_with_header(file_name, header, static_cast<std::size_t>(header.payload_size));
+
+	EXPECT_THROW(biovault::mapped_tensor_file{ file_name }, biovault::tensor_file_error);
+	EXPECT_THROW(biovault::read_tensor_file(file_name), biovault::tensor_file_error);
+
+	// A shape with a zero extent is empty, whatever the other extents.
+	header.shape[1] = 0;
+	write_file_with_header(file_name, header, static_cast<std::size_t>(header.payload_size));
+	EXPECT_NO_THROW(biovault::mapped_tensor_file{ file_name });
+
+	EXPECT_EQ(std::remove(file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_io, WrappingLayoutsAreRejectedByTheWriter)
+{
+	constexpr std::uint64_t two_to_the_32{ std::uint64_t{ 1 } << 32 };
+
+	// The number of elements, 2^64, does not fit, and neither does the payload size.
+	EXPECT_THROW(biovault::get_number_of_elements({ two_to_the_32, two_to_the_32 }), biovault::tensor_file_error);
+	EXPECT_THROW(biovault::make_tensor_file_header(tensor_layout{ { two_to_the_32, two_to_the_32 }, {} }),
+		biovault::tensor_file_error);
+
+	// The row-major stride of the first dimension would be 2^65.
+	EXPECT_THROW(biovault::get_row_major_strides({ 2, two_to_the_32, two_to_the_32, 2 }), biovault::tensor_file_error);
+
+	// The last element would be at offset 2 * 2^63.
+	EXPECT_THROW(biovault::make_tensor_file_header(tensor_layout{ { 3 }, { std::uint64_t{ 1 } << 63 } }),
+		biovault::tensor_file_error);
+
+	// The payload size fits, but its size in bytes does not.
+	EXPECT_THROW(biovault::make_tensor_file_header(tensor_layout{ { std::uint64_t{ 1 } << 63 }, {} }),
+		biovault::tensor_file_error);
+
+	// The largest strides and number of elements that do fit are accepted.
+	EXPECT_EQ(biovault::get_row_major_strides({ 2, two_to_the_32, two_to_the_32 / 2 }).front(), std::uint64_t{ 1 } << 63);
+	EXPECT_EQ(biovault::get_number_of_elements({ two_to_the_32 - 1, two_to_the_32 + 1 }), ~std::uint64_t{});
+	EXPECT_EQ(biovault::get_number_of_elements({ 0, two_to_the_32, two_to_the_32 }), 0U);
+}
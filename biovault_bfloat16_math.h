@@ -0,0 +1,201 @@
+#ifndef BIOVAULT_BFLOAT16_MATH_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_MATH_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Elementwise math functions for bfloat16, by table lookup. As there are only
+// 65536 bfloat16 values, a unary function can be tabulated entirely, in a table of
+// 128 KiB, indexed by the raw bits of the argument. Each entry is computed in double
+// precision, and rounded only once to bfloat16, by bfloat16_t(double).
+// The tables of the predefined functions are built on their first use.
+
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_buffer.h"
+
+#include <cmath>
+#include <cstddef> // For size_t.
+#include <cstdint>
+
+namespace biovault {
+
+	namespace detail {
+
+		// The number of elements of a table: one for each bfloat16 value, plus padding,
+		// as a 32-bit gather of the last entry reads two bytes beyond it.
+		constexpr std::size_t function_table_size{ (std::size_t{ 1 } << 16) + 2 };
+
+		namespace scalar {
+
+			inline void apply_table(const bfloat16_t* const table, const bfloat16_t* const src, bfloat16_t* const dst,
+				const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					dst[i] = table[get_raw_bits(src[i])];
+				}
+			}
+		}
+
+		// The gather kernels fetch 32 bits at the byte offset of each entry (scale 2),
+		// and keep the lower 16 bits.
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void apply_table(const bfloat16_t* const table,
+				const bfloat16_t* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				const auto base = reinterpret_cast<const int*>(table);
+				const __m256i mask = _mm256_set1_epi32(0xFFFF);
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+					const __m256i low = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(indices));
+					const __m256i high = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(indices, 1));
+					const __m256i low_entries = _mm256_and_si256(_mm256_i32gather_epi32(base, low, 2), mask);
+					const __m256i high_entries = _mm256_and_si256(_mm256_i32gather_epi32(base, high, 2), mask);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low_entries, high_entries));
+				}
+				scalar::apply_table(table, src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void apply_table(const bfloat16_t* const table,
+				const bfloat16_t* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 32 <= n; i += 32)
+				{
+					const __m512i low = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+					const __m512i high = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16)));
+					const __m512i low_entries = _mm512_i32gather_epi32(low, table, 2);
+					const __m512i high_entries = _mm512_i32gather_epi32(high, table, 2);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi32_epi16(low_entries));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), _mm512_cvtepi32_epi16(high_entries));
+				}
+				scalar::apply_table(table, src + i, dst + i, n - i);
+			}
+		}
+#endif
+
+		using apply_table_function = void (*)(const bfloat16_t*, const bfloat16_t*, bfloat16_t*, std::size_t);
+
+		// SSE2 and NEON have no gather instructions, so they use the scalar kernel.
+		inline apply_table_function get_apply_table_kernel()
+		{
+			switch (get_simd_kernel())
+			{
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+				return avx2::apply_table;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			case simd_kernel::avx512_bf16:
+				return avx512::apply_table;
+#endif
+			default:
+				return scalar::apply_table;
+			}
+		}
+	}
+
+
+	namespace bf16_math {
+
+		// A unary function, tabulated for each bfloat16 argument.
+		class function_table
+		{
+		public:
+			// Tabulates the specified function, which takes and returns a double.
+			template <typename Function>
+			explicit function_table(const Function& function)
+				: entries_(detail::function_table_size)
+			{
+				for (std::uint32_t bits{}; bits <= 0xFFFFU; ++bits)
+				{
+					const float x{ bfloat16_t(static_cast<std::uint16_t>(bits), true) };
+					entries_[bits] = bfloat16_t(static_cast<double>(function(static_cast<double>(x))));
+				}
+			}
+
+			bfloat16_t operator()(const bfloat16_t x) const noexcept
+			{
+				return entries_[get_raw_bits(x)];
+			}
+
+			// Returns the 65536 entries, indexed by the raw bits of the argument.
+			const bfloat16_t* data() const noexcept
+			{
+				return entries_.data();
+			}
+
+		private:
+			bfloat16_buffer entries_;
+		};
+
+
+		// Applies the tabulated function to each of the n elements of src, storing the
+		// results in dst (which may be equal to src).
+		inline void apply(const function_table& table, const bfloat16_t* const src, bfloat16_t* const dst,
+			const std::size_t n)
+		{
+			detail::get_apply_table_kernel()(table.data(), src, dst, n);
+		}
+
+
+		// Predefined functions, each with the function to get its table, for use by apply:
+		// - exp, log, sqrt, rsqrt (1/sqrt), reciprocal (1/x), tanh
+		// - sigmoid: 1/(1 + exp(-x))
+		// - gelu: the exact GELU, x * (1 + erf(x/sqrt(2))) / 2, computed as x * erfc(-x/sqrt(2)) / 2,
+		//   to avoid cancellation for negative x
+		// - silu: x * sigmoid(x)
+#define BIOVAULT_BFLOAT16_MATH_FUNCTION(name, expression) \
+		inline const function_table& get_##name##_table() \
+		{ \
+			static const function_table table{ [](const double x) { return expression; } }; \
+			return table; \
+		} \
+		inline bfloat16_t name(const bfloat16_t x) \
+		{ \
+			return get_##name##_table()(x); \
+		}
+
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(exp, std::exp(x))
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(log, std::log(x))
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(sqrt, std::sqrt(x))
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(rsqrt, 1.0 / std::sqrt(x))
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(reciprocal, 1.0 / x)
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(tanh, std::tanh(x))
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(sigmoid, 1.0 / (1.0 + std::exp(-x)))
+		// For x = -infinity, gelu and silu would otherwise compute NaN, rather than zero.
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(gelu, std::isinf(x) ? std::fmax(x, 0.0) : 0.5 * x * std::erfc(-x / std::sqrt(2.0)))
+		BIOVAULT_BFLOAT16_MATH_FUNCTION(silu, std::isinf(x) ? std::fmax(x, 0.0) : x / (1.0 + std::exp(-x)))
+
+#undef BIOVAULT_BFLOAT16_MATH_FUNCTION
+	}
+
+}
+
+#endif
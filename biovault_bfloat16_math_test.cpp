@@ -0,0 +1,165 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_math.h"
+#include "biovault_bfloat16_math.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cfloat>  // For FLT_MIN.
+#include <cmath>
+#include <cstdint>
+#include <utility> // For pair.
+#include <vector>
+
+using biovault::bfloat16_t;
+namespace bf16_math = biovault::bf16_math;
+
+
+namespace
+{
+	bfloat16_t raw_bits_to_bfloat16(const std::uint32_t bits)
+	{
+		return bfloat16_t(static_cast<std::uint16_t>(bits), true);
+	}
+
+
+	// Checks that the result is the bfloat16 nearest to the exact value, as far as it
+	// is a normal bfloat16. Otherwise only checks its category.
+	void expect_correctly_rounded(const bfloat16_t result, const double exact, const std::uint32_t argument_bits)
+	{
+		const float result_float{ result };
+
+		if (std::isnan(exact))
+		{
+			EXPECT_TRUE(std::isnan(result_float)) << argument_bits;
+			return;
+		}
+		ASSERT_FALSE(std::isnan(result_float)) << argument_bits;
+
+		const auto magnitude = std::fabs(static_cast<double>(result_float));
+
+		if ((magnitude >= FLT_MIN) && !std::isinf(result_float))
+		{
+			// The exact value must be between the midpoints from the result to its neighbors.
+			const auto bits = get_raw_bits(result);
+			const double lower{ raw_bits_to_bfloat16(bits - 1U) };
+			const double upper{ raw_bits_to_bfloat16(bits + 1U) };
+			const double result_double{ result_float };
+
+			// Only the neighbor at the side of the exact value is relevant, as the distances
+			// to the neighbors differ at a power of two.
+			const double neighbor{ (std::signbit(exact - result_double) == std::signbit(upper - result_double)) ? upper : lower };
+
+			EXPECT_LE(std::fabs(exact - result_double), std::fabs(neighbor - result_double) / 2) << argument_bits;
+		}
+		else
+		{
+			if (std::isinf(result_float))
+			{
+				EXPECT_GT(std::fabs(exact), 3.38e38) << argument_bits;
+			}
+			else
+			{
+				EXPECT_LT(std::fabs(exact), FLT_MIN) << argument_bits;
+			}
+			EXPECT_EQ(std::signbit(result_float), std::signbit(exact)) << argument_bits;
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_math, FunctionTableRoundsOnlyOnce)
+{
+	// 1 + 2^-8 + 2^-40 is just above the midpoint between the bfloat16 values 1 and
+	// 1 + 2^-7, but rounding it to float would yield the midpoint, a tie to even.
+	const bf16_math::function_table table{ [](const double x) { return x + std::ldexp(1.0, -8) + std::ldexp(1.0, -40); } };
+
+	EXPECT_EQ(float{ table(bfloat16_t(1.0f)) }, 1.0f + std::ldexp(1.0f, -7));
+}
+
+
+GTEST_TEST(bfloat16_math, PredefinedFunctionsAreCorrectlyRounded)
+{
+	using function_pair = std::pair<bfloat16_t(*)(bfloat16_t), double(*)(double)>;
+
+	const function_pair functions[] = {
+		{ bf16_math::exp, [](const double x) { return std::exp(x); } },
+		{ bf16_math::log, [](const double x) { return std::log(x); } },
+		{ bf16_math::sqrt, [](const double x) { return std::sqrt(x); } },
+		{ bf16_math::rsqrt, [](const double x) { return 1.0 / std::sqrt(x); } },
+		{ bf16_math::reciprocal, [](const double x) { return 1.0 / x; } },
+		{ bf16_math::tanh, [](const double x) { return std::tanh(x); } },
+		{ bf16_math::sigmoid, [](const double x) { return 1.0 / (1.0 + std::exp(-x)); } },
+		{ bf16_math::gelu, [](const double x) { return std::isinf(x) ? std::fmax(x, 0.0) : 0.5 * x * std::erfc(-x / std::sqrt(2.0)); } },
+		{ bf16_math::silu, [](const double x) { return std::isinf(x) ? std::fmax(x, 0.0) : x / (1.0 + std::exp(-x)); } } };
+
+	for (const auto& function : functions)
+	{
+		for (std::uint32_t bits{}; bits <= 0xFFFFU; ++bits)
+		{
+			const auto x = raw_bits_to_bfloat16(bits);
+			expect_correctly_rounded(function.first(x), function.second(float{ x }), bits);
+		}
+	}
+	EXPECT_EQ(float{ bf16_math::exp(bfloat16_t{ 0.0f }) }, 1.0f);
+	EXPECT_EQ(float{ bf16_math::sqrt(bfloat16_t{ 4.0f }) }, 2.0f);
+	EXPECT_EQ(float{ bf16_math::gelu(bfloat16_t{ -INFINITY }) }, 0.0f);
+}
+
+
+GTEST_TEST(bfloat16_math, ApplyOfEachKernelEqualsElementwiseLookup)
+{
+	const bf16_math::function_table table{ [](const double x) { return x * x - 1.0; } };
+
+	std::vector<bfloat16_t> src;
+
+	for (std::uint32_t bits{}; bits <= 0xFFFFU; ++bits)
+	{
+		src.push_back(raw_bits_to_bfloat16(bits ^ 0x5A5AU));
+	}
+	src.resize(src.size() + 7, raw_bits_to_bfloat16(0xFFFFU));
+
+	std::vector<bfloat16_t> dst(src.size());
+
+	biovault::test::for_each_supported_simd_kernel([&table, &src, &dst]
+		{
+			for (const std::size_t offset : { 0, 1 })
+			{
+				bf16_math::apply(table, src.data() + offset, dst.data(), src.size() - offset);
+
+				for (std::size_t i{}; i < src.size() - offset; ++i)
+				{
+					ASSERT_EQ(get_raw_bits(dst[i]), get_raw_bits(table(src[i + offset])));
+				}
+			}
+		});
+
+	// In place.
+	auto values = src;
+	bf16_math::apply(bf16_math::get_exp_table(), values.data(), values.data(), values.size());
+
+	for (std::size_t i{}; i < values.size(); ++i)
+	{
+		ASSERT_EQ(get_raw_bits(values[i]), get_raw_bits(bf16_math::exp(src[i])));
+	}
+}
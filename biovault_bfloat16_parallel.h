@@ -0,0 +1,263 @@
+#ifndef BIOVAULT_BFLOAT16_PARALLEL_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_PARALLEL_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For min.
+#include <condition_variable>
+#include <cstddef>   // For size_t.
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace biovault {
+
+	// Small pool of worker threads, for the parallel bulk functions. The thread that
+	// calls run participates in the work, so a pool of N threads has N - 1 workers.
+	class thread_pool
+	{
+	public:
+		// Creates a pool of the specified number of threads (including the calling
+		// thread). Zero means: the number of hardware threads.
+		explicit thread_pool(unsigned number_of_threads = 0)
+		{
+			if (number_of_threads == 0)
+			{
+				number_of_threads = std::max(std::thread::hardware_concurrency(), 1U);
+			}
+			workers_.reserve(number_of_threads - 1);
+
+			for (unsigned thread_index{ 1 }; thread_index < number_of_threads; ++thread_index)
+			{
+				workers_.emplace_back([this, thread_index] { work(thread_index); });
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		~thread_pool()
+		{
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+				is_stopping_ = true;
+			}
+			job_available_.notify_all();
+
+			for (auto& worker : workers_)
+			{
+				worker.join();
+			}
+		}
+
+		unsigned get_number_of_threads() const
+		{
+			return static_cast<unsigned>(workers_.size() + 1);
+		}
+
+		// Calls job(thread_index) for each thread_index in [0, number_of_participants),
+		// concurrently, and waits until all calls are finished. The calling thread
+		// itself has thread_index zero. The number of participants must not exceed the
+		// number of threads of the pool. The job must not throw, and must not call run
+		// on the same pool. Concurrent calls to run are executed one after the other.
+		void run(const unsigned number_of_participants, const std::function<void(unsigned)>& job)
+		{
+			const std::lock_guard<std::mutex> run_lock{ run_mutex_ };
+			{
+				const std::lock_guard<std::mutex> lock{ mutex_ };
+				job_ = &job;
+				number_of_participants_ = number_of_participants;
+				number_of_unfinished_workers_ = number_of_participants - 1;
+				++generation_;
+			}
+			job_available_.notify_all();
+			job(0);
+
+			std::unique_lock<std::mutex> lock{ mutex_ };
+			job_finished_.wait(lock, [this] { return number_of_unfinished_workers_ == 0; });
+			job_ = nullptr;
+		}
+
+	private:
+		void work(const unsigned thread_index)
+		{
+			std::size_t previous_generation{};
+
+			for (;;)
+			{
+				const std::function<void(unsigned)>* job{};
+				{
+					std::unique_lock<std::mutex> lock{ mutex_ };
+					job_available_.wait(lock, [this, previous_generation]
+						{
+							return is_stopping_ || (generation_ != previous_generation);
+						});
+
+					if (is_stopping_)
+					{
+						return;
+					}
+					previous_generation = generation_;
+
+					if (thread_index >= number_of_participants_)
+					{
+						continue;
+					}
+					job = job_;
+				}
+				(*job)(thread_index);
+				{
+					const std::lock_guard<std::mutex> lock{ mutex_ };
+					--number_of_unfinished_workers_;
+				}
+				job_finished_.notify_one();
+			}
+		}
+
+		std::mutex run_mutex_;
+		std::mutex mutex_;
+		std::condition_variable job_available_;
+		std::condition_variable job_finished_;
+		const std::function<void(unsigned)>* job_{};
+		unsigned number_of_participants_{};
+		unsigned number_of_unfinished_workers_{};
+		std::size_t generation_{};
+		bool is_stopping_{};
+		std::vector<std::thread> workers_;
+	};
+
+
+	// Returns the pool that is used by default by the parallel bulk functions, having
+	// as many threads as the hardware supports.
+	inline thread_pool& get_default_thread_pool()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+
+
+	namespace detail {
+
+		// The number of elements that is converted at once by a thread: small enough
+		// for both the source and the destination of a chunk to fit in the L2 cache,
+		// and for a chunk of bfloat16 to cover whole pages of 4 KiB.
+		constexpr std::size_t parallel_chunk_size{ std::size_t{ 1 } << 14 };
+
+		// Below this number of elements per thread, the overhead of waking up another
+		// thread outweighs the gain.
+		constexpr std::size_t parallel_minimum_size_per_thread{ std::size_t{ 1 } << 18 };
+
+		// Splits the range [0, n) into one contiguous part per thread, and lets each
+		// thread process its part chunk by chunk, by calling process(offset, count).
+		// Because each thread is the first to write its part of the destination, the
+		// operating system typically maps those pages to the NUMA node of that thread
+		// ("first touch"), provided that the destination is freshly allocated and not
+		// yet initialized (for example, by a bfloat16_buffer constructed by
+		// biovault::uninitialized).
+		template <typename Process>
+		void parallel_for_each_chunk(thread_pool& pool, const std::size_t n, const Process& process)
+		{
+			const auto number_of_chunks = (n + parallel_chunk_size - 1) / parallel_chunk_size;
+			const auto number_of_threads = static_cast<unsigned>(std::min<std::size_t>(
+				pool.get_number_of_threads(), n / parallel_minimum_size_per_thread));
+
+			if (number_of_threads <= 1)
+			{
+				for (std::size_t offset{}; offset < n; offset += parallel_chunk_size)
+				{
+					process(offset, std::min(parallel_chunk_size, n - offset));
+				}
+				return;
+			}
+
+			pool.run(number_of_threads, [number_of_chunks, number_of_threads, n, &process](const unsigned thread_index)
+				{
+					const auto begin_chunk = number_of_chunks * thread_index / number_of_threads;
+					const auto end_chunk = number_of_chunks * (thread_index + 1) / number_of_threads;
+
+					for (auto chunk = begin_chunk; chunk < end_chunk; ++chunk)
+					{
+						const auto offset = chunk * parallel_chunk_size;
+						process(offset, std::min(parallel_chunk_size, n - offset));
+					}
+				});
+		}
+	}
+
+
+	// Parallel versions of the bulk conversion functions, for very large arrays. They
+	// yield exactly the same results as the corresponding convert functions.
+
+	inline void parallel_convert(const float* const src, bfloat16_t* const dst, const std::size_t n,
+		thread_pool& pool = get_default_thread_pool())
+	{
+		detail::parallel_for_each_chunk(pool, n, [src, dst](const std::size_t offset, const std::size_t count)
+			{
+				convert(src + offset, dst + offset, count);
+			});
+	}
+
+
+	inline void parallel_convert(const float* const src, bfloat16_t* const dst, const std::size_t n,
+		const round_to_nearest_even_t, thread_pool& pool = get_default_thread_pool())
+	{
+		parallel_convert(src, dst, n, pool);
+	}
+
+
+	inline void parallel_convert(const float* const src, bfloat16_t* const dst, const std::size_t n,
+		const round_toward_zero_t, thread_pool& pool = get_default_thread_pool())
+	{
+		detail::parallel_for_each_chunk(pool, n, [src, dst](const std::size_t offset, const std::size_t count)
+			{
+				convert(src + offset, dst + offset, count, round_toward_zero);
+			});
+	}
+
+
+	// Yields the same results as a sequential stochastic conversion, as each chunk
+	// uses the random bits of its own counter positions. Advances the counter by n.
+	inline void parallel_convert(const float* const src, bfloat16_t* const dst, const std::size_t n,
+		stochastic_rounding& rounding, thread_pool& pool = get_default_thread_pool())
+	{
+		const stochastic_rounding initial_rounding{ rounding };
+
+		detail::parallel_for_each_chunk(pool, n, [src, dst, &initial_rounding](const std::size_t offset, const std::size_t count)
+			{
+				stochastic_rounding chunk_rounding{ initial_rounding };
+				chunk_rounding.discard(offset);
+				convert(src + offset, dst + offset, count, chunk_rounding);
+			});
+		rounding.discard(n);
+	}
+
+
+	inline void parallel_convert(const bfloat16_t* const src, float* const dst, const std::size_t n,
+		thread_pool& pool = get_default_thread_pool())
+	{
+		detail::parallel_for_each_chunk(pool, n, [src, dst](const std::size_t offset, const std::size_t count)
+			{
+				convert(src + offset, dst + offset, count);
+			});
+	}
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_parallel.h"
+#include "biovault_bfloat16_parallel.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using biovault::bfloat16_t;
+
+
+namespace
+{
+	std::vector<float> get_floats_for_parallel_conversion_test(const std::size_t n)
+	{
+		std::vector<float> result(n);
+		std::uint32_t state{ 42 };
+
+		for (auto& element : result)
+		{
+			state = biovault::stochastic_rounding::hash(state);
+			element = static_cast<float>(state) / 65536.0f - 32768.0f;
+		}
+		return result;
+	}
+
+
+	// Sizes around the threshold for multithreading, and sizes that are not a multiple
+	// of the chunk size.
+	const std::size_t sizes_for_parallel_conversion_test[] = { 0, 1, 100000, 1U << 20, (1U << 21) + 12345 };
+
+
+	void expect_equal_raw_bits(const std::vector<bfloat16_t>& actual, const std::vector<bfloat16_t>& expected)
+	{
+		ASSERT_EQ(actual.size(), expected.size());
+
+		for (std::size_t i{}; i < actual.size(); ++i)
+		{
+			ASSERT_EQ(get_raw_bits(actual[i]), get_raw_bits(expected[i])) << "i = " << i;
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_parallel, ThreadPoolRunsJobOnEachParticipant)
+{
+	for (unsigned number_of_threads{ 1 }; number_of_threads <= 4; ++number_of_threads)
+	{
+		biovault::thread_pool pool{ number_of_threads };
+		ASSERT_EQ(pool.get_number_of_threads(), number_of_threads);
+
+		for (unsigned number_of_participants{ 1 }; number_of_participants <= number_of_threads; ++number_of_participants)
+		{
+			std::vector<std::atomic<int>> calls(number_of_threads);
+
+			for (int repetition{}; repetition < 10; ++repetition)
+			{
+				pool.run(number_of_participants, [&calls](const unsigned thread_index) { ++calls[thread_index]; });
+			}
+			for (unsigned thread_index{}; thread_index < number_of_threads; ++thread_index)
+			{
+				EXPECT_EQ(calls[thread_index], (thread_index < number_of_participants) ? 10 : 0);
+			}
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_parallel, ParallelConversionFromFloatEqualsSequentialConversion)
+{
+	for (unsigned number_of_threads{ 1 }; number_of_threads <= 3; ++number_of_threads)
+	{
+		biovault::thread_pool pool{ number_of_threads };
+
+		for (const auto n : sizes_for_parallel_conversion_test)
+		{
+			const auto floats = get_floats_for_parallel_conversion_test(n);
+			std::vector<bfloat16_t> expected(n);
+			std::vector<bfloat16_t> actual(n);
+
+			biovault::convert(floats.data(), expected.data(), n);
+			biovault::parallel_convert(floats.data(), actual.data(), n, pool);
+			expect_equal_raw_bits(actual, expected);
+
+			biovault::convert(floats.data(), expected.data(), n, biovault::round_toward_zero);
+			biovault::parallel_convert(floats.data(), actual.data(), n, biovault::round_toward_zero, pool);
+			expect_equal_raw_bits(actual, expected);
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_parallel, ParallelStochasticConversionEqualsSequentialConversion)
+{
+	biovault::thread_pool pool{ 3 };
+
+	for (const auto n : sizes_for_parallel_conversion_test)
+	{
+		const auto floats = get_floats_for_parallel_conversion_test(n);
+		std::vector<bfloat16_t> expected(n);
+		std::vector<bfloat16_t> actual(n);
+		biovault::stochastic_rounding sequential_rounding{ 7, 0xFFFF0000U };
+		biovault::stochastic_rounding parallel_rounding{ sequential_rounding };
+
+		biovault::convert(floats.data(), expected.data(), n, sequential_rounding);
+		biovault::parallel_convert(floats.data(), actual.data(), n, parallel_rounding, pool);
+		expect_equal_raw_bits(actual, expected);
+		EXPECT_EQ(parallel_rounding.get_counter(), sequential_rounding.get_counter());
+		EXPECT_EQ(parallel_rounding.get_key(), sequential_rounding.get_key());
+	}
+}
+
+
+GTEST_TEST(bfloat16_parallel, ParallelConversionToFloatPlacesRawBitsInUpperHalf)
+{
+	constexpr std::size_t n{ (1U << 22) + 3 };
+	std::vector<bfloat16_t> bfloats(n);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		bfloats[i] = bfloat16_t{ static_cast<std::uint16_t>(i), true };
+	}
+	std::vector<float> floats(n);
+	biovault::parallel_convert(bfloats.data(), floats.data(), n);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, &floats[i], sizeof(bits));
+		ASSERT_EQ(bits, static_cast<std::uint32_t>(i & 0xFFFFU) << 16);
+	}
+}
@@ -0,0 +1,489 @@
+#ifndef BIOVAULT_BFLOAT16_QUANTIZE_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_QUANTIZE_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Bulk conversion from float to bfloat16 that also measures the error, per block
+// of consecutive elements, in the same pass. Optionally, each block is scaled up by
+// a power of two, stored as a float per block. As the precision of bfloat16 is
+// relative, scaling does not add significant digits, but it does extend the range
+// downward: a block of tiny (denormal) values is not flushed to zero. Blocks are
+// never scaled down, as that cannot prevent overflow (bfloat16 has the same exponent
+// range as float), and would only flush the small elements of a block to zero. A
+// power of two is chosen, because multiplying by it is exact.
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For max and min.
+#include <cfloat>    // For FLT_MAX.
+#include <cmath>
+#include <cstddef>   // For size_t.
+#include <cstdint>
+
+namespace biovault {
+
+	// The error of converting a block of floats to bfloat16. Elements that overflow
+	// (finite floats that yield an infinite result) are counted, rather than being
+	// included in the maximum errors. Infinite and NaN elements do not contribute.
+	// The relative error of an element is its absolute error divided by its
+	// magnitude. Zero elements do not contribute to the maximum relative error.
+	struct quantization_error
+	{
+		float max_absolute_error;
+		float max_relative_error;
+		std::size_t number_of_overflows;
+	};
+
+
+	namespace detail {
+
+		inline void add_quantization_error(quantization_error& error, const quantization_error& other)
+		{
+			error.max_absolute_error = std::max(error.max_absolute_error, other.max_absolute_error);
+			error.max_relative_error = std::max(error.max_relative_error, other.max_relative_error);
+			error.number_of_overflows += other.number_of_overflows;
+		}
+
+		// Returns the power of two by which a block whose largest finite magnitude is
+		// the specified value is divided, so that this value becomes (about) one, when
+		// it is less than one. The exponent is clamped to [-126, 0], so that both the
+		// scale and its inverse are normal floats, and blocks are only scaled up.
+		inline float get_power_of_two_scale(const float max_magnitude)
+		{
+			if (!std::isgreater(max_magnitude, 0.0f))
+			{
+				return 1.0f;
+			}
+			return std::ldexp(1.0f, std::min(std::max(std::ilogb(max_magnitude), -126), 0));
+		}
+
+#ifdef BIOVAULT_BFLOAT16_INSTRUMENTATION
+		// Counts the conversion of the n scaled floats src[i] / scale to dst[i]. The
+		// scaled floats are counted, as those are the ones actually converted.
+		inline void count_scaled_conversions(const float* const src, const bfloat16_t* const dst, const std::size_t n,
+			const float scale)
+		{
+			const float inverse_scale{ 1.0f / scale };
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				const float scaled{ src[i] * inverse_scale };
+				BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(&scaled, dst + i, 1);
+			}
+		}
+#endif
+
+		namespace scalar {
+
+			// Returns the largest magnitude of the finite elements, or zero when there are none.
+			inline float get_max_finite_magnitude(const float* const src, const std::size_t n)
+			{
+				float result{};
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto magnitude = std::fabs(src[i]);
+
+					if (std::isgreater(magnitude, result) && std::isfinite(magnitude))
+					{
+						result = magnitude;
+					}
+				}
+				return result;
+			}
+
+			// Converts src[i] / scale to bfloat16 (scale being a power of two), and adds the
+			// error of the reconstruction dst[i] * scale to the specified error.
+			inline void convert_and_measure(const float* const src, bfloat16_t* const dst, const std::size_t n,
+				const float scale, quantization_error& error)
+			{
+				const float inverse_scale{ 1.0f / scale };
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto x = src[i];
+					dst[i] = bfloat16_t::from_float_branchless(x * inverse_scale);
+
+					const auto magnitude = std::fabs(x);
+					const auto reconstruction = float{ dst[i] } * scale;
+
+					if (std::isinf(reconstruction) && std::isfinite(x))
+					{
+						++error.number_of_overflows;
+					}
+					else
+					{
+						// For infinite and NaN elements, the difference is NaN, so then both
+						// isgreater calls return false.
+						const auto difference = std::fabs(x - reconstruction);
+
+						if (std::isgreater(difference, error.max_absolute_error))
+						{
+							error.max_absolute_error = difference;
+						}
+						if (std::isgreater(difference / magnitude, error.max_relative_error))
+						{
+							error.max_relative_error = difference / magnitude;
+						}
+					}
+				}
+			}
+		}
+
+		// The SIMD kernels accumulate the maximum errors by max(difference, maximum),
+		// which returns its second operand when the first one is NaN, just like the
+		// isgreater calls of the scalar kernel.
+
+#ifdef BIOVAULT_BFLOAT16_SSE2
+		namespace sse2 {
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline float reduce_max(const __m128 v)
+			{
+				const __m128 pairs = _mm_max_ps(v, _mm_movehl_ps(v, v));
+				return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline float get_max_finite_magnitude(const float* const src, const std::size_t n)
+			{
+				const __m128 magnitude_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+				const __m128 max_finite = _mm_set1_ps(FLT_MAX);
+				__m128 result = _mm_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 4 <= n; i += 4)
+				{
+					const __m128 magnitude = _mm_and_ps(_mm_loadu_ps(src + i), magnitude_mask);
+					result = _mm_max_ps(_mm_and_ps(magnitude, _mm_cmple_ps(magnitude, max_finite)), result);
+				}
+				return std::max(reduce_max(result), scalar::get_max_finite_magnitude(src + i, n - i));
+			}
+
+			// Adds the errors of four reconstructed elements to the running maximums and counts.
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void measure(const __m128 x, const __m128 reconstruction,
+				__m128& max_absolute_error, __m128& max_relative_error, __m128i& number_of_overflows)
+			{
+				const __m128 magnitude_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+				const __m128 max_finite = _mm_set1_ps(FLT_MAX);
+				const __m128 magnitude = _mm_and_ps(x, magnitude_mask);
+				const __m128 is_overflow = _mm_and_ps(_mm_cmple_ps(magnitude, max_finite),
+					_mm_cmpgt_ps(_mm_and_ps(reconstruction, magnitude_mask), max_finite));
+				const __m128 difference = _mm_andnot_ps(is_overflow,
+					_mm_and_ps(_mm_sub_ps(x, reconstruction), magnitude_mask));
+
+				max_absolute_error = _mm_max_ps(difference, max_absolute_error);
+				max_relative_error = _mm_max_ps(_mm_div_ps(difference, magnitude), max_relative_error);
+				number_of_overflows = _mm_sub_epi32(number_of_overflows, _mm_castps_si128(is_overflow));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void convert_and_measure(const float* const src, bfloat16_t* const dst,
+				const std::size_t n, const float scale, quantization_error& error)
+			{
+				const __m128 scale_vector = _mm_set1_ps(scale);
+				const __m128 inverse_scale = _mm_set1_ps(1.0f / scale);
+				__m128 max_absolute_error = _mm_setzero_ps();
+				__m128 max_relative_error = _mm_setzero_ps();
+				__m128i number_of_overflows = _mm_setzero_si128();
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m128 low = _mm_loadu_ps(src + i);
+					const __m128 high = _mm_loadu_ps(src + i + 4);
+					const __m128i low_bits = convert_to_bits_of_bfloat16(_mm_mul_ps(low, inverse_scale));
+					const __m128i high_bits = convert_to_bits_of_bfloat16(_mm_mul_ps(high, inverse_scale));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pack(low_bits, high_bits));
+
+					measure(low, _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(low_bits, 16)), scale_vector),
+						max_absolute_error, max_relative_error, number_of_overflows);
+					measure(high, _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(high_bits, 16)), scale_vector),
+						max_absolute_error, max_relative_error, number_of_overflows);
+				}
+				alignas(16) std::uint32_t counts[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(counts), number_of_overflows);
+
+				const quantization_error vector_error{ reduce_max(max_absolute_error), reduce_max(max_relative_error),
+					std::size_t{ counts[0] } + counts[1] + counts[2] + counts[3] };
+				add_quantization_error(error, vector_error);
+				scalar::convert_and_measure(src + i, dst + i, n - i, scale, error);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline float reduce_max(const __m256 v)
+			{
+				return sse2::reduce_max(_mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline float get_max_finite_magnitude(const float* const src, const std::size_t n)
+			{
+				const __m256 magnitude_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+				const __m256 max_finite = _mm256_set1_ps(FLT_MAX);
+				__m256 result = _mm256_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 8 <= n; i += 8)
+				{
+					const __m256 magnitude = _mm256_and_ps(_mm256_loadu_ps(src + i), magnitude_mask);
+					result = _mm256_max_ps(_mm256_and_ps(magnitude, _mm256_cmp_ps(magnitude, max_finite, _CMP_LE_OQ)), result);
+				}
+				return std::max(reduce_max(result), scalar::get_max_finite_magnitude(src + i, n - i));
+			}
+
+			// Adds the errors of eight reconstructed elements to the running maximums and counts.
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void measure(const __m256 x, const __m256 reconstruction,
+				__m256& max_absolute_error, __m256& max_relative_error, __m256i& number_of_overflows)
+			{
+				const __m256 magnitude_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+				const __m256 max_finite = _mm256_set1_ps(FLT_MAX);
+				const __m256 magnitude = _mm256_and_ps(x, magnitude_mask);
+				const __m256 is_overflow = _mm256_and_ps(_mm256_cmp_ps(magnitude, max_finite, _CMP_LE_OQ),
+					_mm256_cmp_ps(_mm256_and_ps(reconstruction, magnitude_mask), max_finite, _CMP_GT_OQ));
+				const __m256 difference = _mm256_andnot_ps(is_overflow,
+					_mm256_and_ps(_mm256_sub_ps(x, reconstruction), magnitude_mask));
+
+				max_absolute_error = _mm256_max_ps(difference, max_absolute_error);
+				max_relative_error = _mm256_max_ps(_mm256_div_ps(difference, magnitude), max_relative_error);
+				number_of_overflows = _mm256_sub_epi32(number_of_overflows, _mm256_castps_si256(is_overflow));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void convert_and_measure(const float* const src, bfloat16_t* const dst,
+				const std::size_t n, const float scale, quantization_error& error)
+			{
+				const __m256 scale_vector = _mm256_set1_ps(scale);
+				const __m256 inverse_scale = _mm256_set1_ps(1.0f / scale);
+				__m256 max_absolute_error = _mm256_setzero_ps();
+				__m256 max_relative_error = _mm256_setzero_ps();
+				__m256i number_of_overflows = _mm256_setzero_si256();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m256 low = _mm256_loadu_ps(src + i);
+					const __m256 high = _mm256_loadu_ps(src + i + 8);
+					const __m256i low_bits = convert_to_bits_of_bfloat16(_mm256_mul_ps(low, inverse_scale));
+					const __m256i high_bits = convert_to_bits_of_bfloat16(_mm256_mul_ps(high, inverse_scale));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low_bits, high_bits));
+
+					measure(low, _mm256_mul_ps(_mm256_castsi256_ps(_mm256_slli_epi32(low_bits, 16)), scale_vector),
+						max_absolute_error, max_relative_error, number_of_overflows);
+					measure(high, _mm256_mul_ps(_mm256_castsi256_ps(_mm256_slli_epi32(high_bits, 16)), scale_vector),
+						max_absolute_error, max_relative_error, number_of_overflows);
+				}
+				alignas(32) std::uint32_t counts[8];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(counts), number_of_overflows);
+
+				std::size_t total_count{};
+
+				for (const auto count : counts)
+				{
+					total_count += count;
+				}
+				const quantization_error vector_error{ reduce_max(max_absolute_error), reduce_max(max_relative_error),
+					total_count };
+				add_quantization_error(error, vector_error);
+				scalar::convert_and_measure(src + i, dst + i, n - i, scale, error);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline float get_max_finite_magnitude(const float* const src, const std::size_t n)
+			{
+				const __m512 max_finite = _mm512_set1_ps(FLT_MAX);
+				__m512 result = _mm512_setzero_ps();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m512 magnitude = _mm512_abs_ps(_mm512_loadu_ps(src + i));
+					result = _mm512_mask_max_ps(result, _mm512_cmp_ps_mask(magnitude, max_finite, _CMP_LE_OQ), magnitude, result);
+				}
+				return std::max(_mm512_reduce_max_ps(result), scalar::get_max_finite_magnitude(src + i, n - i));
+			}
+
+			// Adds the errors of sixteen reconstructed elements to the running maximums and counts.
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void measure(const __m512 x, const __m512 reconstruction,
+				__m512& max_absolute_error, __m512& max_relative_error, __m512i& number_of_overflows)
+			{
+				const __m512 max_finite = _mm512_set1_ps(FLT_MAX);
+				const __m512 magnitude = _mm512_abs_ps(x);
+				const __mmask16 is_overflow = _mm512_mask_cmp_ps_mask(
+					_mm512_cmp_ps_mask(magnitude, max_finite, _CMP_LE_OQ),
+					_mm512_abs_ps(reconstruction), max_finite, _CMP_GT_OQ);
+				const __m512 difference = _mm512_maskz_mov_ps(static_cast<__mmask16>(~is_overflow),
+					_mm512_abs_ps(_mm512_sub_ps(x, reconstruction)));
+
+				max_absolute_error = _mm512_max_ps(difference, max_absolute_error);
+				max_relative_error = _mm512_max_ps(_mm512_div_ps(difference, magnitude), max_relative_error);
+				number_of_overflows = _mm512_mask_add_epi32(number_of_overflows, is_overflow, number_of_overflows,
+					_mm512_set1_epi32(1));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void convert_and_measure(const float* const src, bfloat16_t* const dst,
+				const std::size_t n, const float scale, quantization_error& error)
+			{
+				const __m512 scale_vector = _mm512_set1_ps(scale);
+				const __m512 inverse_scale = _mm512_set1_ps(1.0f / scale);
+				__m512 max_absolute_error = _mm512_setzero_ps();
+				__m512 max_relative_error = _mm512_setzero_ps();
+				__m512i number_of_overflows = _mm512_setzero_si512();
+				std::size_t i{};
+
+				for (; i + 16 <= n; i += 16)
+				{
+					const __m512 x = _mm512_loadu_ps(src + i);
+					const __m512i bits = convert_to_bits_of_bfloat16(_mm512_mul_ps(x, inverse_scale));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi32_epi16(bits));
+
+					measure(x, _mm512_mul_ps(_mm512_castsi512_ps(_mm512_slli_epi32(bits, 16)), scale_vector),
+						max_absolute_error, max_relative_error, number_of_overflows);
+				}
+				const quantization_error vector_error{ _mm512_reduce_max_ps(max_absolute_error),
+					_mm512_reduce_max_ps(max_relative_error),
+					static_cast<std::uint32_t>(_mm512_reduce_add_epi32(number_of_overflows)) };
+				add_quantization_error(error, vector_error);
+				scalar::convert_and_measure(src + i, dst + i, n - i, scale, error);
+			}
+		}
+#endif
+
+		struct quantization_kernels
+		{
+			float (*get_max_finite_magnitude)(const float*, std::size_t);
+			void (*convert_and_measure)(const float*, bfloat16_t*, std::size_t, float, quantization_error&);
+		};
+
+		// NEON uses the scalar kernels.
+		inline quantization_kernels get_quantization_kernels()
+		{
+			switch (get_simd_kernel())
+			{
+#ifdef BIOVAULT_BFLOAT16_SSE2
+			case simd_kernel::sse2:
+				return { sse2::get_max_finite_magnitude, sse2::convert_and_measure };
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+				return { avx2::get_max_finite_magnitude, avx2::convert_and_measure };
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			case simd_kernel::avx512_bf16:
+				return { avx512::get_max_finite_magnitude, avx512::convert_and_measure };
+#endif
+			default:
+				return { scalar::get_max_finite_magnitude, scalar::convert_and_measure };
+			}
+		}
+	}
+
+
+	// Returns the number of blocks of block_size consecutive elements (the last block
+	// may be smaller) of an array of n elements. block_size must be greater than zero.
+	inline std::size_t get_number_of_blocks(const std::size_t n, const std::size_t block_size)
+	{
+		return (n + block_size - 1) / block_size;
+	}
+
+
+	// Converts n floats from src to bfloat16, just like convert(src, dst, n), and stores
+	// the error of each block into errors, which must have
+	// get_number_of_blocks(n, block_size) elements.
+	inline void convert_with_error(const float* const src, bfloat16_t* const dst, const std::size_t n,
+		const std::size_t block_size, quantization_error* const errors)
+	{
+		const auto convert_and_measure = detail::get_quantization_kernels().convert_and_measure;
+
+		for (std::size_t i{}; i < n; i += block_size)
+		{
+			auto& error = errors[i / block_size];
+			error = quantization_error{};
+			convert_and_measure(src + i, dst + i, std::min(block_size, n - i), 1.0f, error);
+		}
+		BIOVAULT_BFLOAT16_COUNT_CONVERSIONS(src, dst, n);
+	}
+
+
+	// Like convert_with_error, but first divides each block by a power of two, chosen
+	// so that its largest finite magnitude becomes about one (when it is less than
+	// one; otherwise the power of two is one), and stores this power of two into
+	// scales (which has the same number of elements as errors). The errors are those
+	// of the reconstructed values, dst[i] * scales[i / block_size]. The instrumentation
+	// counts the conversions of the scaled floats, src[i] / scales[i / block_size].
+	inline void convert_scaled(const float* const src, bfloat16_t* const dst, float* const scales, const std::size_t n,
+		const std::size_t block_size, quantization_error* const errors)
+	{
+		const auto kernels = detail::get_quantization_kernels();
+
+		for (std::size_t i{}; i < n; i += block_size)
+		{
+			const auto size = std::min(block_size, n - i);
+			const auto block_index = i / block_size;
+			const auto scale = detail::get_power_of_two_scale(kernels.get_max_finite_magnitude(src + i, size));
+			auto& error = errors[block_index];
+
+			scales[block_index] = scale;
+			error = quantization_error{};
+			kernels.convert_and_measure(src + i, dst + i, size, scale, error);
+#ifdef BIOVAULT_BFLOAT16_INSTRUMENTATION
+			detail::count_scaled_conversions(src + i, dst + i, size, scale);
+#endif
+		}
+	}
+
+
+	// Reconstructs n floats from bfloat16 values that are converted by convert_scaled,
+	// with the same block_size.
+	inline void convert_scaled(const bfloat16_t* const src, const float* const scales, float* const dst,
+		const std::size_t n, const std::size_t block_size)
+	{
+		convert(src, dst, n);
+
+		for (std::size_t i{}; i < n; i += block_size)
+		{
+			const auto scale = scales[i / block_size];
+			const auto end = std::min(i + block_size, n);
+
+			for (auto j = i; j < end; ++j)
+			{
+				dst[j] *= scale;
+			}
+		}
+	}
+
+
+	// Returns the error of the entire array, from the errors of its blocks: the
+	// maximum of their maximum errors, and the sum of their overflow counts.
+	inline quantization_error get_total_error(const quantization_error* const errors, const std::size_t number_of_blocks)
+	{
+		quantization_error result{};
+
+		for (std::size_t i{}; i < number_of_blocks; ++i)
+		{
+			detail::add_quantization_error(result, errors[i]);
+		}
+		return result;
+	}
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_quantize.h"
+#include "biovault_bfloat16_quantize.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cfloat> // For FLT_MAX and FLT_MIN.
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::quantization_error;
+using biovault::simd_kernel;
+
+
+namespace
+{
+	std::vector<float> make_random_floats(const std::size_t n)
+	{
+		std::mt19937 engine;
+		std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+		std::vector<float> result(n);
+
+		for (auto& element : result)
+		{
+			element = distribution(engine);
+		}
+		return result;
+	}
+
+
+	void expect_equal_errors(const quantization_error& actual, const quantization_error& expected)
+	{
+		EXPECT_EQ(actual.max_absolute_error, expected.max_absolute_error);
+		EXPECT_EQ(actual.max_relative_error, expected.max_relative_error);
+		EXPECT_EQ(actual.number_of_overflows, expected.number_of_overflows);
+	}
+}
+
+
+GTEST_TEST(bfloat16_quantize, ConvertWithErrorMeasuresEachBlock)
+{
+	const float inf{ std::numeric_limits<float>::infinity() };
+	const float nan{ std::numeric_limits<float>::quiet_NaN() };
+	const float src[] = {
+		// First block: the largest error is that of 1 + 2^-9, rounded to 1.
+		1.0f + std::ldexp(1.0f, -9), 2.0f, -0.0f, 0.5f,
+		// Second block: FLT_MAX overflows, while infinity and NaN do not contribute.
+		FLT_MAX, inf, nan, -3.0f,
+		// Third block (smaller): a denormal, flushed to zero.
+		FLT_MIN / 2 };
+
+	const auto n = sizeof(src) / sizeof(src[0]);
+	ASSERT_EQ(biovault::get_number_of_blocks(n, 4), 3U);
+
+	bfloat16_t dst[n];
+	quantization_error errors[3];
+	biovault::convert_with_error(src, dst, n, 4, errors);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		EXPECT_EQ(get_raw_bits(dst[i]), get_raw_bits(bfloat16_t(src[i])));
+	}
+	expect_equal_errors(errors[0], { std::ldexp(1.0f, -9), std::ldexp(1.0f, -9) / (1.0f + std::ldexp(1.0f, -9)), 0 });
+	expect_equal_errors(errors[1], { 0.0f, 0.0f, 1 });
+	expect_equal_errors(errors[2], { FLT_MIN / 2, 1.0f, 0 });
+
+	const auto total = biovault::get_total_error(errors, 3);
+	expect_equal_errors(total, { std::ldexp(1.0f, -9), 1.0f, 1 });
+}
+
+
+GTEST_TEST(bfloat16_quantize, EachKernelYieldsTheSameResultsAsScalar)
+{
+	auto src = make_random_floats(1000);
+	src[10] = FLT_MAX;
+	src[500] = -FLT_MAX;
+	src[501] = std::numeric_limits<float>::quiet_NaN();
+	src[502] = std::numeric_limits<float>::infinity();
+	src[999] = FLT_MIN / 4;
+
+	constexpr std::size_t block_size{ 96 };
+	const auto number_of_blocks = biovault::get_number_of_blocks(src.size(), block_size);
+
+	const biovault::test::simd_kernel_restorer restorer;
+	ASSERT_TRUE(biovault::set_simd_kernel(simd_kernel::scalar));
+
+	std::vector<bfloat16_t> expected_dst(src.size());
+	std::vector<quantization_error> expected_errors(number_of_blocks);
+	std::vector<bfloat16_t> expected_scaled_dst(src.size());
+	std::vector<float> expected_scales(number_of_blocks);
+	std::vector<quantization_error> expected_scaled_errors(number_of_blocks);
+
+	biovault::convert_with_error(src.data(), expected_dst.data(), src.size(), block_size, expected_errors.data());
+	biovault::convert_scaled(src.data(), expected_scaled_dst.data(), expected_scales.data(), src.size(), block_size,
+		expected_scaled_errors.data());
+
+	biovault::test::for_each_supported_simd_kernel([&]
+		{
+			std::vector<bfloat16_t> dst(src.size());
+			std::vector<quantization_error> errors(number_of_blocks);
+			std::vector<float> scales(number_of_blocks);
+
+			biovault::convert_with_error(src.data(), dst.data(), src.size(), block_size, errors.data());
+
+			for (std::size_t i{}; i < src.size(); ++i)
+			{
+				ASSERT_EQ(get_raw_bits(dst[i]), get_raw_bits(expected_dst[i]));
+			}
+			for (std::size_t i{}; i < number_of_blocks; ++i)
+			{
+				expect_equal_errors(errors[i], expected_errors[i]);
+			}
+
+			biovault::convert_scaled(src.data(), dst.data(), scales.data(), src.size(), block_size, errors.data());
+
+			for (std::size_t i{}; i < src.size(); ++i)
+			{
+				ASSERT_EQ(get_raw_bits(dst[i]), get_raw_bits(expected_scaled_dst[i]));
+			}
+			for (std::size_t i{}; i < number_of_blocks; ++i)
+			{
+				EXPECT_EQ(scales[i], expected_scales[i]);
+				expect_equal_errors(errors[i], expected_scaled_errors[i]);
+			}
+		});
+
+	EXPECT_EQ(biovault::get_total_error(expected_errors.data(), number_of_blocks).number_of_overflows, 2U);
+	// Scaling by a power of two does not prevent overflow.
+	EXPECT_EQ(biovault::get_total_error(expected_scaled_errors.data(), number_of_blocks).number_of_overflows, 2U);
+}
+
+
+GTEST_TEST(bfloat16_quantize, ScalingExtendsTheRange)
+{
+	// A block of tiny values (which would be flushed to zero without scaling), and a
+	// block of huge values (which is not scaled down).
+	std::vector<float> src(64);
+
+	for (std::size_t i{}; i < 32; ++i)
+	{
+		src[i] = FLT_MIN * static_cast<float>(i + 1) / 64;
+		src[i + 32] = 3e38f - static_cast<float>(i) * 1e36f;
+	}
+	std::vector<bfloat16_t> dst(src.size());
+	std::vector<float> scales(2);
+	std::vector<quantization_error> errors(2);
+
+	biovault::convert_scaled(src.data(), dst.data(), scales.data(), src.size(), 32, errors.data());
+
+	EXPECT_EQ(scales[0], std::ldexp(1.0f, -126));
+	EXPECT_EQ(scales[1], 1.0f);
+	EXPECT_EQ(errors[0].number_of_overflows, 0U);
+	EXPECT_EQ(errors[1].number_of_overflows, 0U);
+
+	std::vector<float> reconstruction(src.size());
+	biovault::convert_scaled(dst.data(), scales.data(), reconstruction.data(), src.size(), 32);
+
+	for (std::size_t i{}; i < src.size(); ++i)
+	{
+		const auto error = std::fabs(reconstruction[i] - src[i]);
+
+		// Within half a unit in the last place of bfloat16.
+		EXPECT_LE(error, std::fabs(src[i]) * std::ldexp(1.0f, -8));
+		EXPECT_LE(error, i < 32 ? errors[0].max_absolute_error : errors[1].max_absolute_error);
+	}
+	EXPECT_LE(errors[0].max_relative_error, std::ldexp(1.0f, -8));
+	EXPECT_LE(errors[1].max_relative_error, std::ldexp(1.0f, -8));
+}
+
+
+GTEST_TEST(bfloat16_quantize, ScalingIsNeverWorseThanConvertWithError)
+{
+	// Blocks whose magnitudes range from far above one to far below it. Scaling
+	// such a block down would flush its smallest elements to zero.
+	const float src[] = {
+		std::ldexp(1.0f, 100), std::ldexp(1.0f, -50), 3.0f, -std::ldexp(1.0f, -120),
+		FLT_MAX, FLT_MIN, -1.5f, std::ldexp(1.0f, -100),
+		0.75f, std::ldexp(1.0f, -126), -0.0f, 1e-30f };
+
+	constexpr std::size_t n{ sizeof(src) / sizeof(src[0]) };
+	constexpr std::size_t block_size{ 4 };
+	constexpr std::size_t number_of_blocks{ n / block_size };
+
+	bfloat16_t dst[n];
+	quantization_error errors[number_of_blocks];
+	biovault::convert_with_error(src, dst, n, block_size, errors);
+
+	bfloat16_t scaled_dst[n];
+	float scales[number_of_blocks];
+	quantization_error scaled_errors[number_of_blocks];
+	biovault::convert_scaled(src, scaled_dst, scales, n, block_size, scaled_errors);
+
+	for (std::size_t i{}; i < number_of_blocks; ++i)
+	{
+		EXPECT_LE(scales[i], 1.0f);
+		EXPECT_LE(scaled_errors[i].max_absolute_error, errors[i].max_absolute_error);
+		EXPECT_LE(scaled_errors[i].max_relative_error, errors[i].max_relative_error);
+		EXPECT_LE(scaled_errors[i].number_of_overflows, errors[i].number_of_overflows);
+	}
+
+	float reconstruction[n];
+	biovault::convert_scaled(scaled_dst, scales, reconstruction, n, block_size);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		EXPECT_LE(std::fabs(reconstruction[i] - src[i]), std::fabs(float{ dst[i] } - src[i]));
+	}
+
+	// In particular, 2^-50 is exactly representable, and must not be flushed to zero.
+	EXPECT_EQ(reconstruction[1], std::ldexp(1.0f, -50));
+	EXPECT_EQ(scaled_errors[0].max_relative_error, 0.0f);
+}
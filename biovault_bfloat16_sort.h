@@ -0,0 +1,327 @@
+#ifndef BIOVAULT_BFLOAT16_SORT_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_SORT_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Sorting and selection of bfloat16 values, by radix sort on their raw bits, rather
+// than by comparison. The element order is the totalOrder predicate of IEEE 754:
+// -NaN < -infinity < ... < -0 < +0 < ... < +infinity < +NaN. For non-NaN values,
+// this order is consistent with operator<, except that -0 precedes +0.
+
+#include "biovault_bfloat16.h"
+
+#include <algorithm> // For sort and stable_sort.
+#include <array>
+#include <cstddef>   // For size_t.
+#include <cstdint>
+#include <utility>   // For swap.
+#include <vector>
+
+namespace biovault {
+
+	// Selection policies for top_k.
+	struct select_largest_t {};
+	struct select_smallest_t {};
+
+	const select_largest_t select_largest{};
+	const select_smallest_t select_smallest{};
+
+
+	namespace detail {
+
+		// Below this number of elements, comparison sorting is faster than radix sorting.
+		constexpr std::size_t minimum_radix_sort_size{ 64 };
+
+		// Above this number of elements, a single histogram of all 65536 possible values
+		// (a counting sort) is faster than two radix passes.
+		constexpr std::size_t minimum_counting_sort_size{ std::size_t{ 1 } << 16 };
+
+		// Returns the key by which the specified value is sorted.
+		inline std::uint16_t get_sort_key(const bfloat16_t value)
+		{
+			return get_ordered_bits(get_raw_bits(value));
+		}
+
+		// The inverse of get_sort_key.
+		inline bfloat16_t get_value_from_sort_key(const std::uint16_t key)
+		{
+			return bfloat16_t(get_bits_from_ordered_bits(key), true);
+		}
+
+		using radix_histogram = std::array<std::size_t, 256>;
+
+		// Replaces the count of each bucket by the number of elements in the preceding
+		// buckets. Returns whether all elements are in the same bucket, in which case a
+		// radix pass would not change anything.
+		inline bool convert_to_offsets(radix_histogram& histogram, const std::size_t n)
+		{
+			std::size_t offset{};
+
+			for (auto& count : histogram)
+			{
+				if (count == n)
+				{
+					return true;
+				}
+				const auto next_offset = offset + count;
+				count = offset;
+				offset = next_offset;
+			}
+			return false;
+		}
+
+		// Sorts the keys (along with their indices, unless indices is null) by two stable
+		// passes: first by their lower byte, then by their upper byte. The buffers must
+		// be as large as the keys. Returns true when the result is in the buffers, false
+		// when it is in keys and indices. (A pass is skipped when it would not move any
+		// element.)
+		inline bool radix_sort(std::uint16_t* keys, std::size_t* indices, const std::size_t n,
+			std::uint16_t* key_buffer, std::size_t* index_buffer)
+		{
+			radix_histogram histograms[2]{};
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				++histograms[0][keys[i] & 0xFFU];
+				++histograms[1][keys[i] >> 8];
+			}
+			bool is_in_buffer{ false };
+
+			for (unsigned pass{}; pass < 2; ++pass)
+			{
+				auto& offsets = histograms[pass];
+
+				if (convert_to_offsets(offsets, n))
+				{
+					continue;
+				}
+				const unsigned shift{ pass * 8 };
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto destination = offsets[(keys[i] >> shift) & 0xFFU]++;
+					key_buffer[destination] = keys[i];
+
+					if (indices != nullptr)
+					{
+						index_buffer[destination] = indices[i];
+					}
+				}
+				std::swap(keys, key_buffer);
+				std::swap(indices, index_buffer);
+				is_in_buffer = !is_in_buffer;
+			}
+			return is_in_buffer;
+		}
+
+
+		// Selects the k elements with the largest keys, where the key of an element is
+		// its sort key XOR key_mask. Finds the k-th largest key by two histograms of
+		// 256 buckets (one for each byte of the keys), so it needs at most three passes
+		// over the input, plus sorting the k selected elements.
+		inline std::size_t top_k(const bfloat16_t* const src, const std::size_t n, std::size_t k,
+			std::size_t* const indices, const std::uint16_t key_mask)
+		{
+			k = std::min(k, n);
+
+			if (k == 0)
+			{
+				return 0;
+			}
+			const auto get_key = [src, key_mask](const std::size_t i)
+			{
+				return static_cast<std::uint16_t>(get_sort_key(src[i]) ^ key_mask);
+			};
+
+			radix_histogram histogram{};
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				++histogram[get_key(i) >> 8];
+			}
+
+			// The upper byte of the k-th largest key.
+			std::size_t number_of_larger_keys{};
+			unsigned upper_byte{ 255 };
+
+			while (number_of_larger_keys + histogram[upper_byte] < k)
+			{
+				number_of_larger_keys += histogram[upper_byte];
+				--upper_byte;
+			}
+
+			histogram.fill(0);
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				const auto key = get_key(i);
+
+				if ((key >> 8) == upper_byte)
+				{
+					++histogram[key & 0xFFU];
+				}
+			}
+
+			// The lower byte of the k-th largest key.
+			unsigned lower_byte{ 255 };
+
+			while (number_of_larger_keys + histogram[lower_byte] < k)
+			{
+				number_of_larger_keys += histogram[lower_byte];
+				--lower_byte;
+			}
+			const auto threshold = static_cast<std::uint16_t>((upper_byte << 8) | lower_byte);
+
+			// Select the elements whose keys exceed the threshold, and (in the order of
+			// their indices) as many as needed of those whose keys equal the threshold.
+			auto number_of_equal_keys = k - number_of_larger_keys;
+			std::vector<std::pair<std::uint16_t, std::size_t>> selection;
+			selection.reserve(k);
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				const auto key = get_key(i);
+
+				if (key > threshold)
+				{
+					selection.emplace_back(key, i);
+				}
+				else if ((key == threshold) && (number_of_equal_keys > 0))
+				{
+					selection.emplace_back(key, i);
+					--number_of_equal_keys;
+				}
+			}
+
+			std::sort(selection.begin(), selection.end(),
+				[](const std::pair<std::uint16_t, std::size_t>& a, const std::pair<std::uint16_t, std::size_t>& b)
+				{
+					return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+				});
+
+			for (std::size_t i{}; i < k; ++i)
+			{
+				indices[i] = selection[i].second;
+			}
+			return k;
+		}
+	}
+
+
+	// Sorts the n elements of data in ascending totalOrder (see above).
+	inline void sort(bfloat16_t* const data, const std::size_t n)
+	{
+		if (n < detail::minimum_radix_sort_size)
+		{
+			std::sort(data, data + n, [](const bfloat16_t a, const bfloat16_t b)
+				{
+					return detail::get_sort_key(a) < detail::get_sort_key(b);
+				});
+			return;
+		}
+
+		if (n >= detail::minimum_counting_sort_size)
+		{
+			// As the raw bits entirely determine a value, sorting amounts to counting.
+			std::vector<std::size_t> counts(std::size_t{ 1 } << 16);
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				++counts[detail::get_sort_key(data[i])];
+			}
+
+			auto* destination = data;
+
+			for (std::size_t key{}; key < counts.size(); ++key)
+			{
+				destination = std::fill_n(destination, counts[key],
+					detail::get_value_from_sort_key(static_cast<std::uint16_t>(key)));
+			}
+			return;
+		}
+
+		std::vector<std::uint16_t> keys(n);
+		std::vector<std::uint16_t> key_buffer(n);
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			keys[i] = detail::get_sort_key(data[i]);
+		}
+		const auto& sorted_keys = detail::radix_sort(keys.data(), nullptr, n, key_buffer.data(), nullptr) ? key_buffer : keys;
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			data[i] = detail::get_value_from_sort_key(sorted_keys[i]);
+		}
+	}
+
+
+	// Stores the indices of the n elements of src into indices, in the ascending
+	// totalOrder of the elements. Stable: equal elements keep their relative order.
+	inline void argsort(const bfloat16_t* const src, const std::size_t n, std::size_t* const indices)
+	{
+		for (std::size_t i{}; i < n; ++i)
+		{
+			indices[i] = i;
+		}
+
+		if (n < detail::minimum_radix_sort_size)
+		{
+			std::stable_sort(indices, indices + n, [src](const std::size_t a, const std::size_t b)
+				{
+					return detail::get_sort_key(src[a]) < detail::get_sort_key(src[b]);
+				});
+			return;
+		}
+
+		std::vector<std::uint16_t> keys(n);
+		std::vector<std::uint16_t> key_buffer(n);
+		std::vector<std::size_t> index_buffer(n);
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			keys[i] = detail::get_sort_key(src[i]);
+		}
+		if (detail::radix_sort(keys.data(), indices, n, key_buffer.data(), index_buffer.data()))
+		{
+			std::copy(index_buffer.begin(), index_buffer.end(), indices);
+		}
+	}
+
+
+	// Stores the indices of the min(k, n) largest elements of src into indices, from
+	// the largest to the smallest (in totalOrder), and returns their number. Of equal
+	// elements, those with the lowest indices are selected and stored first.
+	inline std::size_t top_k(const bfloat16_t* const src, const std::size_t n, const std::size_t k,
+		std::size_t* const indices, select_largest_t = select_largest)
+	{
+		return detail::top_k(src, n, k, indices, 0);
+	}
+
+
+	// Like the select_largest version, but selects the smallest elements, from the
+	// smallest to the largest. For example, the k nearest neighbors from an array of
+	// distances.
+	inline std::size_t top_k(const bfloat16_t* const src, const std::size_t n, const std::size_t k,
+		std::size_t* const indices, select_smallest_t)
+	{
+		return detail::top_k(src, n, k, indices, 0xFFFF);
+	}
+
+}
+
+#endif
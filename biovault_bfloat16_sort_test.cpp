@@ -0,0 +1,156 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_sort.h"
+#include "biovault_bfloat16_sort.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <algorithm> // For stable_sort.
+#include <cmath>     // For isnan.
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using biovault::bfloat16_t;
+
+
+namespace
+{
+	// Random values, including NaN and both zeros, and many duplicates.
+	std::vector<bfloat16_t> make_random_values(const std::size_t n, const unsigned seed)
+	{
+		std::mt19937 engine{ seed };
+		std::uniform_int_distribution<unsigned> distribution{ 0, 0xFFFF };
+		std::vector<bfloat16_t> result(n);
+
+		for (auto& element : result)
+		{
+			const auto bits = distribution(engine);
+
+			// Half of the elements from a small set of values, to have ties.
+			element = bfloat16_t(static_cast<std::uint16_t>(((bits & 1) == 0) ? (bits & 0x8003) : bits), true);
+		}
+		return result;
+	}
+
+
+	// Sorts the indices by the totalOrder of IEEE 754, implemented by comparison.
+	std::vector<std::size_t> argsort_by_total_order(const std::vector<bfloat16_t>& values, const bool is_descending = false)
+	{
+		const auto get_key = [](const bfloat16_t value)
+		{
+			const auto bits = get_raw_bits(value);
+			return ((bits & 0x8000) == 0) ? (bits + 0x8000) : (0xFFFF - bits);
+		};
+
+		std::vector<std::size_t> result(values.size());
+
+		for (std::size_t i{}; i < values.size(); ++i)
+		{
+			result[i] = i;
+		}
+		std::stable_sort(result.begin(), result.end(), [&values, get_key, is_descending](const std::size_t a, const std::size_t b)
+			{
+				return is_descending ? (get_key(values[a]) > get_key(values[b])) : (get_key(values[a]) < get_key(values[b]));
+			});
+		return result;
+	}
+
+
+	const std::size_t sizes[] = { 0, 1, 2, 63, 64, 1000, 65535, 65536, 100000 };
+}
+
+
+GTEST_TEST(bfloat16_sort, SortEqualsComparisonSortByTotalOrder)
+{
+	for (const auto n : sizes)
+	{
+		auto values = make_random_values(n, static_cast<unsigned>(n));
+		const auto expected_indices = argsort_by_total_order(values);
+		const auto original_values = values;
+
+		biovault::sort(values.data(), n);
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			ASSERT_EQ(get_raw_bits(values[i]), get_raw_bits(original_values[expected_indices[i]])) << " n = " << n;
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_sort, SortedNonNanValuesAreNonDecreasing)
+{
+	auto values = make_random_values(5000, 42);
+	values.erase(std::remove_if(values.begin(), values.end(), [](const bfloat16_t value)
+		{
+			return std::isnan(float{ value });
+		}), values.end());
+	values.push_back(bfloat16_t{ 0.0f });
+	values.push_back(bfloat16_t{ -0.0f });
+
+	biovault::sort(values.data(), values.size());
+
+	for (std::size_t i{ 1 }; i < values.size(); ++i)
+	{
+		ASSERT_LE(values[i - 1], values[i]);
+	}
+	const auto zero = std::find(values.begin(), values.end(), bfloat16_t{ 0.0f });
+	ASSERT_NE(zero, values.end());
+	EXPECT_EQ(get_raw_bits(*zero), 0x8000U);
+}
+
+
+GTEST_TEST(bfloat16_sort, ArgsortIsStable)
+{
+	for (const auto n : sizes)
+	{
+		const auto values = make_random_values(n, static_cast<unsigned>(n) + 1);
+		std::vector<std::size_t> indices(n);
+
+		biovault::argsort(values.data(), n, indices.data());
+		ASSERT_EQ(indices, argsort_by_total_order(values)) << " n = " << n;
+	}
+}
+
+
+GTEST_TEST(bfloat16_sort, TopKEqualsPrefixOfStableArgsort)
+{
+	for (const auto n : sizes)
+	{
+		const auto values = make_random_values(n, static_cast<unsigned>(n) + 2);
+		const auto descending_indices = argsort_by_total_order(values, true);
+		const auto ascending_indices = argsort_by_total_order(values);
+
+		for (const std::size_t k : { std::size_t{}, std::size_t{ 1 }, std::size_t{ 10 }, n / 2, n, n + 1 })
+		{
+			std::vector<std::size_t> indices(k);
+			const auto expected_size = std::min(k, n);
+
+			ASSERT_EQ(biovault::top_k(values.data(), n, k, indices.data()), expected_size);
+			ASSERT_TRUE(std::equal(indices.begin(), indices.begin() + expected_size, descending_indices.begin()))
+				<< " n = " << n << ", k = " << k;
+
+			ASSERT_EQ(biovault::top_k(values.data(), n, k, indices.data(), biovault::select_smallest), expected_size);
+			ASSERT_TRUE(std::equal(indices.begin(), indices.begin() + expected_size, ascending_indices.begin()))
+				<< " n = " << n << ", k = " << k;
+		}
+	}
+}
@@ -0,0 +1,486 @@
+#ifndef BIOVAULT_BFLOAT16_STATISTICS_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_STATISTICS_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Data quality statistics of bfloat16 arrays: the minimum, the maximum, the number
+// of NaNs, and optionally an exact histogram of 65536 bins, one for each raw bits
+// value. All are computed in a single pass, directly on the raw bits, without
+// converting the elements to float. The minimum and maximum are found by integer
+// comparison of the bits after a sign-flip transform (as by detail::get_ordered_bits),
+// so -0 is considered less than +0.
+
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_parallel.h"
+
+#include <algorithm> // For fill_n, max and min.
+#include <cstddef>   // For size_t.
+#include <cstdint>
+#include <vector>
+
+namespace biovault {
+
+	// The number of bins of a histogram of bfloat16 values.
+	constexpr std::size_t histogram_size{ std::size_t{ 1 } << 16 };
+
+	struct bfloat16_statistics
+	{
+		// The smallest and the largest of the elements that are not NaN, or NaN when
+		// there are no such elements.
+		bfloat16_t min;
+		bfloat16_t max;
+
+		std::size_t number_of_nans;
+	};
+
+
+	namespace detail {
+
+		// Partial statistics, with the minimum and maximum as ordered bits.
+		struct statistics_accumulator
+		{
+			std::uint64_t number_of_nans{};
+			std::uint16_t min_ordered_bits{ 0xFFFF };
+			std::uint16_t max_ordered_bits{ 0 };
+		};
+
+		inline void merge_statistics(statistics_accumulator& accumulator, const statistics_accumulator& other)
+		{
+			accumulator.number_of_nans += other.number_of_nans;
+			accumulator.min_ordered_bits = std::min(accumulator.min_ordered_bits, other.min_ordered_bits);
+			accumulator.max_ordered_bits = std::max(accumulator.max_ordered_bits, other.max_ordered_bits);
+		}
+
+		inline bfloat16_statistics get_statistics(const statistics_accumulator& accumulator)
+		{
+			return bfloat16_statistics{
+				bfloat16_t(get_bits_from_ordered_bits(accumulator.min_ordered_bits), true),
+				bfloat16_t(get_bits_from_ordered_bits(accumulator.max_ordered_bits), true),
+				static_cast<std::size_t>(accumulator.number_of_nans) };
+		}
+
+		// The SIMD kernels count the NaNs of each lane in 16 bits, so they add those
+		// counts to the total after at most this number of iterations.
+		constexpr std::size_t max_iterations_per_nan_count{ 0xFFFF };
+
+		// The SIMD kernels compare the ordered bits XOR 0x8000 as signed integers. The
+		// lanes of NaN elements are replaced by the largest signed value (for the
+		// minimum), and by the smallest (for the maximum).
+
+		namespace scalar {
+
+			inline void accumulate_statistics(const bfloat16_t* const src, const std::size_t n,
+				statistics_accumulator& accumulator)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto bits = get_raw_bits(src[i]);
+
+					if (is_nan_bits(bits))
+					{
+						++accumulator.number_of_nans;
+					}
+					else
+					{
+						const auto ordered_bits = get_ordered_bits(bits);
+						accumulator.min_ordered_bits = std::min(accumulator.min_ordered_bits, ordered_bits);
+						accumulator.max_ordered_bits = std::max(accumulator.max_ordered_bits, ordered_bits);
+					}
+				}
+			}
+		}
+
+#ifdef BIOVAULT_BFLOAT16_SSE2
+		namespace sse2 {
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline std::uint64_t reduce_add_epu16(const __m128i counts)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i sums = _mm_add_epi32(_mm_unpacklo_epi16(counts, zero), _mm_unpackhi_epi16(counts, zero));
+				alignas(16) std::uint32_t lanes[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes), sums);
+				return std::uint64_t{ lanes[0] } + lanes[1] + lanes[2] + lanes[3];
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline void accumulate_statistics(const bfloat16_t* const src,
+				const std::size_t n, statistics_accumulator& accumulator)
+			{
+				const __m128i magnitude_mask = _mm_set1_epi16(0x7FFF);
+				const __m128i sign_mask = _mm_set1_epi16(static_cast<short>(0x8000));
+				const __m128i infinity = _mm_set1_epi16(0x7F80);
+				__m128i min_keys = magnitude_mask;
+				__m128i max_keys = sign_mask;
+				std::size_t i{};
+
+				while (i + 8 <= n)
+				{
+					__m128i nan_counts = _mm_setzero_si128();
+					const auto end = i + std::min((n - i) / 8, max_iterations_per_nan_count) * 8;
+
+					for (; i < end; i += 8)
+					{
+						const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+						const __m128i is_nan = _mm_cmpgt_epi16(_mm_and_si128(bits, magnitude_mask), infinity);
+						const __m128i keys = _mm_xor_si128(bits, _mm_and_si128(_mm_srai_epi16(bits, 15), magnitude_mask));
+						const __m128i non_nan_keys = _mm_andnot_si128(is_nan, keys);
+						min_keys = _mm_min_epi16(min_keys, _mm_or_si128(non_nan_keys, _mm_and_si128(is_nan, magnitude_mask)));
+						max_keys = _mm_max_epi16(max_keys, _mm_or_si128(non_nan_keys, _mm_and_si128(is_nan, sign_mask)));
+						nan_counts = _mm_sub_epi16(nan_counts, is_nan);
+					}
+					accumulator.number_of_nans += reduce_add_epu16(nan_counts);
+				}
+
+				alignas(16) std::int16_t min_lanes[8];
+				alignas(16) std::int16_t max_lanes[8];
+				_mm_store_si128(reinterpret_cast<__m128i*>(min_lanes), min_keys);
+				_mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), max_keys);
+
+				for (unsigned lane{}; lane < 8; ++lane)
+				{
+					const auto min_ordered_bits = static_cast<std::uint16_t>(min_lanes[lane] ^ 0x8000);
+					const auto max_ordered_bits = static_cast<std::uint16_t>(max_lanes[lane] ^ 0x8000);
+					accumulator.min_ordered_bits = std::min(accumulator.min_ordered_bits, min_ordered_bits);
+					accumulator.max_ordered_bits = std::max(accumulator.max_ordered_bits, max_ordered_bits);
+				}
+				scalar::accumulate_statistics(src + i, n - i, accumulator);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline void accumulate_statistics(const bfloat16_t* const src,
+				const std::size_t n, statistics_accumulator& accumulator)
+			{
+				const __m256i magnitude_mask = _mm256_set1_epi16(0x7FFF);
+				const __m256i sign_mask = _mm256_set1_epi16(static_cast<short>(0x8000));
+				const __m256i infinity = _mm256_set1_epi16(0x7F80);
+				__m256i min_keys = magnitude_mask;
+				__m256i max_keys = sign_mask;
+				std::size_t i{};
+
+				while (i + 16 <= n)
+				{
+					__m256i nan_counts = _mm256_setzero_si256();
+					const auto end = i + std::min((n - i) / 16, max_iterations_per_nan_count) * 16;
+
+					for (; i < end; i += 16)
+					{
+						const __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+						const __m256i is_nan = _mm256_cmpgt_epi16(_mm256_and_si256(bits, magnitude_mask), infinity);
+						const __m256i keys = _mm256_xor_si256(bits, _mm256_and_si256(_mm256_srai_epi16(bits, 15), magnitude_mask));
+						min_keys = _mm256_min_epi16(min_keys, _mm256_blendv_epi8(keys, magnitude_mask, is_nan));
+						max_keys = _mm256_max_epi16(max_keys, _mm256_blendv_epi8(keys, sign_mask, is_nan));
+						nan_counts = _mm256_sub_epi16(nan_counts, is_nan);
+					}
+					const __m256i zero = _mm256_setzero_si256();
+					const __m256i sums = _mm256_add_epi32(_mm256_unpacklo_epi16(nan_counts, zero), _mm256_unpackhi_epi16(nan_counts, zero));
+					alignas(32) std::uint32_t lanes[8];
+					_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+
+					for (const auto lane : lanes)
+					{
+						accumulator.number_of_nans += lane;
+					}
+				}
+
+				alignas(32) std::int16_t min_lanes[16];
+				alignas(32) std::int16_t max_lanes[16];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(min_lanes), min_keys);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(max_lanes), max_keys);
+
+				for (unsigned lane{}; lane < 16; ++lane)
+				{
+					const auto min_ordered_bits = static_cast<std::uint16_t>(min_lanes[lane] ^ 0x8000);
+					const auto max_ordered_bits = static_cast<std::uint16_t>(max_lanes[lane] ^ 0x8000);
+					accumulator.min_ordered_bits = std::min(accumulator.min_ordered_bits, min_ordered_bits);
+					accumulator.max_ordered_bits = std::max(accumulator.max_ordered_bits, max_ordered_bits);
+				}
+				scalar::accumulate_statistics(src + i, n - i, accumulator);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline void accumulate_statistics(const bfloat16_t* const src,
+				const std::size_t n, statistics_accumulator& accumulator)
+			{
+				const __m512i magnitude_mask = _mm512_set1_epi16(0x7FFF);
+				const __m512i infinity = _mm512_set1_epi16(0x7F80);
+				const __m512i one = _mm512_set1_epi16(1);
+				__m512i min_keys = magnitude_mask;
+				__m512i max_keys = _mm512_set1_epi16(static_cast<short>(0x8000));
+				std::size_t i{};
+
+				while (i + 32 <= n)
+				{
+					__m512i nan_counts = _mm512_setzero_si512();
+					const auto end = i + std::min((n - i) / 32, max_iterations_per_nan_count) * 32;
+
+					for (; i < end; i += 32)
+					{
+						const __m512i bits = _mm512_loadu_si512(src + i);
+						const __mmask32 is_nan = _mm512_cmpgt_epi16_mask(_mm512_and_si512(bits, magnitude_mask), infinity);
+						const __m512i keys = _mm512_xor_si512(bits, _mm512_and_si512(_mm512_srai_epi16(bits, 15), magnitude_mask));
+
+						// Only the lanes of non-NaN elements are updated.
+						min_keys = _mm512_mask_min_epi16(min_keys, static_cast<__mmask32>(~is_nan), min_keys, keys);
+						max_keys = _mm512_mask_max_epi16(max_keys, static_cast<__mmask32>(~is_nan), max_keys, keys);
+						nan_counts = _mm512_mask_add_epi16(nan_counts, is_nan, nan_counts, one);
+					}
+					const __m512i zero = _mm512_setzero_si512();
+					accumulator.number_of_nans += static_cast<std::uint32_t>(_mm512_reduce_add_epi32(
+						_mm512_add_epi32(_mm512_unpacklo_epi16(nan_counts, zero), _mm512_unpackhi_epi16(nan_counts, zero))));
+				}
+
+				alignas(64) std::int16_t min_lanes[32];
+				alignas(64) std::int16_t max_lanes[32];
+				_mm512_store_si512(min_lanes, min_keys);
+				_mm512_store_si512(max_lanes, max_keys);
+
+				for (unsigned lane{}; lane < 32; ++lane)
+				{
+					const auto min_ordered_bits = static_cast<std::uint16_t>(min_lanes[lane] ^ 0x8000);
+					const auto max_ordered_bits = static_cast<std::uint16_t>(max_lanes[lane] ^ 0x8000);
+					accumulator.min_ordered_bits = std::min(accumulator.min_ordered_bits, min_ordered_bits);
+					accumulator.max_ordered_bits = std::max(accumulator.max_ordered_bits, max_ordered_bits);
+				}
+				scalar::accumulate_statistics(src + i, n - i, accumulator);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON
+		namespace neon {
+
+			inline void accumulate_statistics(const bfloat16_t* const src, const std::size_t n,
+				statistics_accumulator& accumulator)
+			{
+				const int16x8_t magnitude_mask = vdupq_n_s16(0x7FFF);
+				const int16x8_t sign_mask = vdupq_n_s16(static_cast<std::int16_t>(0x8000));
+				const int16x8_t infinity = vdupq_n_s16(0x7F80);
+				int16x8_t min_keys = magnitude_mask;
+				int16x8_t max_keys = sign_mask;
+				std::size_t i{};
+
+				while (i + 8 <= n)
+				{
+					uint16x8_t nan_counts = vdupq_n_u16(0);
+					const auto end = i + std::min((n - i) / 8, max_iterations_per_nan_count) * 8;
+
+					for (; i < end; i += 8)
+					{
+						const int16x8_t bits = vld1q_s16(reinterpret_cast<const std::int16_t*>(src + i));
+						const uint16x8_t is_nan = vcgtq_s16(vandq_s16(bits, magnitude_mask), infinity);
+						const int16x8_t keys = veorq_s16(bits, vandq_s16(vshrq_n_s16(bits, 15), magnitude_mask));
+						min_keys = vminq_s16(min_keys, vbslq_s16(is_nan, magnitude_mask, keys));
+						max_keys = vmaxq_s16(max_keys, vbslq_s16(is_nan, sign_mask, keys));
+						nan_counts = vsubq_u16(nan_counts, is_nan);
+					}
+					accumulator.number_of_nans += vaddlvq_u16(nan_counts);
+				}
+
+				const auto min_ordered_bits = static_cast<std::uint16_t>(vminvq_s16(min_keys) ^ 0x8000);
+				const auto max_ordered_bits = static_cast<std::uint16_t>(vmaxvq_s16(max_keys) ^ 0x8000);
+				accumulator.min_ordered_bits = std::min(accumulator.min_ordered_bits, min_ordered_bits);
+				accumulator.max_ordered_bits = std::max(accumulator.max_ordered_bits, max_ordered_bits);
+				scalar::accumulate_statistics(src + i, n - i, accumulator);
+			}
+		}
+#endif
+
+		using accumulate_statistics_function = void (*)(const bfloat16_t*, std::size_t, statistics_accumulator&);
+
+		inline accumulate_statistics_function get_accumulate_statistics_kernel()
+		{
+			switch (get_simd_kernel())
+			{
+#ifdef BIOVAULT_BFLOAT16_SSE2
+			case simd_kernel::sse2:
+				return sse2::accumulate_statistics;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+				return avx2::accumulate_statistics;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			case simd_kernel::avx512_bf16:
+				return avx512::accumulate_statistics;
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON
+			case simd_kernel::neon:
+			case simd_kernel::neon_bf16:
+				return neon::accumulate_statistics;
+#endif
+			default:
+				return scalar::accumulate_statistics;
+			}
+		}
+
+
+		// The number of elements per block of the fused pass: the SIMD kernel computes
+		// the minimum, maximum and NaN count of a block, after which its elements are
+		// counted while still in the L1 cache.
+		constexpr std::size_t statistics_block_size{ 4096 };
+
+		// Adds one to the histogram bin of each element. Alternates between two
+		// histograms, to halve the chains of dependent increments of equal values.
+		template <typename Counter>
+		void count_raw_bits(const bfloat16_t* const src, const std::size_t n, Counter* const histogram0,
+			Counter* const histogram1)
+		{
+			std::size_t i{};
+
+			for (; i + 2 <= n; i += 2)
+			{
+				++histogram0[get_raw_bits(src[i])];
+				++histogram1[get_raw_bits(src[i + 1])];
+			}
+			if (i < n)
+			{
+				++histogram0[get_raw_bits(src[i])];
+			}
+		}
+	}
+
+
+	namespace detail {
+
+		// Accumulates the statistics of the n elements of src, and adds their counts
+		// to histogram, unless it is null. Large arrays are counted in two 32-bit
+		// histograms (less cache than one of 64 bits), which are added to histogram
+		// after each segment of at most 2^31 elements, so that they cannot overflow.
+		inline void accumulate_statistics(const bfloat16_t* const src, const std::size_t n,
+			statistics_accumulator& accumulator, std::uint64_t* const histogram)
+		{
+			const auto kernel = get_accumulate_statistics_kernel();
+
+			if (histogram == nullptr)
+			{
+				kernel(src, n, accumulator);
+				return;
+			}
+
+			if (n < histogram_size)
+			{
+				// Counts directly, as clearing and adding the 32-bit histograms would cost more.
+				for (std::size_t offset{}; offset < n; offset += statistics_block_size)
+				{
+					const auto count = std::min(statistics_block_size, n - offset);
+					kernel(src + offset, count, accumulator);
+					count_raw_bits(src + offset, count, histogram, histogram);
+				}
+				return;
+			}
+
+			constexpr std::size_t max_segment_size{ std::size_t{ 1 } << 31 };
+			std::vector<std::uint32_t> counts(2 * histogram_size);
+
+			for (std::size_t segment{}; segment < n; segment += max_segment_size)
+			{
+				const auto segment_end = segment + std::min(max_segment_size, n - segment);
+				std::fill_n(counts.begin(), counts.size(), 0U);
+
+				for (auto offset = segment; offset < segment_end; offset += statistics_block_size)
+				{
+					const auto count = std::min(statistics_block_size, segment_end - offset);
+					kernel(src + offset, count, accumulator);
+					count_raw_bits(src + offset, count, counts.data(), counts.data() + histogram_size);
+				}
+				for (std::size_t bin{}; bin < histogram_size; ++bin)
+				{
+					histogram[bin] += std::uint64_t{ counts[bin] } + counts[histogram_size + bin];
+				}
+			}
+		}
+	}
+
+
+	// Computes the statistics of the n elements of src, in one pass. When histogram is
+	// not null, it must point to an array of histogram_size counters, indexed by the
+	// raw bits of the elements, to which the number of elements of each raw bits value
+	// is added. (So the histogram accumulates over multiple calls.)
+	inline bfloat16_statistics compute_statistics(const bfloat16_t* const src, const std::size_t n,
+		std::uint64_t* const histogram = nullptr)
+	{
+		detail::statistics_accumulator accumulator;
+		detail::accumulate_statistics(src, n, accumulator, histogram);
+		return detail::get_statistics(accumulator);
+	}
+
+
+	// Parallel version of compute_statistics, yielding the same results. Each thread
+	// computes the statistics of its own part of src, with its own histogram, after
+	// which the threads merge the histograms, each for its own range of bins.
+	inline bfloat16_statistics parallel_compute_statistics(const bfloat16_t* const src, const std::size_t n,
+		std::uint64_t* const histogram = nullptr, thread_pool& pool = get_default_thread_pool())
+	{
+		const auto number_of_threads = static_cast<unsigned>(std::min<std::size_t>(
+			pool.get_number_of_threads(), n / detail::parallel_minimum_size_per_thread));
+
+		if (number_of_threads <= 1)
+		{
+			return compute_statistics(src, n, histogram);
+		}
+
+		// Allocated before running the jobs, as a job must not throw (std::bad_alloc).
+		std::vector<detail::statistics_accumulator> accumulators(number_of_threads);
+		std::vector<std::vector<std::uint64_t>> histograms((histogram == nullptr) ? 0 : number_of_threads,
+			std::vector<std::uint64_t>(histogram_size));
+
+		pool.run(number_of_threads, [src, n, histogram, number_of_threads, &accumulators, &histograms](const unsigned thread_index)
+			{
+				const auto begin = n * thread_index / number_of_threads;
+				const auto end = n * (thread_index + 1) / number_of_threads;
+
+				detail::accumulate_statistics(src + begin, end - begin, accumulators[thread_index],
+					(histogram == nullptr) ? nullptr : histograms[thread_index].data());
+			});
+
+		if (histogram != nullptr)
+		{
+			pool.run(number_of_threads, [histogram, number_of_threads, &histograms](const unsigned thread_index)
+				{
+					const auto begin = histogram_size * thread_index / number_of_threads;
+					const auto end = histogram_size * (thread_index + 1) / number_of_threads;
+
+					for (const auto& thread_histogram : histograms)
+					{
+						for (auto bin = begin; bin < end; ++bin)
+						{
+							histogram[bin] += thread_histogram[bin];
+						}
+					}
+				});
+		}
+
+		detail::statistics_accumulator accumulator;
+
+		for (const auto& thread_accumulator : accumulators)
+		{
+			detail::merge_statistics(accumulator, thread_accumulator);
+		}
+		return detail::get_statistics(accumulator);
+	}
+
+}
+
+#endif
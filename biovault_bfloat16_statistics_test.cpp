@@ -0,0 +1,196 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_statistics.h"
+#include "biovault_bfloat16_statistics.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cmath>   // For isnan and signbit.
+#include <cstddef> // For size_t.
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::bfloat16_statistics;
+
+
+namespace
+{
+	bfloat16_t raw_bits_to_bfloat16(const std::uint32_t bits)
+	{
+		return bfloat16_t(static_cast<std::uint16_t>(bits), true);
+	}
+
+
+	// Returns random bfloat16 values. The bits of the values are either entirely
+	// random (including many NaNs) or limited to a small range (zero, small values,
+	// and their negations), depending on the specified mask.
+	std::vector<bfloat16_t> make_bfloats(const std::size_t n, const std::uint16_t mask = 0xFFFF)
+	{
+		std::mt19937 generator;
+		std::vector<bfloat16_t> result(n);
+
+		for (auto& element : result)
+		{
+			element = raw_bits_to_bfloat16(static_cast<std::uint32_t>(generator()) & mask);
+		}
+		return result;
+	}
+
+
+	// Tells whether a precedes b, by comparison as float, with -0 preceding +0.
+	bool is_less(const bfloat16_t a, const bfloat16_t b)
+	{
+		return (a < b) || ((a == b) && std::signbit(float{ a }) && !std::signbit(float{ b }));
+	}
+
+
+	// Computes the statistics straightforwardly, by comparing the elements as float.
+	bfloat16_statistics compute_expected_statistics(const std::vector<bfloat16_t>& values)
+	{
+		const auto nan = raw_bits_to_bfloat16(0x7FC0);
+		bfloat16_statistics result{ nan, nan, 0 };
+		bool has_number{ false };
+
+		for (const auto value : values)
+		{
+			if (std::isnan(float{ value }))
+			{
+				++result.number_of_nans;
+			}
+			else
+			{
+				result.min = (has_number && !is_less(value, result.min)) ? result.min : value;
+				result.max = (has_number && !is_less(result.max, value)) ? result.max : value;
+				has_number = true;
+			}
+		}
+		return result;
+	}
+
+
+	void expect_equal_statistics(const bfloat16_statistics& actual, const bfloat16_statistics& expected)
+	{
+		EXPECT_EQ(actual.number_of_nans, expected.number_of_nans);
+
+		if (std::isnan(float{ expected.min }))
+		{
+			EXPECT_TRUE(std::isnan(float{ actual.min }));
+			EXPECT_TRUE(std::isnan(float{ actual.max }));
+		}
+		else
+		{
+			EXPECT_EQ(get_raw_bits(actual.min), get_raw_bits(expected.min));
+			EXPECT_EQ(get_raw_bits(actual.max), get_raw_bits(expected.max));
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_statistics, EachKernelComputesMinMaxAndNumberOfNans)
+{
+	const std::size_t sizes[] = { 0, 1, 7, 8, 9, 31, 32, 33, 100, 4097, 100000 };
+	const std::uint16_t masks[] = { 0xFFFF, 0x8003, 0x7FFF, 0xFFC0 };
+
+	biovault::test::for_each_supported_simd_kernel([&]
+		{
+			for (const auto n : sizes)
+			{
+				for (const auto mask : masks)
+				{
+					SCOPED_TRACE(testing::Message() << "n = " << n << ", mask = " << mask);
+					const auto values = make_bfloats(n, mask);
+					expect_equal_statistics(biovault::compute_statistics(values.data(), n), compute_expected_statistics(values));
+				}
+			}
+
+			// More NaNs than a 16-bit counter per lane can hold.
+			const std::vector<bfloat16_t> nans((std::size_t{ 1 } << 21) + 5, raw_bits_to_bfloat16(0xFFC1));
+			const auto statistics = biovault::compute_statistics(nans.data(), nans.size());
+			EXPECT_EQ(statistics.number_of_nans, nans.size());
+			EXPECT_TRUE(std::isnan(float{ statistics.min }) && std::isnan(float{ statistics.max }));
+		});
+}
+
+
+GTEST_TEST(bfloat16_statistics, MinusZeroIsLessThanPlusZero)
+{
+	const std::vector<bfloat16_t> zeros(100, raw_bits_to_bfloat16(0x0000));
+	auto values = zeros;
+	values[50] = raw_bits_to_bfloat16(0x8000);
+	values[60] = raw_bits_to_bfloat16(0x7FC0);
+
+	const auto statistics = biovault::compute_statistics(values.data(), values.size());
+	EXPECT_EQ(get_raw_bits(statistics.min), 0x8000U);
+	EXPECT_EQ(get_raw_bits(statistics.max), 0x0000U);
+	EXPECT_EQ(statistics.number_of_nans, 1U);
+}
+
+
+GTEST_TEST(bfloat16_statistics, HistogramCountsEachRawBitsValue)
+{
+	// Both below and above the size from which the histogram is counted in 32 bits.
+	for (const std::size_t n : { 1000, 300000 })
+	{
+		for (const std::uint16_t mask : { 0xFFFF, 0x8003 })
+		{
+			const auto values = make_bfloats(n, mask);
+			std::vector<std::uint64_t> expected_histogram(biovault::histogram_size, 1);
+
+			for (const auto value : values)
+			{
+				++expected_histogram[get_raw_bits(value)];
+			}
+
+			// The histogram accumulates: all counts were initialized to one.
+			std::vector<std::uint64_t> histogram(biovault::histogram_size, 1);
+			const auto statistics = biovault::compute_statistics(values.data(), n, histogram.data());
+
+			EXPECT_EQ(histogram, expected_histogram);
+			expect_equal_statistics(statistics, compute_expected_statistics(values));
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_statistics, ParallelComputationEqualsSequential)
+{
+	biovault::thread_pool pool{ 4 };
+
+	for (const std::size_t n : { std::size_t{ 1000 }, (std::size_t{ 1 } << 20) + 3 })
+	{
+		const auto values = make_bfloats(n);
+
+		std::vector<std::uint64_t> expected_histogram(biovault::histogram_size);
+		const auto expected_statistics = biovault::compute_statistics(values.data(), n, expected_histogram.data());
+
+		std::vector<std::uint64_t> histogram(biovault::histogram_size);
+		expect_equal_statistics(biovault::parallel_compute_statistics(values.data(), n, histogram.data(), pool),
+			expected_statistics);
+		EXPECT_EQ(histogram, expected_histogram);
+
+		expect_equal_statistics(biovault::parallel_compute_statistics(values.data(), n, nullptr, pool),
+			expected_statistics);
+	}
+}
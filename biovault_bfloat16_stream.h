@@ -0,0 +1,639 @@
+#ifndef BIOVAULT_BFLOAT16_STREAM_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_STREAM_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Streaming conversion of files of float values into bfloat16 tensor files (as
+// specified by biovault_bfloat16_io.h), for data sets that do not fit in memory.
+// Only two chunks of each type are kept in memory: while one chunk is converted
+// by the bulk conversion functions, the next one is read, and the previous one is
+// written. On Linux, the reads and writes are done by io_uring, when the kernel
+// supports it. Otherwise, each read and write is done by a separate thread.
+
+#include "biovault_bfloat16.h"
+#include "biovault_bfloat16_buffer.h"
+#include "biovault_bfloat16_io.h"
+
+#include <algorithm> // For min.
+#include <cerrno>
+#include <cstddef>   // For size_t.
+#include <cstdint>
+#include <cstring>   // For memcpy and memset.
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		include <fcntl.h>       // For open.
+#		include <linux/io_uring.h>
+#		include <sys/mman.h>    // For mmap.
+#		include <sys/syscall.h> // For syscall.
+#		include <sys/uio.h>     // For iovec.
+#		include <unistd.h>      // For close.
+#		if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#			define BIOVAULT_BFLOAT16_HAS_IO_URING
+#		endif
+#	endif
+#endif
+
+namespace biovault {
+
+	struct stream_conversion_options
+	{
+		// The number of elements per chunk.
+		std::size_t chunk_size{ std::size_t{ 1 } << 20 };
+
+		// The byte offset of the first float value in the input file.
+		std::uint64_t input_offset{};
+
+		// Allows using io_uring, when supported.
+		bool use_io_uring{ true };
+	};
+
+
+	namespace detail {
+
+		// Reads and writes the files by a separate thread for each request. Slots 0 and
+		// 1 are for reading, slots 2 and 3 are for writing. A slot may only be reused
+		// after waiting for its previous request.
+		class thread_file_io
+		{
+		public:
+			thread_file_io(const std::string& input_file_name, const std::string& output_file_name)
+				: input_{ input_file_name, std::ios::binary }
+			{
+				if (!input_)
+				{
+					throw std::system_error{ errno, std::generic_category(), "Failed to open \"" + input_file_name + "\"" };
+				}
+				output_.open(output_file_name, std::ios::binary | std::ios::trunc);
+
+				if (!output_)
+				{
+					throw std::system_error{ errno, std::generic_category(), "Failed to open \"" + output_file_name + "\"" };
+				}
+			}
+
+			void start_read(const unsigned slot, void* const buffer, const std::size_t size, const std::uint64_t offset)
+			{
+				futures_[slot] = std::async(std::launch::async, [this, buffer, size, offset]
+					{
+						input_.seekg(static_cast<std::streamoff>(offset));
+						input_.read(static_cast<char*>(buffer), static_cast<std::streamsize>(size));
+						const auto result = static_cast<std::size_t>(input_.gcount());
+						input_.clear();
+						return result;
+					});
+			}
+
+			void start_write(const unsigned slot, const void* const buffer, const std::size_t size, const std::uint64_t offset)
+			{
+				futures_[slot] = std::async(std::launch::async, [this, buffer, size, offset]
+					{
+						output_.seekp(static_cast<std::streamoff>(offset));
+
+						if (!output_.write(static_cast<const char*>(buffer), static_cast<std::streamsize>(size)))
+						{
+							throw std::system_error{ errno, std::generic_category(), "Failed to write bfloat16 tensor file" };
+						}
+						return size;
+					});
+			}
+
+			// Waits for the request of the specified slot, and returns the number of bytes
+			// that are transferred.
+			std::size_t wait(const unsigned slot)
+			{
+				return futures_[slot].get();
+			}
+
+			void wait_all() noexcept
+			{
+				for (auto& future : futures_)
+				{
+					if (future.valid())
+					{
+						future.wait();
+					}
+				}
+			}
+
+			void finish()
+			{
+				output_.close();
+
+				if (!output_)
+				{
+					throw std::system_error{ errno, std::generic_category(), "Failed to close bfloat16 tensor file" };
+				}
+			}
+
+		private:
+			std::ifstream input_;
+			std::ofstream output_;
+			std::future<std::size_t> futures_[4];
+		};
+
+
+#ifdef BIOVAULT_BFLOAT16_HAS_IO_URING
+
+		class file_descriptor
+		{
+		public:
+			explicit file_descriptor(const int value) noexcept
+				: value_{ value }
+			{
+			}
+
+			file_descriptor(const file_descriptor&) = delete;
+			file_descriptor& operator=(const file_descriptor&) = delete;
+
+			~file_descriptor()
+			{
+				if (value_ >= 0)
+				{
+					::close(value_);
+				}
+			}
+
+			int get() const noexcept
+			{
+				return value_;
+			}
+
+		private:
+			int value_;
+		};
+
+
+		// Reads and writes the files by io_uring, directly by system calls (so without
+		// depending on liburing). Has the same slots as thread_file_io.
+		class io_uring_file_io
+		{
+		public:
+			static bool is_supported() noexcept
+			{
+				static const bool result{ []
+					{
+						::io_uring_params parameters{};
+						const file_descriptor ring{ setup(1, parameters) };
+						return ring.get() >= 0;
+					}() };
+				return result;
+			}
+
+			io_uring_file_io(const std::string& input_file_name, const std::string& output_file_name)
+				: input_{ open_file(input_file_name, O_RDONLY) },
+				output_{ open_file(output_file_name, O_WRONLY | O_CREAT | O_TRUNC) },
+				ring_{ setup(number_of_slots, parameters_) }
+			{
+				if (ring_.get() < 0)
+				{
+					throw std::system_error{ errno, std::generic_category(), "Failed to set up io_uring" };
+				}
+				const auto& sq_offsets = parameters_.sq_off;
+				const auto& cq_offsets = parameters_.cq_off;
+
+				sq_ring_size_ = sq_offsets.array + parameters_.sq_entries * sizeof(unsigned);
+				cq_ring_size_ = cq_offsets.cqes + parameters_.cq_entries * sizeof(::io_uring_cqe);
+
+				const bool is_single_mmap{ (parameters_.features & IORING_FEAT_SINGLE_MMAP) != 0 };
+
+				if (is_single_mmap)
+				{
+					sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+				}
+				sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+				cq_ring_ = is_single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+				sqes_size_ = parameters_.sq_entries * sizeof(::io_uring_sqe);
+				sqes_ = static_cast<::io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+				if ((sq_ring_ == nullptr) || (cq_ring_ == nullptr) || (sqes_ == nullptr))
+				{
+					const int error{ errno };
+					unmap();
+					throw std::system_error{ error, std::generic_category(), "Failed to map io_uring" };
+				}
+
+				const auto sq_ring = static_cast<char*>(sq_ring_);
+				const auto cq_ring = static_cast<char*>(cq_ring_);
+				sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + sq_offsets.tail);
+				sq_mask_ = *reinterpret_cast<const unsigned*>(sq_ring + sq_offsets.ring_mask);
+				sq_array_ = reinterpret_cast<unsigned*>(sq_ring + sq_offsets.array);
+				cq_head_ = reinterpret_cast<unsigned*>(cq_ring + cq_offsets.head);
+				cq_tail_ = reinterpret_cast<const unsigned*>(cq_ring + cq_offsets.tail);
+				cq_mask_ = *reinterpret_cast<const unsigned*>(cq_ring + cq_offsets.ring_mask);
+				cqes_ = reinterpret_cast<const ::io_uring_cqe*>(cq_ring + cq_offsets.cqes);
+			}
+
+			io_uring_file_io(const io_uring_file_io&) = delete;
+			io_uring_file_io& operator=(const io_uring_file_io&) = delete;
+
+			~io_uring_file_io()
+			{
+				wait_all();
+				unmap();
+			}
+
+			void start_read(const unsigned slot, void* const buffer, const std::size_t size, const std::uint64_t offset)
+			{
+				start(slot, input_.get(), IORING_OP_READV, buffer, size, offset);
+			}
+
+			void start_write(const unsigned slot, const void* const buffer, const std::size_t size, const std::uint64_t offset)
+			{
+				// The buffer is not modified by IORING_OP_WRITEV.
+				start(slot, output_.get(), IORING_OP_WRITEV, const_cast<void*>(buffer), size, offset);
+			}
+
+			std::size_t wait(const unsigned slot)
+			{
+				auto& request = requests_[slot];
+
+				while (request.is_pending)
+				{
+					reap();
+				}
+				if (request.error != 0)
+				{
+					throw std::system_error{ request.error, std::generic_category(),
+						(request.opcode == IORING_OP_READV) ? "Failed to read file" : "Failed to write bfloat16 tensor file" };
+				}
+				return request.transferred;
+			}
+
+			void wait_all() noexcept
+			{
+				for (const auto& request : requests_)
+				{
+					try
+					{
+						while (request.is_pending)
+						{
+							reap();
+						}
+					}
+					catch (const std::system_error&)
+					{
+						// Only possible when the ring itself fails, so give up.
+						return;
+					}
+				}
+			}
+
+			void finish()
+			{
+			}
+
+		private:
+			static constexpr unsigned number_of_slots{ 4 };
+
+			struct request_type
+			{
+				int file;
+				std::uint8_t opcode;
+				bool is_pending;
+				int error;
+				char* buffer;
+				std::size_t remaining;
+				std::uint64_t offset;
+				std::size_t transferred;
+				::iovec vector;
+			};
+
+			static int setup(const unsigned number_of_entries, ::io_uring_params& parameters) noexcept
+			{
+				return static_cast<int>(::syscall(__NR_io_uring_setup, number_of_entries, &parameters));
+			}
+
+			static int open_file(const std::string& file_name, const int flags)
+			{
+				const int result{ ::open(file_name.c_str(), flags | O_CLOEXEC, 0666) };
+
+				if (result < 0)
+				{
+					throw std::system_error{ errno, std::generic_category(), "Failed to open \"" + file_name + "\"" };
+				}
+				return result;
+			}
+
+			void* map(const std::size_t size, const std::uint64_t offset) noexcept
+			{
+				void* const result{ ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					ring_.get(), static_cast<off_t>(offset)) };
+				return (result == MAP_FAILED) ? nullptr : result;
+			}
+
+			void unmap() noexcept
+			{
+				if (sqes_ != nullptr)
+				{
+					::munmap(sqes_, sqes_size_);
+				}
+				if ((cq_ring_ != nullptr) && (cq_ring_ != sq_ring_))
+				{
+					::munmap(cq_ring_, cq_ring_size_);
+				}
+				if (sq_ring_ != nullptr)
+				{
+					::munmap(sq_ring_, sq_ring_size_);
+				}
+			}
+
+			void enter(const unsigned to_submit, const unsigned min_complete, const unsigned flags)
+			{
+				while (::syscall(__NR_io_uring_enter, ring_.get(), to_submit, min_complete, flags, nullptr, 0) < 0)
+				{
+					if (errno != EINTR)
+					{
+						throw std::system_error{ errno, std::generic_category(), "Failed to enter io_uring" };
+					}
+				}
+			}
+
+			void start(const unsigned slot, const int file, const std::uint8_t opcode,
+				void* const buffer, const std::size_t size, const std::uint64_t offset)
+			{
+				auto& request = requests_[slot];
+				request = request_type{ file, opcode, true, 0, static_cast<char*>(buffer), size, offset, 0, {} };
+				submit(slot);
+			}
+
+			void submit(const unsigned slot)
+			{
+				auto& request = requests_[slot];
+				request.vector.iov_base = request.buffer;
+				request.vector.iov_len = request.remaining;
+
+				const unsigned tail{ *sq_tail_ };
+				const unsigned index{ tail & sq_mask_ };
+				auto& sqe = sqes_[index];
+
+				std::memset(&sqe, 0, sizeof(sqe));
+				sqe.opcode = request.opcode;
+				sqe.fd = request.file;
+				sqe.addr = reinterpret_cast<std::uintptr_t>(&request.vector);
+				sqe.len = 1;
+				sqe.off = request.offset;
+				sqe.user_data = slot;
+				sq_array_[index] = index;
+
+				// Publish the entry to the kernel.
+				__atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+				enter(1, 0, 0);
+			}
+
+			// Waits for at least one completion, and processes all available completions.
+			// Resubmits the remainder of a partial transfer.
+			void reap()
+			{
+				enter(0, 1, IORING_ENTER_GETEVENTS);
+
+				unsigned head{ *cq_head_ };
+
+				while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+				{
+					const auto& cqe = cqes_[head & cq_mask_];
+					const auto slot = static_cast<unsigned>(cqe.user_data);
+					const int result{ cqe.res };
+					__atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+
+					auto& request = requests_[slot];
+
+					if (result < 0)
+					{
+						if ((result == -EINTR) || (result == -EAGAIN))
+						{
+							submit(slot);
+						}
+						else
+						{
+							request.error = -result;
+							request.is_pending = false;
+						}
+					}
+					else
+					{
+						const auto size = static_cast<std::size_t>(result);
+						request.buffer += size;
+						request.remaining -= size;
+						request.offset += size;
+						request.transferred += size;
+
+						if ((size > 0) && (request.remaining > 0))
+						{
+							submit(slot);
+						}
+						else
+						{
+							// Either finished, or the end of the input file is reached.
+							request.is_pending = false;
+						}
+					}
+				}
+			}
+
+			file_descriptor input_;
+			file_descriptor output_;
+			::io_uring_params parameters_{};
+			file_descriptor ring_;
+			void* sq_ring_{};
+			void* cq_ring_{};
+			::io_uring_sqe* sqes_{};
+			std::size_t sq_ring_size_{};
+			std::size_t cq_ring_size_{};
+			std::size_t sqes_size_{};
+			unsigned* sq_tail_{};
+			unsigned sq_mask_{};
+			unsigned* sq_array_{};
+			unsigned* cq_head_{};
+			const unsigned* cq_tail_{};
+			unsigned cq_mask_{};
+			const ::io_uring_cqe* cqes_{};
+			request_type requests_[number_of_slots]{};
+		};
+
+#endif
+
+
+		// Converts the float values from the input file of file_io, chunk by chunk,
+		// into the payload of a tensor file.
+		template <typename FileIO, typename ConvertChunk>
+		void convert_float_file_pipelined(FileIO& file_io, const tensor_file_header& header,
+			const stream_conversion_options& options, const ConvertChunk& convert_chunk)
+		{
+			const std::size_t chunk_size{ options.chunk_size };
+			const auto number_of_chunks = (header.payload_size + chunk_size - 1) / chunk_size;
+			const auto get_count = [&header, chunk_size](const std::uint64_t chunk_index)
+			{
+				return static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, header.payload_size - chunk_index * chunk_size));
+			};
+
+			// The header, followed by the padding up to the payload.
+			std::vector<char> prefix(header.payload_offset);
+			std::memcpy(prefix.data(), &header, sizeof(header));
+
+			std::vector<float> float_chunks[2];
+			bfloat16_buffer bfloat16_chunks[2];
+
+			for (auto& float_chunk : float_chunks)
+			{
+				float_chunk.resize(static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, header.payload_size)));
+			}
+			for (auto& bfloat16_chunk : bfloat16_chunks)
+			{
+				bfloat16_chunk = bfloat16_buffer(float_chunks[0].size(), uninitialized);
+			}
+
+			try
+			{
+				// The write of chunk i uses slot 2 + (i % 2), so the header is written as if
+				// it were chunk -1.
+				file_io.start_write(3, prefix.data(), prefix.size(), 0);
+				std::size_t previous_write_size{ prefix.size() };
+
+				if (number_of_chunks > 0)
+				{
+					file_io.start_read(0, float_chunks[0].data(), get_count(0) * sizeof(float), options.input_offset);
+				}
+				for (std::uint64_t chunk_index{}; chunk_index < number_of_chunks; ++chunk_index)
+				{
+					const auto slot = static_cast<unsigned>(chunk_index % 2);
+					const auto count = get_count(chunk_index);
+
+					if (file_io.wait(slot) != count * sizeof(float))
+					{
+						throw tensor_file_error{ "The input file has fewer float values than the tensor" };
+					}
+					if (chunk_index + 1 < number_of_chunks)
+					{
+						file_io.start_read(1 - slot, float_chunks[1 - slot].data(), get_count(chunk_index + 1) * sizeof(float),
+							options.input_offset + (chunk_index + 1) * chunk_size * sizeof(float));
+					}
+					convert_chunk(float_chunks[slot].data(), bfloat16_chunks[slot].data(), count);
+
+					if (file_io.wait(3 - slot) != previous_write_size)
+					{
+						throw tensor_file_error{ "Failed to write bfloat16 tensor file" };
+					}
+					previous_write_size = count * sizeof(bfloat16_t);
+					file_io.start_write(2 + slot, bfloat16_chunks[slot].data(), previous_write_size,
+						header.payload_offset + chunk_index * chunk_size * sizeof(bfloat16_t));
+				}
+				if (file_io.wait(static_cast<unsigned>(3 - number_of_chunks % 2)) != previous_write_size)
+				{
+					throw tensor_file_error{ "Failed to write bfloat16 tensor file" };
+				}
+			}
+			catch (...)
+			{
+				// Ensure that no request still accesses the chunks.
+				file_io.wait_all();
+				throw;
+			}
+			file_io.finish();
+		}
+
+
+		template <typename ConvertChunk>
+		void convert_float_file(const std::string& input_file_name, const std::string& output_file_name,
+			const tensor_layout& layout, const stream_conversion_options& options, const ConvertChunk& convert_chunk)
+		{
+			if (options.chunk_size == 0)
+			{
+				throw std::invalid_argument{ "The chunk size must not be zero" };
+			}
+			const auto header = make_tensor_file_header(layout);
+
+#ifdef BIOVAULT_BFLOAT16_HAS_IO_URING
+			if (options.use_io_uring && io_uring_file_io::is_supported())
+			{
+				io_uring_file_io file_io(input_file_name, output_file_name);
+				convert_float_file_pipelined(file_io, header, options, convert_chunk);
+				return;
+			}
+#endif
+			thread_file_io file_io(input_file_name, output_file_name);
+			convert_float_file_pipelined(file_io, header, options, convert_chunk);
+		}
+	}
+
+
+	// Tells whether convert_float_file uses io_uring on this system (unless disabled
+	// by its options).
+	inline bool is_io_uring_supported() noexcept
+	{
+#ifdef BIOVAULT_BFLOAT16_HAS_IO_URING
+		return detail::io_uring_file_io::is_supported();
+#else
+		return false;
+#endif
+	}
+
+
+	// Converts the float values (in native byte order) of the input file into a
+	// bfloat16 tensor file of the specified layout. Reads as many values as the
+	// payload needs (see make_tensor_file_header). Throws tensor_file_error when the
+	// input file has fewer values, and std::system_error when an I/O operation fails.
+	inline void convert_float_file(const std::string& input_file_name, const std::string& output_file_name,
+		const tensor_layout& layout, const stream_conversion_options& options = {})
+	{
+		detail::convert_float_file(input_file_name, output_file_name, layout, options,
+			[](const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				convert(src, dst, n);
+			});
+	}
+
+
+	inline void convert_float_file(const std::string& input_file_name, const std::string& output_file_name,
+		const tensor_layout& layout, const round_to_nearest_even_t, const stream_conversion_options& options = {})
+	{
+		convert_float_file(input_file_name, output_file_name, layout, options);
+	}
+
+
+	inline void convert_float_file(const std::string& input_file_name, const std::string& output_file_name,
+		const tensor_layout& layout, const round_toward_zero_t, const stream_conversion_options& options = {})
+	{
+		detail::convert_float_file(input_file_name, output_file_name, layout, options,
+			[](const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				convert(src, dst, n, round_toward_zero);
+			});
+	}
+
+
+	// Yields the same results as a stochastic conversion of the entire payload at
+	// once, as the chunks are converted in order.
+	inline void convert_float_file(const std::string& input_file_name, const std::string& output_file_name,
+		const tensor_layout& layout, stochastic_rounding& rounding, const stream_conversion_options& options = {})
+	{
+		detail::convert_float_file(input_file_name, output_file_name, layout, options,
+			[&rounding](const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				convert(src, dst, n, rounding);
+			});
+	}
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_stream.h"
+#include "biovault_bfloat16_stream.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cmath>   // For ldexp.
+#include <cstdint>
+#include <cstdio>  // For remove.
+#include <fstream>
+#include <string>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::tensor_layout;
+
+
+namespace
+{
+	std::string get_temporary_file_name(const std::string& name)
+	{
+		return testing::TempDir() + "biovault_bfloat16_stream_test_" + name;
+	}
+
+
+	std::vector<float> make_float_values(const std::size_t n)
+	{
+		std::vector<float> result;
+		result.reserve(n);
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			// Values that are not exactly representable by bfloat16.
+			result.push_back(std::ldexp(1.0f + static_cast<float>(i % 1000) / 1000.0f, static_cast<int>(i % 64) - 32));
+		}
+		return result;
+	}
+
+
+	void write_float_file(const std::string& file_name, const std::vector<float>& values, const std::size_t offset = 0)
+	{
+		std::ofstream stream{ file_name, std::ios::binary };
+		stream.write(std::string(offset, 'x').data(), static_cast<std::streamsize>(offset));
+		stream.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(float)));
+	}
+
+
+	template <typename T>
+	void expect_mapped_payload_equals(const std::string& file_name, const std::vector<T>& expected)
+	{
+		const biovault::mapped_tensor_file mapped_file{ file_name };
+		const auto span = mapped_file.get_span();
+		ASSERT_EQ(span.size(), expected.size());
+
+		for (std::size_t i{}; i < span.size(); ++i)
+		{
+			ASSERT_EQ(get_raw_bits(span[i]), get_raw_bits(expected[i])) << " i = " << i;
+		}
+	}
+
+
+	std::vector<biovault::stream_conversion_options> get_options_of_each_file_io(const std::size_t chunk_size)
+	{
+		std::vector<biovault::stream_conversion_options> result(1);
+		result[0].chunk_size = chunk_size;
+		result[0].use_io_uring = false;
+
+		if (biovault::is_io_uring_supported())
+		{
+			result.push_back(result[0]);
+			result[1].use_io_uring = true;
+		}
+		return result;
+	}
+}
+
+
+GTEST_TEST(bfloat16_stream, ConvertFloatFileEqualsBulkConversion)
+{
+	const auto input_file_name = get_temporary_file_name("input.f32");
+	const auto output_file_name = get_temporary_file_name("output.bf16");
+
+	for (const std::size_t n : { 0, 1, 999, 1000, 1001, 4567 })
+	{
+		const auto values = make_float_values(n);
+		write_float_file(input_file_name, values);
+
+		std::vector<bfloat16_t> expected(n);
+		biovault::convert(values.data(), expected.data(), n);
+
+		for (const auto& options : get_options_of_each_file_io(1000))
+		{
+			biovault::convert_float_file(input_file_name, output_file_name, tensor_layout{ { n }, {} }, options);
+			expect_mapped_payload_equals(output_file_name, expected);
+		}
+	}
+	EXPECT_EQ(std::remove(input_file_name.c_str()), 0);
+	EXPECT_EQ(std::remove(output_file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_stream, ConvertFloatFileSupportsEachRoundingAndInputOffset)
+{
+	const auto input_file_name = get_temporary_file_name("input_with_offset.f32");
+	const auto output_file_name = get_temporary_file_name("rounded.bf16");
+	const std::size_t n{ 3000 };
+	const tensor_layout layout{ { 30, 100 }, {}, 64 };
+	const auto values = make_float_values(n);
+
+	write_float_file(input_file_name, values, 12);
+
+	for (auto options : get_options_of_each_file_io(512))
+	{
+		options.input_offset = 12;
+
+		std::vector<bfloat16_t> expected(n);
+		biovault::convert(values.data(), expected.data(), n, biovault::round_toward_zero);
+		biovault::convert_float_file(input_file_name, output_file_name, layout, biovault::round_toward_zero, options);
+		expect_mapped_payload_equals(output_file_name, expected);
+
+		biovault::stochastic_rounding expected_rounding{ 42 };
+		biovault::stochastic_rounding rounding{ 42 };
+		biovault::convert(values.data(), expected.data(), n, expected_rounding);
+		biovault::convert_float_file(input_file_name, output_file_name, layout, rounding, options);
+		expect_mapped_payload_equals(output_file_name, expected);
+		EXPECT_EQ(rounding.next_rounding_bias(), expected_rounding.next_rounding_bias());
+
+		const biovault::mapped_tensor_file mapped_file{ output_file_name };
+		EXPECT_EQ(mapped_file.get_shape(), layout.shape);
+		EXPECT_EQ(mapped_file.get_header().alignment, 64U);
+	}
+	EXPECT_EQ(std::remove(input_file_name.c_str()), 0);
+	EXPECT_EQ(std::remove(output_file_name.c_str()), 0);
+}
+
+
+GTEST_TEST(bfloat16_stream, ConvertFloatFileThrowsWhenInputIsTooShort)
+{
+	const auto input_file_name = get_temporary_file_name("short.f32");
+	const auto output_file_name = get_temporary_file_name("short.bf16");
+
+	write_float_file(input_file_name, make_float_values(2500));
+
+	for (const auto& options : get_options_of_each_file_io(1000))
+	{
+		EXPECT_THROW(biovault::convert_float_file(input_file_name, output_file_name, tensor_layout{ { 50, 51 }, {} }, options),
+			biovault::tensor_file_error);
+		EXPECT_THROW(biovault::convert_float_file(get_temporary_file_name("nonexistent.f32"), output_file_name,
+			tensor_layout{ { 1 }, {} }, options), std::system_error);
+	}
+	EXPECT_EQ(std::remove(input_file_name.c_str()), 0);
+	EXPECT_EQ(std::remove(output_file_name.c_str()), 0);
+}
@@ -0,0 +1,362 @@
+#ifndef BIOVAULT_BFLOAT16_STRIDED_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_STRIDED_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Conversion of non-contiguous (strided) arrays, for example one channel of an
+// interleaved RGBA image, or a tile of a larger 2D or 3D array. The strides are
+// specified in elements (not bytes), and may be negative. Each element is converted
+// just like bfloat16_t(const float) does. The conversion from float to bfloat16 has
+// SIMD kernels for a source stride of 2, 3, or 4, with the destination being contiguous.
+
+#include "biovault_bfloat16.h"
+
+#include <cstddef>     // For ptrdiff_t and size_t.
+#include <type_traits> // For integral_constant.
+
+namespace biovault {
+
+	// The numbers of elements of a 1D, 2D, or 3D array, along each dimension, from the
+	// fastest varying (x) to the slowest varying (z). For example, array_extents{ 640, 480 }
+	// for a 2D image.
+	struct array_extents
+	{
+		std::size_t x;
+		std::size_t y{ 1 };
+		std::size_t z{ 1 };
+	};
+
+	// The distance between consecutive elements along each dimension, in elements.
+	// For example, array_strides{ 4, 4 * 640 } for one channel of an RGBA image of 640
+	// pixels wide.
+	struct array_strides
+	{
+		std::ptrdiff_t x{ 1 };
+		std::ptrdiff_t y{};
+		std::ptrdiff_t z{};
+	};
+
+
+	namespace detail {
+
+		template <std::ptrdiff_t Stride>
+		using stride_constant = std::integral_constant<std::ptrdiff_t, Stride>;
+
+		namespace scalar {
+
+			inline void convert(const float* const src, const std::ptrdiff_t src_stride, bfloat16_t* const dst,
+				const std::ptrdiff_t dst_stride, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto index = static_cast<std::ptrdiff_t>(i);
+					dst[index * dst_stride] = bfloat16_t::from_float_branchless(src[index * src_stride]);
+				}
+			}
+
+			inline void convert(const bfloat16_t* const src, const std::ptrdiff_t src_stride, float* const dst,
+				const std::ptrdiff_t dst_stride, const std::size_t n)
+			{
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto index = static_cast<std::ptrdiff_t>(i);
+					dst[index * dst_stride] = src[index * src_stride];
+				}
+			}
+		}
+
+		// The strided kernels below load whole vectors, and pick every second, third,
+		// or fourth float. As the loads of a block read up to Stride - 1 floats beyond
+		// its last element, they stop one element before the end, leaving the remaining
+		// elements to the scalar kernel.
+
+#ifdef BIOVAULT_BFLOAT16_SSE2
+		namespace sse2 {
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128 load_with_stride(const float* const src, stride_constant<2>)
+			{
+				return _mm_shuffle_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _MM_SHUFFLE(2, 0, 2, 0));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128 load_with_stride(const float* const src, stride_constant<3>)
+			{
+				// The elements are at the positions 0 and 3 of the first load, 2 of the
+				// second, and 1 of the third.
+				const __m128 second_and_third = _mm_shuffle_ps(_mm_loadu_ps(src + 4), _mm_loadu_ps(src + 8),
+					_MM_SHUFFLE(1, 1, 2, 2));
+				return _mm_shuffle_ps(_mm_loadu_ps(src), second_and_third, _MM_SHUFFLE(2, 0, 3, 0));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_SSE2 inline __m128 load_with_stride(const float* const src, stride_constant<4>)
+			{
+				const __m128 first = _mm_unpacklo_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4));
+				const __m128 second = _mm_unpacklo_ps(_mm_loadu_ps(src + 8), _mm_loadu_ps(src + 12));
+				return _mm_movelh_ps(first, second);
+			}
+
+			template <std::ptrdiff_t Stride>
+			BIOVAULT_BFLOAT16_TARGET_SSE2 void convert_with_stride(const float* const src, bfloat16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 < n; i += 8)
+				{
+					const float* const block = src + i * Stride;
+					const __m128i low = convert_to_bits_of_bfloat16(load_with_stride(block, stride_constant<Stride>{}));
+					const __m128i high = convert_to_bits_of_bfloat16(load_with_stride(block + 4 * Stride, stride_constant<Stride>{}));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pack(low, high));
+				}
+				scalar::convert(src + i * Stride, Stride, dst + i, 1, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX2
+		namespace avx2 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256 load_with_stride(const float* const src, stride_constant<2>)
+			{
+				const __m256 shuffled = _mm256_shuffle_ps(_mm256_loadu_ps(src), _mm256_loadu_ps(src + 8), _MM_SHUFFLE(2, 0, 2, 0));
+				return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(shuffled), 0xD8));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256 load_with_stride(const float* const src, stride_constant<3>)
+			{
+				// Element j is at position 3j mod 8 of load 3j / 8. These positions do not
+				// overlap, so the three loads can be blended, and then permuted.
+				const __m256 first_and_second = _mm256_blend_ps(_mm256_loadu_ps(src), _mm256_loadu_ps(src + 8), 0x92);
+				const __m256 blended = _mm256_blend_ps(first_and_second, _mm256_loadu_ps(src + 16), 0x24);
+				return _mm256_permutevar8x32_ps(blended, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX2 inline __m256 load_with_stride(const float* const src, stride_constant<4>)
+			{
+				// Elements 0, 2, 4, 6 in the lower lane, and 1, 3, 5, 7 in the upper lane.
+				const __m256 first = _mm256_unpacklo_ps(_mm256_loadu_ps(src), _mm256_loadu_ps(src + 8));
+				const __m256 second = _mm256_unpacklo_ps(_mm256_loadu_ps(src + 16), _mm256_loadu_ps(src + 24));
+				const __m256 unpacked = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(first), _mm256_castps_pd(second)));
+				return _mm256_permutevar8x32_ps(unpacked, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+			}
+
+			template <std::ptrdiff_t Stride>
+			BIOVAULT_BFLOAT16_TARGET_AVX2 void convert_with_stride(const float* const src, bfloat16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 < n; i += 16)
+				{
+					const float* const block = src + i * Stride;
+					const __m256i low = convert_to_bits_of_bfloat16(load_with_stride(block, stride_constant<Stride>{}));
+					const __m256i high = convert_to_bits_of_bfloat16(load_with_stride(block + 8 * Stride, stride_constant<Stride>{}));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack(low, high));
+				}
+				scalar::convert(src + i * Stride, Stride, dst + i, 1, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_AVX512
+		namespace avx512 {
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512 load_with_stride(const float* const src, stride_constant<2>)
+			{
+				const __m512i indices = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+				return _mm512_permutex2var_ps(_mm512_loadu_ps(src), indices, _mm512_loadu_ps(src + 16));
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512 load_with_stride(const float* const src, stride_constant<3>)
+			{
+				// Element j is at position 3j mod 16 of load 3j / 16, as with AVX2.
+				const __m512 first_and_second = _mm512_mask_blend_ps(0x4924, _mm512_loadu_ps(src), _mm512_loadu_ps(src + 16));
+				const __m512 blended = _mm512_mask_blend_ps(0x2492, first_and_second, _mm512_loadu_ps(src + 32));
+				return _mm512_permutexvar_ps(_mm512_setr_epi32(0, 3, 6, 9, 12, 15, 2, 5, 8, 11, 14, 1, 4, 7, 10, 13), blended);
+			}
+
+			BIOVAULT_BFLOAT16_TARGET_AVX512 inline __m512 load_with_stride(const float* const src, stride_constant<4>)
+			{
+				// Each permutation yields eight elements in its lower half.
+				const __m512i indices = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 0, 4, 8, 12, 16, 20, 24, 28);
+				const __m512 first = _mm512_permutex2var_ps(_mm512_loadu_ps(src), indices, _mm512_loadu_ps(src + 16));
+				const __m512 second = _mm512_permutex2var_ps(_mm512_loadu_ps(src + 32), indices, _mm512_loadu_ps(src + 48));
+				return _mm512_shuffle_f32x4(first, second, _MM_SHUFFLE(1, 0, 1, 0));
+			}
+
+			template <std::ptrdiff_t Stride>
+			BIOVAULT_BFLOAT16_TARGET_AVX512 void convert_with_stride(const float* const src, bfloat16_t* const dst,
+				const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 16 < n; i += 16)
+				{
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi32_epi16(
+						convert_to_bits_of_bfloat16(load_with_stride(src + i * Stride, stride_constant<Stride>{}))));
+				}
+				scalar::convert(src + i * Stride, Stride, dst + i, 1, n - i);
+			}
+		}
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_NEON
+		namespace neon {
+
+			// The NEON structure loads deinterleave by themselves.
+			inline float32x4_t load_with_stride(const float* const src, stride_constant<2>)
+			{
+				return vld2q_f32(src).val[0];
+			}
+
+			inline float32x4_t load_with_stride(const float* const src, stride_constant<3>)
+			{
+				return vld3q_f32(src).val[0];
+			}
+
+			inline float32x4_t load_with_stride(const float* const src, stride_constant<4>)
+			{
+				return vld4q_f32(src).val[0];
+			}
+
+			template <std::ptrdiff_t Stride>
+			void convert_with_stride(const float* const src, bfloat16_t* const dst, const std::size_t n)
+			{
+				std::size_t i{};
+
+				for (; i + 8 < n; i += 8)
+				{
+					const float* const block = src + i * Stride;
+					const uint32x4_t low = convert_to_bits_of_bfloat16(load_with_stride(block, stride_constant<Stride>{}));
+					const uint32x4_t high = convert_to_bits_of_bfloat16(load_with_stride(block + 4 * Stride, stride_constant<Stride>{}));
+					vst1q_u16(reinterpret_cast<std::uint16_t*>(dst + i), vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+				}
+				scalar::convert(src + i * Stride, Stride, dst + i, 1, n - i);
+			}
+		}
+#endif
+
+		using convert_with_stride_function = void (*)(const float*, bfloat16_t*, std::size_t);
+
+		template <std::ptrdiff_t Stride>
+		convert_with_stride_function get_convert_with_stride_kernel()
+		{
+			switch (get_simd_kernel())
+			{
+#ifdef BIOVAULT_BFLOAT16_SSE2
+			case simd_kernel::sse2:
+				return sse2::convert_with_stride<Stride>;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX2
+			case simd_kernel::avx2:
+				return avx2::convert_with_stride<Stride>;
+#endif
+#ifdef BIOVAULT_BFLOAT16_AVX512
+			case simd_kernel::avx512:
+			case simd_kernel::avx512_bf16:
+				return avx512::convert_with_stride<Stride>;
+#endif
+#ifdef BIOVAULT_BFLOAT16_NEON
+			case simd_kernel::neon:
+			case simd_kernel::neon_bf16:
+				return neon::convert_with_stride<Stride>;
+#endif
+			default:
+				return [](const float* const src, bfloat16_t* const dst, const std::size_t n)
+				{
+					scalar::convert(src, Stride, dst, 1, n);
+				};
+			}
+		}
+	}
+
+
+	// Converts the n elements src[i * src_stride] to dst[i * dst_stride]. Like the
+	// contiguous bulk conversion, it is counted by BIOVAULT_BFLOAT16_INSTRUMENTATION.
+	inline void convert(const float* const src, const std::ptrdiff_t src_stride, bfloat16_t* const dst,
+		const std::ptrdiff_t dst_stride, const std::size_t n)
+	{
+		switch ((dst_stride == 1) ? src_stride : 0)
+		{
+		case 1:
+			// The contiguous conversion counts its conversions by itself.
+			convert(src, dst, n);
+			return;
+		case 2:
+			detail::get_convert_with_stride_kernel<2>()(src, dst, n);
+			break;
+		case 3:
+			detail::get_convert_with_stride_kernel<3>()(src, dst, n);
+			break;
+		case 4:
+			detail::get_convert_with_stride_kernel<4>()(src, dst, n);
+			break;
+		default:
+			detail::scalar::convert(src, src_stride, dst, dst_stride, n);
+			break;
+		}
+		BIOVAULT_BFLOAT16_COUNT_STRIDED_CONVERSIONS(src, src_stride, dst, dst_stride, n);
+	}
+
+
+	// Converts the n elements src[i * src_stride] to dst[i * dst_stride].
+	inline void convert(const bfloat16_t* const src, const std::ptrdiff_t src_stride, float* const dst,
+		const std::ptrdiff_t dst_stride, const std::size_t n)
+	{
+		if ((src_stride == 1) && (dst_stride == 1))
+		{
+			convert(src, dst, n);
+			return;
+		}
+		detail::scalar::convert(src, src_stride, dst, dst_stride, n);
+	}
+
+
+	// Converts a 1D, 2D, or 3D array of the specified extents, by converting each row
+	// (along x) separately. The element at (x, y, z) is at x * strides.x + y * strides.y
+	// + z * strides.z, both in src and in dst.
+	inline void convert(const float* const src, const array_strides& src_strides, bfloat16_t* const dst,
+		const array_strides& dst_strides, const array_extents& extents)
+	{
+		for (std::size_t z{}; z < extents.z; ++z)
+		{
+			for (std::size_t y{}; y < extents.y; ++y)
+			{
+				const auto src_offset = static_cast<std::ptrdiff_t>(z) * src_strides.z + static_cast<std::ptrdiff_t>(y) * src_strides.y;
+				const auto dst_offset = static_cast<std::ptrdiff_t>(z) * dst_strides.z + static_cast<std::ptrdiff_t>(y) * dst_strides.y;
+				convert(src + src_offset, src_strides.x, dst + dst_offset, dst_strides.x, extents.x);
+			}
+		}
+	}
+
+
+	inline void convert(const bfloat16_t* const src, const array_strides& src_strides, float* const dst,
+		const array_strides& dst_strides, const array_extents& extents)
+	{
+		for (std::size_t z{}; z < extents.z; ++z)
+		{
+			for (std::size_t y{}; y < extents.y; ++y)
+			{
+				const auto src_offset = static_cast<std::ptrdiff_t>(z) * src_strides.z + static_cast<std::ptrdiff_t>(y) * src_strides.y;
+				const auto dst_offset = static_cast<std::ptrdiff_t>(z) * dst_strides.z + static_cast<std::ptrdiff_t>(y) * dst_strides.y;
+				convert(src + src_offset, src_strides.x, dst + dst_offset, dst_strides.x, extents.x);
+			}
+		}
+	}
+
+}
+
+#endif
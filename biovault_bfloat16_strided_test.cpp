@@ -0,0 +1,151 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_strided.h"
+#include "biovault_bfloat16_strided.h"
+
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstddef> // For ptrdiff_t and size_t.
+#include <cstdlib> // For abs.
+#include <cstdint>
+#include <vector>
+
+using biovault::array_extents;
+using biovault::array_strides;
+using biovault::bfloat16_t;
+using biovault::test::make_floats;
+
+
+namespace
+{
+	const bfloat16_t sentinel{ static_cast<std::uint16_t>(0x1234), true };
+}
+
+
+GTEST_TEST(bfloat16_strided, EachKernelConvertsWithStrideLikeConstruction)
+{
+	constexpr std::ptrdiff_t max_n{ 70 };
+	const std::ptrdiff_t src_strides[] = { 1, 2, 3, 4, 5, -1, -3 };
+	const std::ptrdiff_t dst_strides[] = { 1, 2, -1 };
+	const auto floats = make_floats(5 * max_n);
+
+	biovault::test::for_each_supported_simd_kernel([&]
+		{
+			for (const auto src_stride : src_strides)
+			{
+				for (const auto dst_stride : dst_strides)
+				{
+					// Includes the sizes that just fill the SIMD blocks, as well as those that
+					// leave a scalar tail.
+					for (std::ptrdiff_t n{}; n <= max_n; ++n)
+					{
+						// The source has no more floats than needed, so that any read beyond it may
+						// be detected (for example by AddressSanitizer). Negative strides start at the end.
+						const auto src_size = (n == 0) ? 0 : (n - 1) * std::abs(src_stride) + 1;
+						const std::vector<float> src_floats(floats.cbegin(), floats.cbegin() + src_size);
+						const float* const src = src_floats.data() + ((src_stride < 0) ? src_size - 1 : 0);
+						std::vector<bfloat16_t> result(2 * max_n, sentinel);
+						bfloat16_t* const dst = result.data() + ((dst_stride < 0) ? max_n - 1 : 0);
+
+						biovault::convert(src, src_stride, dst, dst_stride, static_cast<std::size_t>(n));
+
+						std::vector<bfloat16_t> expected(result.size(), sentinel);
+
+						for (std::ptrdiff_t i{}; i < n; ++i)
+						{
+							expected[static_cast<std::size_t>((dst - result.data()) + i * dst_stride)] = bfloat16_t(src[i * src_stride]);
+						}
+						for (std::size_t i{}; i < result.size(); ++i)
+						{
+							ASSERT_EQ(get_raw_bits(result[i]), get_raw_bits(expected[i]))
+								<< "src_stride = " << src_stride << ", dst_stride = " << dst_stride << ", n = " << n << ", i = " << i;
+						}
+					}
+				}
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16_strided, ConvertsWithStrideToFloat)
+{
+	const auto floats = make_floats(300);
+
+	std::vector<bfloat16_t> bfloats;
+
+	for (const auto f : floats)
+	{
+		bfloats.push_back(bfloat16_t(f));
+	}
+
+	for (const std::ptrdiff_t stride : { 1, 3 })
+	{
+		std::vector<float> result(3 * bfloats.size());
+		biovault::convert(bfloats.data() + 2, 3, result.data() + 1, stride, bfloats.size() / 3);
+
+		for (std::size_t i{}; i < bfloats.size() / 3; ++i)
+		{
+			ASSERT_EQ(get_raw_bits(bfloat16_t(result[1 + i * static_cast<std::size_t>(stride)])), get_raw_bits(bfloats[2 + 3 * i]));
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16_strided, ConvertsChannelOfTileOfVolume)
+{
+	// A volume of 9 x 7 x 5 voxels with 4 interleaved channels, of which the third
+	// channel of a tile of 6 x 4 x 3 voxels, starting at (2, 1, 1), is converted to a
+	// contiguous tile.
+	constexpr std::size_t number_of_channels{ 4 };
+	constexpr array_extents volume_extents{ 9, 7, 5 };
+	constexpr array_extents tile_extents{ 6, 4, 3 };
+	constexpr std::ptrdiff_t channel{ 2 };
+
+	const auto volume = make_floats(number_of_channels * volume_extents.x * volume_extents.y * volume_extents.z);
+	const array_strides volume_strides{ number_of_channels, number_of_channels * volume_extents.x,
+		number_of_channels * volume_extents.x * volume_extents.y };
+	const array_strides tile_strides{ 1, tile_extents.x, tile_extents.x * tile_extents.y };
+	const float* const origin = volume.data() + channel + 2 * volume_strides.x + volume_strides.y + volume_strides.z;
+
+	std::vector<bfloat16_t> tile(tile_extents.x * tile_extents.y * tile_extents.z, sentinel);
+	biovault::convert(origin, volume_strides, tile.data(), tile_strides, tile_extents);
+
+	std::vector<float> roundtrip(volume.size());
+	biovault::convert(tile.data(), tile_strides, roundtrip.data() + (origin - volume.data()), volume_strides, tile_extents);
+
+	for (std::ptrdiff_t z{}; z < static_cast<std::ptrdiff_t>(tile_extents.z); ++z)
+	{
+		for (std::ptrdiff_t y{}; y < static_cast<std::ptrdiff_t>(tile_extents.y); ++y)
+		{
+			for (std::ptrdiff_t x{}; x < static_cast<std::ptrdiff_t>(tile_extents.x); ++x)
+			{
+				const auto volume_index = (origin - volume.data()) + x * volume_strides.x + y * volume_strides.y + z * volume_strides.z;
+				const auto& element = tile[static_cast<std::size_t>(x * tile_strides.x + y * tile_strides.y + z * tile_strides.z)];
+				const auto i = static_cast<std::size_t>(volume_index);
+
+				ASSERT_EQ(get_raw_bits(element), get_raw_bits(bfloat16_t(volume[i])));
+				ASSERT_EQ(get_raw_bits(bfloat16_t(roundtrip[i])), get_raw_bits(element));
+			}
+		}
+	}
+}
@@ -20,15 +20,22 @@
 #include "biovault_bfloat16.h"
 #include "biovault_bfloat16.h"
 
+// Helpers shared among the tests:
+#include "biovault_bfloat16_test_helpers.h"
+
 // GoogleTest header file:
 #include <gtest/gtest.h>
 
 // Standard library header files:
+#include <algorithm> // For min.
 #include <array>
 #include <cmath>    // For fpclassify.
+#include <cstdint>
 #include <cstring>
 #include <string>
 #include <limits>
+#include <unordered_set>
+#include <vector>
 
 // References:
 //
@@ -160,6 +167,112 @@ namespace
 	}
 
 
+	float raw_bits_to_float(const std::uint32_t arg)
+	{
+		float result;
+		std::memcpy(&result, &arg, sizeof(arg));
+		return result;
+	}
+
+
+	// Returns floats whose upper halves cover all 65536 bit patterns, combined with lower
+	// halves that are of interest to rounding (including ties), NaN quieting and denormals.
+	std::vector<float> get_floats_for_bulk_conversion_test()
+	{
+		constexpr std::uint16_t lower_halves[] = { 0, 1, 0x3FFF, 0x7FFF, 0x8000, 0x8001, 0xC000, 0xFFFF };
+
+		std::vector<float> result;
+		result.reserve((std::size_t{ uint16_max } + 1) * (sizeof(lower_halves) / sizeof(lower_halves[0])));
+
+		for (std::uint32_t upper_half{}; upper_half <= uint16_max; ++upper_half)
+		{
+			for (const auto lower_half : lower_halves)
+			{
+				result.push_back(raw_bits_to_float((upper_half << 16) | lower_half));
+			}
+		}
+		return result;
+	}
+
+
+	template <typename Function>
+	void assert_bulk_conversion_from_float_equals_scalar_construction(const Function bulk_convert)
+	{
+		const auto floats = get_floats_for_bulk_conversion_test();
+		std::vector<bfloat16_t> bfloats(floats.size());
+
+		bulk_convert(floats.data(), bfloats.data(), floats.size());
+
+		for (std::size_t i{}; i < floats.size(); ++i)
+		{
+			ASSERT_EQ(get_raw_bits(bfloats[i]), get_raw_bits(bfloat16_t{ floats[i] })) << "i = " << i;
+		}
+
+		// Test small sizes and unaligned offsets, to exercise the scalar tail of the kernels.
+		for (std::size_t offset{}; offset < 4; ++offset)
+		{
+			for (std::size_t n{}; n <= 40; ++n)
+			{
+				std::vector<bfloat16_t> small_bfloats(n + offset + 1, bfloat16_t(std::uint16_t{ 0x1234 }, true));
+
+				bulk_convert(floats.data() + offset, small_bfloats.data() + offset, n);
+
+				for (std::size_t i{}; i < small_bfloats.size(); ++i)
+				{
+					ASSERT_EQ(get_raw_bits(small_bfloats[i]),
+						(i >= offset) && (i < offset + n) ? get_raw_bits(bfloat16_t{ floats[i] }) : std::uint16_t{ 0x1234 });
+				}
+			}
+		}
+	}
+
+
+	template <typename Function>
+	void assert_bulk_conversion_to_float_places_raw_bits_in_upper_half(const Function bulk_convert)
+	{
+		std::vector<bfloat16_t> bfloats;
+		bfloats.reserve(std::size_t{ uint16_max } + 1);
+
+		for (std::uint32_t bits{}; bits <= uint16_max; ++bits)
+		{
+			bfloats.push_back(raw_bits_to_bfloat16(static_cast<std::uint16_t>(bits)));
+		}
+
+		std::vector<float> floats(bfloats.size());
+		bulk_convert(bfloats.data(), floats.data(), bfloats.size());
+
+		for (std::size_t i{}; i < bfloats.size(); ++i)
+		{
+			std::uint32_t actual_bits;
+			std::memcpy(&actual_bits, &floats[i], sizeof(float));
+			ASSERT_EQ(actual_bits, std::uint32_t{ get_raw_bits(bfloats[i]) } << 16) << "i = " << i;
+		}
+
+		// Test small sizes and unaligned offsets, to exercise the scalar tail of the kernels.
+		constexpr float marker{ 42.0f };
+
+		for (std::size_t offset{}; offset < 4; ++offset)
+		{
+			for (std::size_t n{}; n <= 72; ++n)
+			{
+				std::vector<float> small_floats(n + offset + 1, marker);
+
+				bulk_convert(bfloats.data() + 0x3F00 + offset, small_floats.data() + offset, n);
+
+				for (std::size_t i{}; i < small_floats.size(); ++i)
+				{
+					ASSERT_EQ(float_to_array_of_bytes(small_floats[i]), float_to_array_of_bytes(
+						(i >= offset) && (i < offset + n) ? float{ bfloats[0x3F00 + i] } : marker));
+				}
+			}
+		}
+	}
+
+
+	using biovault::test::all_simd_kernels;
+	using biovault::test::for_each_supported_simd_kernel;
+
+
 	template <typename T>
 	void assert_assignment_yields_same_raw_bits_as_construction_from_value(const T value)
 	{
@@ -350,9 +463,63 @@ GTEST_TEST(bfloat16, Epsilon)
 		EXPECT_GT(float{ bfloat16_epsilon }, float_limits::epsilon());
 		EXPECT_LT(float{ bfloat16_epsilon }, 1.0f);
 		EXPECT_EQ(float{ bfloat16_epsilon }, 0.00781250f);
+		EXPECT_EQ(get_raw_bits(bfloat16_epsilon), get_raw_bits(std::numeric_limits<bfloat16_t>::epsilon()));
 	}
 }
 
+
+GTEST_TEST(bfloat16, NumericLimits)
+{
+	using limits = std::numeric_limits<bfloat16_t>;
+
+	static_assert(limits::is_specialized, "numeric_limits must be specialized");
+	static_assert(std::numeric_limits<const bfloat16_t>::digits == 8, "8 bits of precision, including the implicit bit");
+	static_assert((limits::radix == 2) && limits::is_signed && !limits::is_integer, "binary floating point");
+	static_assert((limits::min_exponent == float_limits::min_exponent) &&
+		(limits::max_exponent == float_limits::max_exponent), "same exponent range as float");
+
+	// The largest finite value only has its least significant bit of precision left,
+	// below the threshold of rounding to infinity.
+	EXPECT_EQ(float{ limits::max() }, std::ldexp(255.0f, 120));
+	EXPECT_EQ(float{ bfloat16_t(std::nextafter(float{ limits::max() }, float_limits::infinity())) }, float{ limits::max() });
+	EXPECT_EQ(float{ limits::lowest() }, -float{ limits::max() });
+	EXPECT_EQ(float{ limits::min() }, float_limits::min());
+	EXPECT_EQ(float{ limits::denorm_min() }, float_limits::min());
+	EXPECT_EQ(float{ limits::epsilon() }, std::ldexp(1.0f, 1 - limits::digits));
+	EXPECT_EQ(float{ bfloat16_t{ 1.0f } + limits::epsilon() }, 1.0f + std::ldexp(1.0f, -7));
+	EXPECT_EQ(float{ limits::round_error() }, 0.5f);
+	EXPECT_EQ(float{ limits::infinity() }, float_limits::infinity());
+	EXPECT_TRUE(std::isnan(float{ limits::quiet_NaN() }));
+	EXPECT_TRUE(std::isnan(float{ limits::signaling_NaN() }));
+	EXPECT_EQ(get_raw_bits(bfloat16_t{ float_limits::quiet_NaN() }), get_raw_bits(limits::quiet_NaN()));
+
+	// The most significant bit of the mantissa makes a NaN quiet.
+	EXPECT_NE(get_raw_bits(limits::quiet_NaN()) & 0x40U, 0U);
+	EXPECT_EQ(get_raw_bits(limits::signaling_NaN()) & 0x40U, 0U);
+}
+
+
+GTEST_TEST(bfloat16, HashIsConsistentWithEquality)
+{
+	const std::hash<bfloat16_t> hash{};
+
+	EXPECT_EQ(hash(bfloat16_t{ 0.0f }), hash(bfloat16_t{ -0.0f }));
+	EXPECT_EQ(hash(bfloat16_t{ 1.5f }), hash(bfloat16_t{ 1.5f }));
+
+	std::unordered_set<bfloat16_t> set;
+
+	for (std::uint32_t bits{}; bits <= uint16_max; ++bits)
+	{
+		set.insert(bfloat16_t{ static_cast<std::uint16_t>(bits), true });
+	}
+
+	// All values are distinct, except for -0 equal to +0, and NaN not even equal to itself.
+	EXPECT_EQ(set.size(), std::size_t{ uint16_max });
+	EXPECT_EQ(set.count(bfloat16_t{ -0.0f }), 1U);
+	EXPECT_EQ(set.count(bfloat16_t{ std::uint16_t{ 0x4000 }, true }), 1U);
+	EXPECT_EQ(set.count(std::numeric_limits<bfloat16_t>::quiet_NaN()), 0U);
+}
+
 #ifndef BIOVAULT_BFLOAT16_TEST_NO_UINT16_AND_BOOL_CONSTRUCTOR
 GTEST_TEST(bfloat16, AllowsConstexprConstructionFromRawBits)
 {
@@ -682,3 +849,683 @@ GTEST_TEST(bfloat16, PlusCompoundAssignmentAllowsAddingDenormal)
 	ASSERT_GT(float{ test_value }, float{ initial_value });
 }
 #endif
+
+
+namespace
+{
+	// Raw bits of bfloat16 values of each category (including subnormals, which
+	// do occur as raw bits), sampled from the entire range.
+	std::vector<std::uint16_t> get_raw_bits_for_operator_test()
+	{
+		std::vector<std::uint16_t> result = { 0, 0x8000, 0x0001, 0x8001, 0x007F, 0x0080, 0x3F80, 0xBF80,
+			0x7F7F, 0xFF7F, 0x7F80, 0xFF80, 0x7FC0, 0xFFC0, 0x7F81 };
+
+		for (std::uint32_t bits{ 3 }; bits <= uint16_max; bits += 509)
+		{
+			result.push_back(static_cast<std::uint16_t>(bits));
+		}
+		return result;
+	}
+}
+
+
+GTEST_TEST(bfloat16, ArithmeticBetweenBFloat16ValuesYieldsRoundedBFloat16)
+{
+	static_assert(std::is_same<decltype(bfloat16_t{} + bfloat16_t{}), bfloat16_t>::value, "");
+	static_assert(std::is_same<decltype(bfloat16_t{} / bfloat16_t{}), bfloat16_t>::value, "");
+
+	const auto raw_bits = get_raw_bits_for_operator_test();
+
+	for (const auto a_bits : raw_bits)
+	{
+		for (const auto b_bits : raw_bits)
+		{
+			const auto a = raw_bits_to_bfloat16(a_bits);
+			const auto b = raw_bits_to_bfloat16(b_bits);
+			const float x{ a };
+			const float y{ b };
+
+			const bfloat16_t expected[] = { bfloat16_t(x + y), bfloat16_t(x - y), bfloat16_t(x * y), bfloat16_t(x / y) };
+			const bfloat16_t actual[] = { a + b, a - b, a * b, a / b };
+
+			auto compound = a;
+			const bfloat16_t compound_assigned[] = { compound += b, compound = a, compound -= b, compound = a,
+				compound *= b, compound = a, compound /= b };
+
+			for (std::size_t i{}; i < 4; ++i)
+			{
+				// Which NaN operand propagates is up to the compiler and the platform.
+				if (std::isnan(float{ expected[i] }))
+				{
+					ASSERT_TRUE(std::isnan(float{ actual[i] }));
+					ASSERT_TRUE(std::isnan(float{ compound_assigned[2 * i] }));
+				}
+				else
+				{
+					ASSERT_EQ(get_raw_bits(actual[i]), get_raw_bits(expected[i]));
+					ASSERT_EQ(get_raw_bits(compound_assigned[2 * i]), get_raw_bits(expected[i]));
+				}
+			}
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16, MixedArithmeticYieldsSameTypeAsArithmeticWithFloat)
+{
+	static_assert(std::is_same<decltype(bfloat16_t{} + 1.0f), float>::value, "");
+	static_assert(std::is_same<decltype(1.0 * bfloat16_t{}), double>::value, "");
+	static_assert(std::is_same<decltype(bfloat16_t{} - 1), float>::value, "");
+
+	const bfloat16_t one{ 1.0f };
+	const auto denorm = float_limits::min() / 2.0f;
+
+	// The float argument is not rounded to bfloat16.
+	EXPECT_GT(one + std::ldexp(1.0f, -10), 1.0f);
+	EXPECT_GT(float_limits::min() * one - denorm, 0.0f);
+	EXPECT_EQ(3 / bfloat16_t{ 2.0f }, 1.5f);
+
+	auto value = one;
+	value *= 3.0f;
+	value -= 1.0f;
+	value /= 4.0f;
+	EXPECT_EQ(float{ value }, 0.5f);
+}
+
+
+GTEST_TEST(bfloat16, ComparisonOfBFloat16ValuesEqualsComparisonOfFloats)
+{
+	const auto raw_bits = get_raw_bits_for_operator_test();
+
+	for (const auto a_bits : raw_bits)
+	{
+		for (const auto b_bits : raw_bits)
+		{
+			const auto a = raw_bits_to_bfloat16(a_bits);
+			const auto b = raw_bits_to_bfloat16(b_bits);
+			const float x{ a };
+			const float y{ b };
+			const bool is_equal{ !(std::isunordered(x, y) || std::islessgreater(x, y)) };
+
+			ASSERT_EQ(a == b, is_equal) << a_bits << ' ' << b_bits;
+			ASSERT_EQ(a != b, !is_equal) << a_bits << ' ' << b_bits;
+			ASSERT_EQ(a < b, std::isless(x, y)) << a_bits << ' ' << b_bits;
+			ASSERT_EQ(a > b, std::isgreater(x, y)) << a_bits << ' ' << b_bits;
+			ASSERT_EQ(a <= b, std::islessequal(x, y)) << a_bits << ' ' << b_bits;
+			ASSERT_EQ(a >= b, std::isgreaterequal(x, y)) << a_bits << ' ' << b_bits;
+
+			// Mixed comparison.
+			ASSERT_EQ(a == y, is_equal);
+			ASSERT_EQ(x != b, !is_equal);
+			ASSERT_EQ(a < y, std::isless(x, y));
+			ASSERT_EQ(x >= b, std::isgreaterequal(x, y));
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16, UnaryMinusFlipsSignBit)
+{
+	for (std::uint32_t bits{}; bits <= uint16_max; ++bits)
+	{
+		const auto value = raw_bits_to_bfloat16(static_cast<std::uint16_t>(bits));
+		ASSERT_EQ(get_raw_bits(-value), bits ^ 0x8000U);
+		ASSERT_EQ(get_raw_bits(+value), bits);
+	}
+}
+
+
+GTEST_TEST(bfloat16, BranchlessConversionFromFloatEqualsConstruction)
+{
+	for (const float f : get_floats_for_bulk_conversion_test())
+	{
+		ASSERT_EQ(get_raw_bits(bfloat16_t::from_float_branchless(f)), get_raw_bits(bfloat16_t{ f }));
+	}
+
+	if (exhaustive)
+	{
+		// Might take a few seconds!
+		for (auto denorm = nextafterf(float_limits::min(), 0.0f); denorm > 0.0f; denorm = std::nextafterf(denorm, 0.0f))
+		{
+			EXPECT_EQ(get_raw_bits(bfloat16_t::from_float_branchless(denorm)), std::uint16_t{});
+			EXPECT_EQ(get_raw_bits(bfloat16_t::from_float_branchless(-denorm)), std::uint16_t{ 0x8000 });
+		}
+	}
+}
+
+
+#ifdef BIOVAULT_BFLOAT16_HAS_CONSTEXPR_CONVERSION
+GTEST_TEST(bfloat16, AllowsConstexprConversionFromFloat)
+{
+	constexpr bfloat16_t table[] =
+	{
+		bfloat16_t::from_float_constexpr(1.0f),
+		bfloat16_t::from_float_constexpr(-2.0f),
+		bfloat16_t::from_float_constexpr(1.00390625f), // 1 + 2^-8, a tie that rounds down to even.
+		bfloat16_t::from_float_constexpr(1.01171875f), // 1 + 3 * 2^-8, a tie that rounds up to even.
+		bfloat16_t::from_float_constexpr(float_limits::max()),
+		bfloat16_t::from_float_constexpr(float_limits::infinity()),
+		bfloat16_t::from_float_constexpr(float_limits::denorm_min()),
+		bfloat16_t::from_float_constexpr(float_limits::min() / 2.0f),
+		bfloat16_t::from_float_constexpr(float_limits::quiet_NaN())
+	};
+
+	static_assert(get_raw_bits(table[0]) == 0x3F80, "1.0f");
+	static_assert(get_raw_bits(table[1]) == 0xC000, "-2.0f");
+	static_assert(get_raw_bits(table[2]) == 0x3F80, "1 + 2^-8");
+	static_assert(get_raw_bits(table[3]) == 0x3F82, "1 + 3 * 2^-8");
+	static_assert(get_raw_bits(table[4]) == 0x7F80, "Max float becomes infinity");
+	static_assert(get_raw_bits(table[5]) == 0x7F80, "Infinity");
+	static_assert(get_raw_bits(table[6]) == 0, "Denormals convert to zero");
+	static_assert(get_raw_bits(table[7]) == 0, "Denormals convert to zero");
+	static_assert(get_raw_bits(table[8]) == 0x7FC0, "Quiet NaN");
+
+	for (const auto bf16 : table)
+	{
+		const float f{ bf16 };
+		EXPECT_EQ(get_raw_bits(bfloat16_t::from_float_constexpr(f)), get_raw_bits(bf16));
+	}
+
+	for (const float f : get_floats_for_bulk_conversion_test())
+	{
+#ifdef BIOVAULT_BFLOAT16_BUILTIN_BIT_CAST
+		ASSERT_EQ(get_raw_bits(bfloat16_t::from_float_constexpr(f)), get_raw_bits(bfloat16_t{ f }));
+#else
+		// The arithmetic decomposition drops the payload of a NaN, and without
+		// __builtin_signbit, the sign of -0.0f and of a NaN.
+#	ifdef __GNUC__
+		const bool has_sign{ std::signbit(f) };
+#	else
+		const bool has_sign{ std::signbit(f) && !std::isnan(f) && (std::fpclassify(f) != FP_ZERO) };
+#	endif
+		const std::uint16_t expected_bits = std::isnan(f) ?
+			static_cast<std::uint16_t>(has_sign ? 0xFFC0 : 0x7FC0) :
+			static_cast<std::uint16_t>(get_raw_bits(bfloat16_t{ f }) & (has_sign ? 0xFFFF : 0x7FFF));
+		ASSERT_EQ(get_raw_bits(bfloat16_t::from_float_constexpr(f)), expected_bits);
+#endif
+	}
+}
+#endif
+
+
+GTEST_TEST(bfloat16, BulkConversionFromFloatEqualsScalarConstruction)
+{
+	assert_bulk_conversion_from_float_equals_scalar_construction(
+		[](const float* const src, bfloat16_t* const dst, const std::size_t n)
+		{
+			biovault::convert(src, dst, n);
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachBulkConversionKernelFromFloatEqualsScalarConstruction)
+{
+	for_each_supported_simd_kernel([]
+		{
+			assert_bulk_conversion_from_float_equals_scalar_construction(
+				[](const float* const src, bfloat16_t* const dst, const std::size_t n)
+				{
+					biovault::convert(src, dst, n);
+				});
+		});
+}
+
+
+GTEST_TEST(bfloat16, BulkConversionToFloatPlacesRawBitsInUpperHalf)
+{
+	assert_bulk_conversion_to_float_places_raw_bits_in_upper_half(
+		[](const bfloat16_t* const src, float* const dst, const std::size_t n)
+		{
+			biovault::convert(src, dst, n);
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachBulkConversionKernelToFloatPlacesRawBitsInUpperHalf)
+{
+	for_each_supported_simd_kernel([]
+		{
+			assert_bulk_conversion_to_float_places_raw_bits_in_upper_half(
+				[](const bfloat16_t* const src, float* const dst, const std::size_t n)
+				{
+					biovault::convert(src, dst, n);
+				});
+		});
+}
+
+
+GTEST_TEST(bfloat16, BestSupportedSimdKernelIsActiveByDefault)
+{
+	const auto best_kernel = biovault::get_best_supported_simd_kernel();
+
+	EXPECT_TRUE(biovault::is_supported(best_kernel));
+	EXPECT_TRUE(biovault::is_supported(biovault::simd_kernel::scalar));
+	EXPECT_EQ(biovault::get_simd_kernel(), best_kernel);
+}
+
+
+GTEST_TEST(bfloat16, SetSimdKernelRejectsUnsupportedKernel)
+{
+	const auto initial_kernel = biovault::get_simd_kernel();
+
+	for (const auto kernel : all_simd_kernels)
+	{
+		SCOPED_TRACE(biovault::get_name(kernel));
+		EXPECT_EQ(biovault::set_simd_kernel(kernel), biovault::is_supported(kernel));
+		EXPECT_EQ(biovault::get_simd_kernel(), biovault::is_supported(kernel) ? kernel : initial_kernel);
+		ASSERT_TRUE(biovault::set_simd_kernel(initial_kernel));
+	}
+}
+
+
+GTEST_TEST(bfloat16, RoundToNearestEvenPolicyEqualsDefaultConstruction)
+{
+	for (const float f : get_floats_for_bulk_conversion_test())
+	{
+		ASSERT_EQ(get_raw_bits(bfloat16_t(f, biovault::round_to_nearest_even)), get_raw_bits(bfloat16_t{ f }));
+	}
+}
+
+
+GTEST_TEST(bfloat16, RoundTowardZeroTruncatesNormalFloats)
+{
+	for (const float f : get_floats_for_bulk_conversion_test())
+	{
+		const auto actual_bits = get_raw_bits(bfloat16_t(f, biovault::round_toward_zero));
+
+		if (std::isnormal(f))
+		{
+			std::uint32_t float_bits;
+			std::memcpy(&float_bits, &f, sizeof(f));
+			ASSERT_EQ(actual_bits, float_bits >> 16);
+			ASSERT_LE(std::abs(float{ raw_bits_to_bfloat16(actual_bits) }), std::abs(f));
+		}
+		else
+		{
+			// Rounding policies do not affect zero, denormals, infinity and NaN.
+			ASSERT_EQ(actual_bits, get_raw_bits(bfloat16_t{ f }));
+		}
+	}
+}
+
+
+GTEST_TEST(bfloat16, StochasticRoundingIsUnbiased)
+{
+	// 1 + 2^-9 is a quarter of the way from 1 (raw bits 0x3F80) to the next bfloat16,
+	// 1 + 2^-7 (raw bits 0x3F81).
+	constexpr float f{ 1.001953125f };
+	constexpr int number_of_conversions{ 1 << 16 };
+
+	biovault::stochastic_rounding rounding{ 42 };
+	int number_of_roundings_up{};
+
+	for (int i{}; i < number_of_conversions; ++i)
+	{
+		const auto actual_bits = get_raw_bits(bfloat16_t(f, rounding));
+		ASSERT_TRUE((actual_bits == 0x3F80) || (actual_bits == 0x3F81));
+		number_of_roundings_up += (actual_bits == 0x3F81) ? 1 : 0;
+	}
+	EXPECT_EQ(rounding.get_counter(), std::uint64_t{ number_of_conversions });
+	EXPECT_NEAR(number_of_roundings_up, number_of_conversions / 4, number_of_conversions / 100);
+
+	// Rounding policies do not affect zero, denormals, infinity and NaN.
+	for (const float special : { 0.0f, -0.0f, float_limits::denorm_min(), float_limits::infinity(), float_limits::quiet_NaN() })
+	{
+		EXPECT_EQ(get_raw_bits(bfloat16_t(special, rounding)), get_raw_bits(bfloat16_t{ special }));
+	}
+}
+
+
+GTEST_TEST(bfloat16, EachBulkConversionKernelTowardZeroEqualsScalarConstruction)
+{
+	const auto floats = get_floats_for_bulk_conversion_test();
+
+	for_each_supported_simd_kernel([&floats]
+		{
+			std::vector<bfloat16_t> bfloats(floats.size());
+
+			for (std::size_t n{}; n <= 40; ++n)
+			{
+				biovault::convert(floats.data() + 1, bfloats.data() + 1, n, biovault::round_toward_zero);
+			}
+			biovault::convert(floats.data(), bfloats.data(), floats.size(), biovault::round_toward_zero);
+
+			for (std::size_t i{}; i < floats.size(); ++i)
+			{
+				ASSERT_EQ(get_raw_bits(bfloats[i]), get_raw_bits(bfloat16_t(floats[i], biovault::round_toward_zero)));
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachBulkStochasticConversionKernelEqualsScalarConstruction)
+{
+	const auto floats = get_floats_for_bulk_conversion_test();
+
+	// Start just below 2^32, to check that the key changes at the right position.
+	for (const std::uint64_t initial_counter : { std::uint64_t{}, (std::uint64_t{ 1 } << 32) - 1000 })
+	{
+		for_each_supported_simd_kernel([&floats, initial_counter]
+			{
+				biovault::stochastic_rounding bulk_rounding{ 7, initial_counter };
+				biovault::stochastic_rounding scalar_rounding{ 7, initial_counter };
+
+				std::vector<bfloat16_t> bfloats(floats.size());
+
+				// Convert in pieces of different sizes, to test the continuation of the counter.
+				for (std::size_t offset{}, n{}; offset < floats.size(); offset += n, n = (n + 1) * 3)
+				{
+					n = std::min(n, floats.size() - offset);
+					biovault::convert(floats.data() + offset, bfloats.data() + offset, n, bulk_rounding);
+				}
+				EXPECT_EQ(bulk_rounding.get_counter(), initial_counter + floats.size());
+
+				for (std::size_t i{}; i < floats.size(); ++i)
+				{
+					ASSERT_EQ(get_raw_bits(bfloats[i]), get_raw_bits(bfloat16_t(floats[i], scalar_rounding))) << "i = " << i;
+				}
+			});
+	}
+}
+
+
+GTEST_TEST(bfloat16, EachDotKernelIsExactForSmallWholeNumbers)
+{
+	// With small whole numbers, all float products and sums are exact, so the
+	// order of accumulation does not matter.
+	for_each_supported_simd_kernel([]
+		{
+			for (std::size_t n{}; n <= 300; n += (n < 70) ? 1 : 23)
+			{
+				std::vector<bfloat16_t> a(n);
+				std::vector<bfloat16_t> b(n);
+				float expected{};
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto a_value = static_cast<int>(i % 17) - 8;
+					const auto b_value = static_cast<int>(i % 5) - 2;
+					a[i] = bfloat16_t{ a_value };
+					b[i] = bfloat16_t{ b_value };
+					expected += static_cast<float>(a_value * b_value);
+				}
+				ASSERT_EQ(biovault::dot(a.data(), b.data(), n), expected) << "n = " << n;
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachDotKernelApproximatesDoublePrecisionDotProduct)
+{
+	constexpr std::size_t n{ 10007 };
+	std::vector<bfloat16_t> a(n);
+	std::vector<bfloat16_t> b(n);
+	double expected{};
+	double sum_of_magnitudes{};
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		a[i] = bfloat16_t{ std::sin(static_cast<float>(i)) };
+		b[i] = bfloat16_t{ std::cos(static_cast<float>(i) * 0.37f) * 3.0f };
+		const double product{ double{ float{ a[i] } } * double{ float{ b[i] } } };
+		expected += product;
+		sum_of_magnitudes += std::abs(product);
+	}
+
+	for_each_supported_simd_kernel([&]
+		{
+			EXPECT_NEAR(biovault::dot(a.data(), b.data(), n), expected, sum_of_magnitudes * 1e-6);
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachAxpyKernelAddsScaledValuesToFloats)
+{
+	for_each_supported_simd_kernel([]
+		{
+			for (std::size_t n{}; n <= 80; ++n)
+			{
+				std::vector<bfloat16_t> x(n);
+				std::vector<float> y(n + 1);
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					x[i] = raw_bits_to_bfloat16(static_cast<std::uint16_t>(0x3F00 + i * 3));
+					y[i] = static_cast<float>(i);
+				}
+				y[n] = -1.0f;
+
+				// A multiplication by 0.5 is exact, so FMA and separate multiply-add yield the same sums.
+				biovault::axpy(0.5f, x.data(), y.data(), n);
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					ASSERT_EQ(y[i], static_cast<float>(i) + 0.5f * float{ x[i] });
+				}
+				ASSERT_EQ(y[n], -1.0f);
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachSumKernelIsExactForSmallWholeNumbers)
+{
+	for_each_supported_simd_kernel([]
+		{
+			for (std::size_t n{}; n <= 10000; n += (n < 70) ? 1 : 997)
+			{
+				std::vector<bfloat16_t> values(n);
+				float expected{};
+
+				for (std::size_t i{}; i < n; ++i)
+				{
+					const auto value = static_cast<int>(i % 19) - 9;
+					values[i] = bfloat16_t{ value };
+					expected += static_cast<float>(value);
+				}
+				ASSERT_EQ(biovault::sum(values.data(), n), expected) << "n = " << n;
+			}
+		});
+}
+
+
+GTEST_TEST(bfloat16, EachSumKernelIsAccurateForManyElements)
+{
+	// 0.1 is not exactly representable, so naive float accumulation of many of these
+	// would lose significant precision.
+	constexpr std::size_t n{ 3000017 };
+	const std::vector<bfloat16_t> values(n, bfloat16_t{ 0.1f });
+	const double expected{ double{ float{ bfloat16_t{ 0.1f } } } * n };
+
+	for_each_supported_simd_kernel([&values, expected]
+		{
+			EXPECT_NEAR(biovault::sum(values.data(), n), expected, expected * 1e-6);
+			EXPECT_NEAR(biovault::mean(values.data(), n), float{ values.front() }, 1e-7);
+		});
+}
+
+
+GTEST_TEST(bfloat16, SumOfInfinityIsInfinity)
+{
+	std::vector<bfloat16_t> values(100, bfloat16_t{ 1.0f });
+	values[42] = bfloat16_t{ float_limits::infinity() };
+
+	for_each_supported_simd_kernel([&values]
+		{
+			EXPECT_EQ(biovault::sum(values.data(), values.size()), float_limits::infinity());
+		});
+
+	values[43] = bfloat16_t{ -float_limits::infinity() };
+	EXPECT_TRUE(std::isnan(biovault::sum(values.data(), values.size())));
+}
+
+
+namespace
+{
+	template <typename IntegerType>
+	void assert_bulk_conversion_from_integers_equals_scalar_construction(const std::vector<IntegerType>& integers)
+	{
+		std::vector<bfloat16_t> bfloats(integers.size());
+
+		// Convert at different offsets, to check the scalar tail of the SIMD kernels.
+		for (std::size_t offset{}; offset < 20; ++offset)
+		{
+			const auto n = integers.size() - offset;
+			biovault::convert(integers.data() + offset, bfloats.data(), n);
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				ASSERT_EQ(get_raw_bits(bfloats[i]), get_raw_bits(bfloat16_t{ integers[i + offset] }))
+					<< "value = " << static_cast<std::int64_t>(integers[i + offset]);
+			}
+		}
+	}
+
+
+	// Returns all values of a 8-bit or 16-bit integer type.
+	template <typename IntegerType>
+	std::vector<IntegerType> get_all_values()
+	{
+		std::vector<IntegerType> result;
+
+		for (auto i = std::int64_t{ std::numeric_limits<IntegerType>::min() }; i <= std::numeric_limits<IntegerType>::max(); ++i)
+		{
+			result.push_back(static_cast<IntegerType>(i));
+		}
+		return result;
+	}
+}
+
+
+GTEST_TEST(bfloat16, EachBulkConversionKernelFromIntegersEqualsScalarConstruction)
+{
+	std::vector<std::int32_t> int32_values;
+
+	for (std::int32_t i{ -100000 }; i <= 100000; ++i)
+	{
+		int32_values.push_back(i);
+	}
+	int32_values.insert(int32_values.end(), { std::numeric_limits<std::int32_t>::min(),
+		std::numeric_limits<std::int32_t>::max(), 0x7FFFFF80, 0x01018000, 0x01008000, -0x01018000 });
+
+	for_each_supported_simd_kernel([&int32_values]
+		{
+			assert_bulk_conversion_from_integers_equals_scalar_construction(get_all_values<std::uint8_t>());
+			assert_bulk_conversion_from_integers_equals_scalar_construction(get_all_values<std::int8_t>());
+			assert_bulk_conversion_from_integers_equals_scalar_construction(get_all_values<std::uint16_t>());
+			assert_bulk_conversion_from_integers_equals_scalar_construction(get_all_values<std::int16_t>());
+			assert_bulk_conversion_from_integers_equals_scalar_construction(int32_values);
+		});
+}
+
+
+namespace
+{
+	// Rounds a double to float "to odd": toward zero, setting the least significant
+	// bit when inexact. Subsequent rounding to bfloat16 is then equivalent to a single
+	// rounding of the double, so it serves as a reference for bfloat16_t(const double).
+	float round_to_odd_float(const double d)
+	{
+		float f{ static_cast<float>(d) };
+
+		if (std::isnan(d) || !std::islessgreater(static_cast<double>(f), d))
+		{
+			return f;
+		}
+		if (std::isgreater(std::fabs(static_cast<double>(f)), std::fabs(d)))
+		{
+			f = std::nextafter(f, 0.0f);
+		}
+		std::uint32_t bits;
+		std::memcpy(&bits, &f, sizeof(bits));
+		bits |= 1U;
+		std::memcpy(&f, &bits, sizeof(bits));
+		return f;
+	}
+
+
+	// Returns doubles with each possible upper 16 bits, combined with lower bits
+	// around the rounding boundaries of bfloat16 (which are at bit 44 and bit 45).
+	std::vector<double> get_doubles_for_conversion_test()
+	{
+		constexpr std::uint64_t lower_bits[] = { 0, 1, 0xFFFFFFFFFFF, 0x100000000000, 0x100000000001,
+			0x1FFFFFFFFFFF, 0x200000000000, 0x300000000000, 0xFFFFFFFFFFFF };
+
+		std::vector<double> result;
+
+		for (std::uint64_t upper_bits{}; upper_bits <= uint16_max; ++upper_bits)
+		{
+			for (const auto lower : lower_bits)
+			{
+				const std::uint64_t bits{ (upper_bits << 48) | lower };
+				double d;
+				std::memcpy(&d, &bits, sizeof(d));
+				result.push_back(d);
+			}
+		}
+		return result;
+	}
+}
+
+
+GTEST_TEST(bfloat16, ConstructionFromDoubleRoundsOnlyOnce)
+{
+	// 1 + 2^-8 + 2^-40 is just above the midpoint between the bfloat16 values 1 and
+	// 1 + 2^-7, but rounding it to float first would yield the midpoint, a tie to even.
+	const double d{ 1.0 + std::ldexp(1.0, -8) + std::ldexp(1.0, -40) };
+
+	EXPECT_EQ(float{ bfloat16_t(static_cast<float>(d)) }, 1.0f);
+	EXPECT_EQ(float{ bfloat16_t(d) }, 1.0f + std::ldexp(1.0f, -7));
+
+	bfloat16_t assigned;
+	assigned = d;
+	EXPECT_EQ(get_raw_bits(assigned), get_raw_bits(bfloat16_t(d)));
+
+	for (const auto value : get_doubles_for_conversion_test())
+	{
+		ASSERT_EQ(get_raw_bits(bfloat16_t(value)), get_raw_bits(bfloat16_t(round_to_odd_float(value)))) << value;
+	}
+}
+
+
+GTEST_TEST(bfloat16, ConstructionFromDoubleEqualsConstructionFromFloat)
+{
+	for (const auto f : get_floats_for_bulk_conversion_test())
+	{
+		ASSERT_EQ(get_raw_bits(bfloat16_t(static_cast<double>(f))), get_raw_bits(bfloat16_t(f))) << f;
+	}
+}
+
+
+GTEST_TEST(bfloat16, EachBulkConversionKernelFromDoubleEqualsScalarConstruction)
+{
+	const auto doubles = get_doubles_for_conversion_test();
+
+	for_each_supported_simd_kernel([&doubles]
+		{
+			std::vector<bfloat16_t> bfloats(doubles.size());
+			biovault::convert(doubles.data(), bfloats.data(), doubles.size());
+
+			for (std::size_t i{}; i < doubles.size(); ++i)
+			{
+				ASSERT_EQ(get_raw_bits(bfloats[i]), get_raw_bits(bfloat16_t(doubles[i]))) << "i = " << i;
+			}
+
+			// Test small sizes and unaligned offsets, to exercise the scalar tail of the kernels.
+			for (std::size_t offset{}; offset < 4; ++offset)
+			{
+				for (std::size_t n{}; n <= 40; ++n)
+				{
+					std::vector<bfloat16_t> small_bfloats(n + offset + 1, bfloat16_t(std::uint16_t{ 0x1234 }, true));
+
+					biovault::convert(doubles.data() + 0x3F000 + offset, small_bfloats.data() + offset, n);
+
+					for (std::size_t i{}; i < small_bfloats.size(); ++i)
+					{
+						ASSERT_EQ(get_raw_bits(small_bfloats[i]), (i >= offset) && (i < offset + n) ?
+							get_raw_bits(bfloat16_t(doubles[0x3F000 + i])) : std::uint16_t{ 0x1234 });
+					}
+				}
+			}
+		});
+}
@@ -0,0 +1,116 @@
+#ifndef BIOVAULT_BFLOAT16_TEST_HELPERS_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_TEST_HELPERS_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Helpers that are shared among the unit tests (not part of the library): a loop
+// over the SIMD kernels, which restores the initial kernel, even when an assertion
+// fails, and a generator of pseudo-random floats that include special values.
+
+#include "biovault_bfloat16.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cstddef> // For size_t.
+#include <cstdint>
+#include <cstring> // For memcpy.
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace biovault {
+	namespace test {
+
+		constexpr simd_kernel all_simd_kernels[] =
+		{
+			simd_kernel::scalar,
+			simd_kernel::sse2,
+			simd_kernel::avx2,
+			simd_kernel::avx512,
+			simd_kernel::avx512_bf16,
+			simd_kernel::neon,
+			simd_kernel::neon_bf16
+		};
+
+
+		// Restores the SIMD kernel that is in use at construction, at destruction.
+		class simd_kernel_restorer
+		{
+		public:
+			simd_kernel_restorer() = default;
+			simd_kernel_restorer(const simd_kernel_restorer&) = delete;
+			simd_kernel_restorer& operator=(const simd_kernel_restorer&) = delete;
+
+			~simd_kernel_restorer()
+			{
+				EXPECT_TRUE(set_simd_kernel(initial_kernel_));
+			}
+
+		private:
+			const simd_kernel initial_kernel_{ get_simd_kernel() };
+		};
+
+
+		// Calls the specified test function once for each supported SIMD kernel, while
+		// that kernel is forced to be used by the bulk functions. A failing assertion
+		// only returns from the test function, and the initial kernel is restored.
+		template <typename Function>
+		void for_each_supported_simd_kernel(const Function test_function)
+		{
+			const simd_kernel_restorer restorer;
+
+			for (const auto kernel : all_simd_kernels)
+			{
+				if (set_simd_kernel(kernel))
+				{
+					SCOPED_TRACE(get_name(kernel));
+					test_function();
+				}
+			}
+		}
+
+
+		// Returns n pseudo-random floats (the same ones for each call), a quarter of
+		// which are special values: zeros, denormals, FLT_MAX (which rounds to
+		// infinity), infinities, NaN, and ties, which must be rounded to even.
+		inline std::vector<float> make_floats(const std::size_t n)
+		{
+			using float_limits = std::numeric_limits<float>;
+			const float special_values[] = { 0.0f, -0.0f, float_limits::denorm_min(), float_limits::max(),
+				float_limits::infinity(), -float_limits::infinity(), float_limits::quiet_NaN(), 1.00390625f, 1.01171875f };
+
+			std::mt19937 generator;
+			std::vector<float> result(n);
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				const auto bits = static_cast<std::uint32_t>(generator());
+				std::memcpy(&result[i], &bits, sizeof(bits));
+
+				if (bits % 4 == 0)
+				{
+					result[i] = special_values[(bits >> 8) % (sizeof(special_values) / sizeof(special_values[0]))];
+				}
+			}
+			return result;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,674 @@
+#ifndef BIOVAULT_BFLOAT16_VEC_H_INCLUDE_GUARD
+#define BIOVAULT_BFLOAT16_VEC_H_INCLUDE_GUARD
+
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// Fixed-size SIMD value types, for writing vectorized code without intrinsics:
+// bfloat16_vec<N> holds N bfloat16 values, and float_vec<N> holds N float values.
+// Arithmetic on bfloat16_vec is done (and yields results) in float, so that sums
+// and products are only rounded to bfloat16 when explicitly requested.
+//
+// Unlike the bulk functions, these types cannot select their instruction set at
+// run-time, as their registers are part of the user's code. Instead, they use the
+// widest registers that are enabled for the compiler (for example, by -mavx2 -mfma,
+// -march=native, or /arch:AVX512). Without any, they still work, lane by lane.
+
+#include "biovault_bfloat16.h"
+
+#include <cstddef> // For size_t.
+#include <cstdint>
+#include <cstring> // For memcpy.
+
+#if defined(BIOVAULT_BFLOAT16_AVX512) && \
+	defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512DQ__) && defined(__AVX512VL__)
+#define BIOVAULT_BFLOAT16_VEC_AVX512
+#endif
+#if defined(BIOVAULT_BFLOAT16_AVX2) && defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define BIOVAULT_BFLOAT16_VEC_AVX2
+#endif
+#if defined(BIOVAULT_BFLOAT16_SSE2) && \
+	(defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define BIOVAULT_BFLOAT16_VEC_SSE2
+#endif
+#if defined(BIOVAULT_BFLOAT16_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define BIOVAULT_BFLOAT16_VEC_NEON
+#endif
+
+namespace biovault {
+
+	namespace detail {
+
+		// The operations on a SIMD register of Width float lanes, as used by float_vec.
+		template <std::size_t Width>
+		struct simd_register;
+
+		template <>
+		struct simd_register<1>
+		{
+			using type = float;
+
+			static type broadcast(const float value)
+			{
+				return value;
+			}
+
+			static type load(const float* const src)
+			{
+				return *src;
+			}
+
+			static void store(float* const dst, const type value)
+			{
+				*dst = value;
+			}
+
+			static type load(const bfloat16_t* const src)
+			{
+				return *src;
+			}
+
+			// Stores the upper halves of the lanes, which is exact for bfloat16 values.
+			static void store(bfloat16_t* const dst, const type value)
+			{
+				std::uint32_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				*dst = bfloat16_t(static_cast<std::uint16_t>(bits >> 16), true);
+			}
+
+			// Rounds each lane to the nearest bfloat16 value, as bfloat16_t(float).
+			static type round(const type value)
+			{
+				return bfloat16_t(value);
+			}
+
+			static type add(const type a, const type b)
+			{
+				return a + b;
+			}
+
+			static type subtract(const type a, const type b)
+			{
+				return a - b;
+			}
+
+			static type multiply(const type a, const type b)
+			{
+				return a * b;
+			}
+
+			static type divide(const type a, const type b)
+			{
+				return a / b;
+			}
+
+			static type multiply_add(const type a, const type b, const type c)
+			{
+				return a * b + c;
+			}
+
+			static float reduce_add(const type value)
+			{
+				return value;
+			}
+		};
+
+#if defined(BIOVAULT_BFLOAT16_VEC_SSE2)
+		template <>
+		struct simd_register<4>
+		{
+			using type = __m128;
+
+			static type broadcast(const float value)
+			{
+				return _mm_set1_ps(value);
+			}
+
+			static type load(const float* const src)
+			{
+				return _mm_loadu_ps(src);
+			}
+
+			static void store(float* const dst, const type value)
+			{
+				_mm_storeu_ps(dst, value);
+			}
+
+			static type load(const bfloat16_t* const src)
+			{
+				return sse2::widen_low(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+			}
+
+			static void store(bfloat16_t* const dst, const type value)
+			{
+				const __m128i bits = _mm_srli_epi32(_mm_castps_si128(value), 16);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), sse2::pack(bits, bits));
+			}
+
+			static type round(const type value)
+			{
+				return _mm_castsi128_ps(_mm_slli_epi32(sse2::convert_to_bits_of_bfloat16(value), 16));
+			}
+
+			static type add(const type a, const type b)
+			{
+				return _mm_add_ps(a, b);
+			}
+
+			static type subtract(const type a, const type b)
+			{
+				return _mm_sub_ps(a, b);
+			}
+
+			static type multiply(const type a, const type b)
+			{
+				return _mm_mul_ps(a, b);
+			}
+
+			static type divide(const type a, const type b)
+			{
+				return _mm_div_ps(a, b);
+			}
+
+			// SSE2 has no fused multiply-add.
+			static type multiply_add(const type a, const type b, const type c)
+			{
+				return _mm_add_ps(_mm_mul_ps(a, b), c);
+			}
+
+			static float reduce_add(const type value)
+			{
+				return sse2::reduce_add(value);
+			}
+		};
+#elif defined(BIOVAULT_BFLOAT16_VEC_NEON)
+		template <>
+		struct simd_register<4>
+		{
+			using type = float32x4_t;
+
+			static type broadcast(const float value)
+			{
+				return vdupq_n_f32(value);
+			}
+
+			static type load(const float* const src)
+			{
+				return vld1q_f32(src);
+			}
+
+			static void store(float* const dst, const type value)
+			{
+				vst1q_f32(dst, value);
+			}
+
+			static type load(const bfloat16_t* const src)
+			{
+				return vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(reinterpret_cast<const std::uint16_t*>(src)), 16));
+			}
+
+			static void store(bfloat16_t* const dst, const type value)
+			{
+				vst1_u16(reinterpret_cast<std::uint16_t*>(dst), vshrn_n_u32(vreinterpretq_u32_f32(value), 16));
+			}
+
+			static type round(const type value)
+			{
+				return vreinterpretq_f32_u32(vshlq_n_u32(neon::convert_to_bits_of_bfloat16(value), 16));
+			}
+
+			static type add(const type a, const type b)
+			{
+				return vaddq_f32(a, b);
+			}
+
+			static type subtract(const type a, const type b)
+			{
+				return vsubq_f32(a, b);
+			}
+
+			static type multiply(const type a, const type b)
+			{
+				return vmulq_f32(a, b);
+			}
+
+			static type divide(const type a, const type b)
+			{
+				return vdivq_f32(a, b);
+			}
+
+			static type multiply_add(const type a, const type b, const type c)
+			{
+				return vfmaq_f32(c, a, b);
+			}
+
+			static float reduce_add(const type value)
+			{
+				return vaddvq_f32(value);
+			}
+		};
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_VEC_AVX2
+		template <>
+		struct simd_register<8>
+		{
+			using type = __m256;
+
+			static type broadcast(const float value)
+			{
+				return _mm256_set1_ps(value);
+			}
+
+			static type load(const float* const src)
+			{
+				return _mm256_loadu_ps(src);
+			}
+
+			static void store(float* const dst, const type value)
+			{
+				_mm256_storeu_ps(dst, value);
+			}
+
+			static type load(const bfloat16_t* const src)
+			{
+				return avx2::load_as_float(src);
+			}
+
+			static void store(bfloat16_t* const dst, const type value)
+			{
+				const __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(value), 16);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+					_mm_packus_epi32(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1)));
+			}
+
+			static type round(const type value)
+			{
+				return _mm256_castsi256_ps(_mm256_slli_epi32(avx2::convert_to_bits_of_bfloat16(value), 16));
+			}
+
+			static type add(const type a, const type b)
+			{
+				return _mm256_add_ps(a, b);
+			}
+
+			static type subtract(const type a, const type b)
+			{
+				return _mm256_sub_ps(a, b);
+			}
+
+			static type multiply(const type a, const type b)
+			{
+				return _mm256_mul_ps(a, b);
+			}
+
+			static type divide(const type a, const type b)
+			{
+				return _mm256_div_ps(a, b);
+			}
+
+			static type multiply_add(const type a, const type b, const type c)
+			{
+				return _mm256_fmadd_ps(a, b, c);
+			}
+
+			static float reduce_add(const type value)
+			{
+				return avx2::reduce_add(value);
+			}
+		};
+#endif
+
+#ifdef BIOVAULT_BFLOAT16_VEC_AVX512
+		template <>
+		struct simd_register<16>
+		{
+			using type = __m512;
+
+			static type broadcast(const float value)
+			{
+				return _mm512_set1_ps(value);
+			}
+
+			static type load(const float* const src)
+			{
+				return _mm512_loadu_ps(src);
+			}
+
+			static void store(float* const dst, const type value)
+			{
+				_mm512_storeu_ps(dst, value);
+			}
+
+			static type load(const bfloat16_t* const src)
+			{
+				return avx512::load_as_float(src);
+			}
+
+			static void store(bfloat16_t* const dst, const type value)
+			{
+				const __m512i bits = _mm512_srli_epi32(_mm512_castps_si512(value), 16);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm512_cvtepi32_epi16(bits));
+			}
+
+			static type round(const type value)
+			{
+				return _mm512_castsi512_ps(_mm512_slli_epi32(avx512::convert_to_bits_of_bfloat16(value), 16));
+			}
+
+			static type add(const type a, const type b)
+			{
+				return _mm512_add_ps(a, b);
+			}
+
+			static type subtract(const type a, const type b)
+			{
+				return _mm512_sub_ps(a, b);
+			}
+
+			static type multiply(const type a, const type b)
+			{
+				return _mm512_mul_ps(a, b);
+			}
+
+			static type divide(const type a, const type b)
+			{
+				return _mm512_div_ps(a, b);
+			}
+
+			static type multiply_add(const type a, const type b, const type c)
+			{
+				return _mm512_fmadd_ps(a, b, c);
+			}
+
+			static float reduce_add(const type value)
+			{
+				return _mm512_reduce_add_ps(value);
+			}
+		};
+#endif
+
+		// Returns the number of lanes of the widest available register that evenly
+		// divides n lanes.
+		constexpr std::size_t get_simd_register_width(const std::size_t n)
+		{
+#ifdef BIOVAULT_BFLOAT16_VEC_AVX512
+			if (n % 16 == 0)
+			{
+				return 16;
+			}
+#endif
+#ifdef BIOVAULT_BFLOAT16_VEC_AVX2
+			if (n % 8 == 0)
+			{
+				return 8;
+			}
+#endif
+#if defined(BIOVAULT_BFLOAT16_VEC_SSE2) || defined(BIOVAULT_BFLOAT16_VEC_NEON)
+			if (n % 4 == 0)
+			{
+				return 4;
+			}
+#endif
+			return (n == 0) ? 0 : 1;
+		}
+	}
+
+
+	template <std::size_t N>
+	class bfloat16_vec;
+
+
+	// N float values, stored in as few SIMD registers as possible.
+	template <std::size_t N>
+	class float_vec
+	{
+		static_assert(N > 0, "A float_vec must have at least one lane");
+
+		using register_traits = detail::simd_register<detail::get_simd_register_width(N)>;
+		using register_type = typename register_traits::type;
+		static constexpr std::size_t number_of_registers{ N / detail::get_simd_register_width(N) };
+		static constexpr std::size_t register_width{ detail::get_simd_register_width(N) };
+
+	public:
+		static constexpr std::size_t size() noexcept
+		{
+			return N;
+		}
+
+		// Leaves the lanes uninitialized, like a float.
+		float_vec() = default;
+
+		// Sets each lane to the specified value.
+		explicit float_vec(const float value)
+		{
+			for (auto& r : registers_)
+			{
+				r = register_traits::broadcast(value);
+			}
+		}
+
+		// Loads N values from src (which does not need to be aligned).
+		static float_vec load(const float* const src)
+		{
+			float_vec result;
+
+			for (std::size_t i{}; i < number_of_registers; ++i)
+			{
+				result.registers_[i] = register_traits::load(src + i * register_width);
+			}
+			return result;
+		}
+
+		// Stores the N values to dst (which does not need to be aligned).
+		void store(float* const dst) const
+		{
+			for (std::size_t i{}; i < number_of_registers; ++i)
+			{
+				register_traits::store(dst + i * register_width, registers_[i]);
+			}
+		}
+
+		// Returns the value of the specified lane. Only intended for occasional use.
+		float operator[](const std::size_t i) const
+		{
+			float values[N];
+			store(values);
+			return values[i];
+		}
+
+		float_vec& operator+=(const float_vec& other)
+		{
+			return *this = *this + other;
+		}
+
+		float_vec& operator-=(const float_vec& other)
+		{
+			return *this = *this - other;
+		}
+
+		float_vec& operator*=(const float_vec& other)
+		{
+			return *this = *this * other;
+		}
+
+		float_vec& operator/=(const float_vec& other)
+		{
+			return *this = *this / other;
+		}
+
+		friend float_vec operator+(const float_vec& a, const float_vec& b)
+		{
+			return apply(a, b, register_traits::add);
+		}
+
+		friend float_vec operator-(const float_vec& a, const float_vec& b)
+		{
+			return apply(a, b, register_traits::subtract);
+		}
+
+		friend float_vec operator*(const float_vec& a, const float_vec& b)
+		{
+			return apply(a, b, register_traits::multiply);
+		}
+
+		friend float_vec operator/(const float_vec& a, const float_vec& b)
+		{
+			return apply(a, b, register_traits::divide);
+		}
+
+		// Returns a * b + c. Only rounded once when the instruction set has a fused
+		// multiply-add (AVX2 with FMA, AVX-512, and AArch64).
+		friend float_vec multiply_add(const float_vec& a, const float_vec& b, const float_vec& c)
+		{
+			float_vec result;
+
+			for (std::size_t i{}; i < number_of_registers; ++i)
+			{
+				result.registers_[i] = register_traits::multiply_add(a.registers_[i], b.registers_[i], c.registers_[i]);
+			}
+			return result;
+		}
+
+		// Returns the sum of all lanes. The order of the additions is unspecified.
+		friend float reduce_add(const float_vec& value)
+		{
+			register_type sum{ value.registers_[0] };
+
+			for (std::size_t i{ 1 }; i < number_of_registers; ++i)
+			{
+				sum = register_traits::add(sum, value.registers_[i]);
+			}
+			return register_traits::reduce_add(sum);
+		}
+
+	private:
+		template <typename Operation>
+		static float_vec apply(const float_vec& a, const float_vec& b, const Operation operation)
+		{
+			float_vec result;
+
+			for (std::size_t i{}; i < number_of_registers; ++i)
+			{
+				result.registers_[i] = operation(a.registers_[i], b.registers_[i]);
+			}
+			return result;
+		}
+
+		friend class bfloat16_vec<N>;
+
+		register_type registers_[number_of_registers];
+	};
+
+
+	// N bfloat16 values. Internally kept widened to float, so that arithmetic and the
+	// conversion to float_vec do not need any extra instructions, while loading and
+	// storing only need a shift and a pack.
+	template <std::size_t N>
+	class bfloat16_vec
+	{
+		using register_traits = typename float_vec<N>::register_traits;
+
+	public:
+		static constexpr std::size_t size() noexcept
+		{
+			return N;
+		}
+
+		bfloat16_vec() = default;
+
+		// Sets each lane to the specified value.
+		explicit bfloat16_vec(const bfloat16_t value)
+			: value_(static_cast<float>(value))
+		{
+		}
+
+		// Rounds each lane to the nearest bfloat16 value, the same way as bfloat16_t(float).
+		explicit bfloat16_vec(const float_vec<N>& value)
+		{
+			for (std::size_t i{}; i < float_vec<N>::number_of_registers; ++i)
+			{
+				value_.registers_[i] = register_traits::round(value.registers_[i]);
+			}
+		}
+
+		// Loads N values from src (which does not need to be aligned).
+		static bfloat16_vec load(const bfloat16_t* const src)
+		{
+			bfloat16_vec result;
+
+			for (std::size_t i{}; i < float_vec<N>::number_of_registers; ++i)
+			{
+				result.value_.registers_[i] = register_traits::load(src + i * float_vec<N>::register_width);
+			}
+			return result;
+		}
+
+		// Stores the N values to dst (which does not need to be aligned).
+		void store(bfloat16_t* const dst) const
+		{
+			for (std::size_t i{}; i < float_vec<N>::number_of_registers; ++i)
+			{
+				register_traits::store(dst + i * float_vec<N>::register_width, value_.registers_[i]);
+			}
+		}
+
+		// Returns the value of the specified lane. Only intended for occasional use.
+		bfloat16_t operator[](const std::size_t i) const
+		{
+			bfloat16_t values[N];
+			store(values);
+			return values[i];
+		}
+
+		const float_vec<N>& to_float() const noexcept
+		{
+			return value_;
+		}
+
+		// NOLINTNEXTLINE Allow implicit conversion to float_vec, because it is lossless.
+		operator const float_vec<N>&() const noexcept
+		{
+			return value_;
+		}
+
+		friend float_vec<N> operator+(const bfloat16_vec& a, const bfloat16_vec& b)
+		{
+			return a.value_ + b.value_;
+		}
+
+		friend float_vec<N> operator-(const bfloat16_vec& a, const bfloat16_vec& b)
+		{
+			return a.value_ - b.value_;
+		}
+
+		friend float_vec<N> operator*(const bfloat16_vec& a, const bfloat16_vec& b)
+		{
+			return a.value_ * b.value_;
+		}
+
+		friend float_vec<N> operator/(const bfloat16_vec& a, const bfloat16_vec& b)
+		{
+			return a.value_ / b.value_;
+		}
+
+	private:
+		float_vec<N> value_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,211 @@
+/*******************************************************************************
+* Copyright 2020 LKEB, Leiden University Medical Center
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+// The file to be tested. Included twice here, to check its include guards!
+#include "biovault_bfloat16_vec.h"
+#include "biovault_bfloat16_vec.h"
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+// Standard library header files:
+#include <cmath>   // For isnan and ldexp.
+#include <cstdint>
+#include <cstring> // For memcpy.
+#include <limits>
+#include <vector>
+
+using biovault::bfloat16_t;
+using biovault::bfloat16_vec;
+using biovault::float_vec;
+
+
+namespace
+{
+	// Float values that include ties, subnormals, infinity and NaN.
+	std::vector<float> make_float_values(const std::size_t n)
+	{
+		std::vector<float> result;
+		result.reserve(n);
+
+		for (std::size_t i{}; i < n; ++i)
+		{
+			switch (i % 8)
+			{
+			case 0: result.push_back(1.0f + std::ldexp(static_cast<float>(i % 5), -8)); break;
+			case 1: result.push_back(-std::ldexp(1.0f + static_cast<float>(i) / 97.0f, static_cast<int>(i % 40) - 20)); break;
+			case 2: result.push_back(std::numeric_limits<float>::denorm_min() * static_cast<float>(i)); break;
+			case 3: result.push_back((i % 3 == 0) ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN()); break;
+			default: result.push_back(static_cast<float>(i) * 0.37f - 3.0f); break;
+			}
+		}
+		return result;
+	}
+
+
+	std::uint32_t get_bits(const float f)
+	{
+		std::uint32_t result;
+		std::memcpy(&result, &f, sizeof(result));
+		return result;
+	}
+
+
+	void expect_same_float(const float actual, const float expected)
+	{
+		if (std::isnan(expected))
+		{
+			EXPECT_TRUE(std::isnan(actual));
+		}
+		else
+		{
+			EXPECT_EQ(get_bits(actual), get_bits(expected));
+		}
+	}
+
+
+	template <std::size_t N>
+	void expect_vec_operations_equal_scalar_operations()
+	{
+		SCOPED_TRACE(N);
+
+		const auto x = make_float_values(N);
+		std::vector<float> y(N);
+
+		for (std::size_t i{}; i < N; ++i)
+		{
+			y[i] = static_cast<float>(i) - 2.75f;
+		}
+
+		// Rounding a float_vec to a bfloat16_vec is equivalent to rounding each value.
+		std::vector<bfloat16_t> a_values(N);
+		bfloat16_vec<N>{ float_vec<N>::load(x.data()) }.store(a_values.data());
+
+		for (std::size_t i{}; i < N; ++i)
+		{
+			EXPECT_EQ(get_raw_bits(a_values[i]), get_raw_bits(bfloat16_t(x[i])));
+		}
+
+		// Loading and storing preserves the raw bits, even those of NaN.
+		const auto a = bfloat16_vec<N>::load(a_values.data());
+		std::vector<bfloat16_t> stored(N);
+		a.store(stored.data());
+
+		for (std::size_t i{}; i < N; ++i)
+		{
+			EXPECT_EQ(get_raw_bits(stored[i]), get_raw_bits(a_values[i]));
+			EXPECT_EQ(get_raw_bits(a[i]), get_raw_bits(a_values[i]));
+			expect_same_float(a.to_float()[i], a_values[i]);
+		}
+
+		// The arithmetic is done in float, lane by lane.
+		std::vector<bfloat16_t> b_values(N);
+		biovault::convert(y.data(), b_values.data(), N);
+		const auto b = bfloat16_vec<N>::load(b_values.data());
+
+		float_vec<N> accumulated{ 1.0f };
+		accumulated += a;
+		accumulated *= b;
+		accumulated -= float_vec<N>{ 0.5f };
+		accumulated /= b;
+
+		const float_vec<N> results[] = { a + b, a - b, a * b, a / b, accumulated, multiply_add(a, b, float_vec<N>{ -0.0f }) };
+
+		for (std::size_t i{}; i < N; ++i)
+		{
+			const float a_i{ a_values[i] };
+			const float b_i{ b_values[i] };
+
+			expect_same_float(results[0][i], a_i + b_i);
+			expect_same_float(results[1][i], a_i - b_i);
+			expect_same_float(results[2][i], a_i * b_i);
+			expect_same_float(results[3][i], a_i / b_i);
+			expect_same_float(results[4][i], ((1.0f + a_i) * b_i - 0.5f) / b_i);
+
+			// As the product of two bfloat16 values is exact in float, a fused and an
+			// unfused multiply-add yield the same result here.
+			expect_same_float(results[5][i], a_i * b_i);
+		}
+	}
+
+
+	template <std::size_t N>
+	void expect_reduce_add_equals_sum_of_lanes()
+	{
+		SCOPED_TRACE(N);
+
+		std::vector<float> values(N);
+
+		for (std::size_t i{}; i < N; ++i)
+		{
+			// Small integers, so that the sum is exact, whatever the order of additions.
+			values[i] = static_cast<float>(i % 7) - 3.0f;
+		}
+		float expected{};
+
+		for (const auto value : values)
+		{
+			expected += value;
+		}
+		EXPECT_EQ(reduce_add(float_vec<N>::load(values.data())), expected);
+	}
+}
+
+
+GTEST_TEST(bfloat16_vec, OperationsEqualScalarOperations)
+{
+	expect_vec_operations_equal_scalar_operations<1>();
+	expect_vec_operations_equal_scalar_operations<3>();
+	expect_vec_operations_equal_scalar_operations<4>();
+	expect_vec_operations_equal_scalar_operations<8>();
+	expect_vec_operations_equal_scalar_operations<12>();
+	expect_vec_operations_equal_scalar_operations<16>();
+	expect_vec_operations_equal_scalar_operations<32>();
+	expect_vec_operations_equal_scalar_operations<64>();
+}
+
+
+GTEST_TEST(bfloat16_vec, ReduceAddEqualsSumOfLanes)
+{
+	expect_reduce_add_equals_sum_of_lanes<1>();
+	expect_reduce_add_equals_sum_of_lanes<4>();
+	expect_reduce_add_equals_sum_of_lanes<24>();
+	expect_reduce_add_equals_sum_of_lanes<64>();
+}
+
+
+GTEST_TEST(bfloat16_vec, DotProductEqualsBulkDot)
+{
+	constexpr std::size_t n{ 1024 };
+	constexpr std::size_t lanes{ 16 };
+
+	std::vector<bfloat16_t> a(n);
+	std::vector<bfloat16_t> b(n);
+
+	for (std::size_t i{}; i < n; ++i)
+	{
+		a[i] = bfloat16_t(static_cast<float>(i % 11) - 5.0f);
+		b[i] = bfloat16_t(static_cast<float>(i % 13) * 0.25f);
+	}
+
+	float_vec<lanes> sum{ 0.0f };
+
+	for (std::size_t i{}; i < n; i += lanes)
+	{
+		sum = multiply_add(bfloat16_vec<lanes>::load(&a[i]), bfloat16_vec<lanes>::load(&b[i]), sum);
+	}
+	EXPECT_EQ(reduce_add(sum), biovault::dot(a.data(), b.data(), n));
+}